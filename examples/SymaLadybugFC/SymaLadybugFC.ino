@@ -48,8 +48,9 @@ static hf::LevelPid levelPid = hf::LevelPid(0.20f);
 
 static hf::Hackflight h(&board, &receiver, &mixer);
 
-static hf::UsfsGyrometer gyrometer;
-static hf::UsfsQuaternion quaternion; // not really a sensor, but we treat it like one!
+static hf::USFS usfs;
+static hf::UsfsGyrometer gyrometer(usfs);
+static hf::UsfsQuaternion quaternion(usfs); // not really a sensor, but we treat it like one!
 
 void setup(void)
 {
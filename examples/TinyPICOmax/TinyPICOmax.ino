@@ -46,8 +46,9 @@ hf::DSMX_ESP32_Serial1 receiver = hf::DSMX_ESP32_Serial1(CHANNEL_MAP, DEMAND_SCA
 
 static hf::MixerQuadXMW mixer(&motors);
 
-static hf::UsfsMaxGyrometer gyrometer;
-static hf::UsfsMaxQuaternion quaternion; // not really a sensor, but we treat it like one!
+static hf::UsfsMax usfsmax;
+static hf::UsfsMaxGyrometer gyrometer(usfsmax);
+static hf::UsfsMaxQuaternion quaternion(usfsmax); // not really a sensor, but we treat it like one!
 
 static hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
 static hf::YawPid yawPid = hf::YawPid(2, 0.1);
@@ -41,6 +41,9 @@ namespace hf {
             // Supports computing quaternion after a certain number of IMU readings
             uint8_t _quatCycleCount = 0;
 
+            // Time of last filter update
+            float _quatTime = 0;
+
             // Params passed to Madgwick quaternion constructor
             const float _beta = sqrtf(3.0f / 4.0f) * rft::Filter::deg2rad(GYRO_MEAS_ERROR_DEG);
             const float _zeta = sqrtf(3.0f / 4.0f) * rft::Filter::deg2rad(GYRO_MEAS_DRIFT_DEG);  
@@ -85,9 +88,8 @@ namespace hf {
                 if (_quatCycleCount == 0) {
 
                     // Set integration time by time elapsed since last filter update
-                    static float _time;
-                    float deltat = time - _time;
-                    _time = time;
+                    float deltat = time - _quatTime;
+                    _quatTime = time;
 
                     // Run the quaternion on the IMU values acquired in imuReadAccelGyro()                   
                     _quaternionFilter.update(_ax, _ay, _az, _gx, _gy, _gz, deltat); 
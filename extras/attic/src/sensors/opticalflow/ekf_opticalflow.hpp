@@ -92,6 +92,19 @@ namespace hf {
 
             Matrix Pm = Matrix(STATE_DIM, STATE_DIM);
 
+            // Scratch matrices for stateEstimatorFinalize()
+            Matrix _finalAm = Matrix(STATE_DIM, STATE_DIM);
+            Matrix _finalNN1m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix _finalNN2m = Matrix(STATE_DIM, STATE_DIM);
+
+            // Scratch matrices for stateEstimatorScalarUpdate()
+            Matrix _updateKm = Matrix(STATE_DIM, 1);
+            Matrix _updateNN1m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix _updateNN2m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix _updateNN3m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix _updateHTm = Matrix(STATE_DIM, 1);
+            Matrix _updatePHTm = Matrix(STATE_DIM, 1);
+
             static constexpr float STDDEV = 0.25f;
 
             // ~~~ Camera constants ~~~
@@ -139,11 +152,11 @@ namespace hf {
             void stateEstimatorFinalize(void)
             {
                 // Matrix to rotate the attitude covariances once updated
-                static Matrix Am(STATE_DIM, STATE_DIM);
+                Matrix & Am = _finalAm;
 
                 // Temporary matrices for the covariance updates
-                static Matrix tmpNN1m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN2m(STATE_DIM, STATE_DIM);
+                Matrix & tmpNN1m = _finalNN1m;
+                Matrix & tmpNN2m = _finalNN2m;
 
                 // Incorporate the attitude error (Kalman filter state) with the attitude
                 float v0 = S[STATE_D0];
@@ -260,14 +273,14 @@ namespace hf {
             void stateEstimatorScalarUpdate(Matrix & Hm, float error, float stdMeasNoise, const char * label)
             {
                 // The Kalman gain as a column vector
-                static Matrix Km(STATE_DIM, 1);
+                Matrix & Km = _updateKm;
 
                 // Temporary matrices for the covariance updates
-                static Matrix tmpNN1m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN2m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN3m(STATE_DIM, STATE_DIM);
-                static Matrix HTm(STATE_DIM, 1);
-                static Matrix PHTm(STATE_DIM, 1);
+                Matrix & tmpNN1m = _updateNN1m;
+                Matrix & tmpNN2m = _updateNN2m;
+                Matrix & tmpNN3m = _updateNN3m;
+                Matrix & HTm = _updateHTm;
+                Matrix & PHTm = _updatePHTm;
 
                 // ====== INNOVATION COVARIANCE ======
 
@@ -38,25 +38,28 @@ namespace hf {
 
             float _distance = 0;
 
+            // Previous values to support first-differencing
+            float _prevTime = 0;
+            float _prevAltitude = 0;
+
+            // Time of last accepted reading
+            float _readyTime = 0;
+
             LowPassFilter _lpf = LowPassFilter(20);
 
         protected:
 
             virtual void modifyState(state_t & state, float time) override
             {
-                // Previous values to support first-differencing
-                static float _time;
-                static float _altitude;
-
                 // Compensate for effect of pitch, roll on rangefinder reading
                 state.location[2] =  _distance * cos(state.rotation[0]) * cos(state.rotation[1]);
 
                 // Use first-differenced, low-pass-filtered altitude as variometer
-                state.inertialVel[2] = _lpf.update((state.location[2]-_altitude) / (time-_time));
+                state.inertialVel[2] = _lpf.update((state.location[2]-_prevAltitude) / (time-_prevTime));
 
                 // Update first-difference values
-                _time = time;
-                _altitude = state.location[2];
+                _prevTime = time;
+                _prevAltitude = state.location[2];
             }
 
             virtual bool ready(float time) override
@@ -65,13 +68,11 @@ namespace hf {
 
                 if (distanceAvailable(newDistance)) {
 
-                    static float _time;
-
-                    if (time-_time > UPDATE_PERIOD) {
+                    if (time-_readyTime > UPDATE_PERIOD) {
 
                         _distance = newDistance;
 
-                        _time = time; 
+                        _readyTime = time; 
 
                         return true;
                     }
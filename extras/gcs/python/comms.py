@@ -10,6 +10,8 @@ MIT License
 from serial import Serial
 from threading import Thread
 
+from mspparser import MspParser
+
 BAUD = 115200
 
 
@@ -38,6 +40,13 @@ class Comms:
 
         self.port.write(request)
 
+    def subscribe(self, topic, divisor):
+        '''
+        Asks the flight controller to stream a telemetry topic at
+        1000/divisor Hz; divisor 0 stops it
+        '''
+        self.send_message(MspParser.serialize_SET_TELEMETRY, (topic, divisor))
+
     def run(self):
 
         while self.running:
@@ -1,41 +1,66 @@
 #  MSP Parser subclass and message builders
 
+#  Generated by extras/parser/mspgen.py from messages.json; do not edit
+
 #  MIT License
 
 import struct
 
-import abc
 from msp import Parser
 
 
-class MspParser(Parser, metaclass=abc.ABCMeta):
+class MspParser(Parser):
 
-    def dispatchMessage(self):
+    RC_NORMAL = struct.Struct('=ffffff')
+    ATTITUDE_RADIANS = struct.Struct('=fff')
+    ACTUATOR_TYPE = struct.Struct('=B')
+    PROFILE_STATS = struct.Struct('=ffffff')
+    PROFILE_HISTOGRAM = struct.Struct('=ffffffffffffffff')
+    SET_MOTOR_NORMAL = struct.Struct('=ffff')
+    SET_PROFILE_STAGE = struct.Struct('=B')
+    SET_TELEMETRY = struct.Struct('=BB')
+
+    # Message ID => (payload struct or None for raw bytes, handler name)
+    HANDLERS = {
+        121: (RC_NORMAL, 'handle_RC_NORMAL'),
+        122: (ATTITUDE_RADIANS, 'handle_ATTITUDE_RADIANS'),
+        123: (ACTUATOR_TYPE, 'handle_ACTUATOR_TYPE'),
+        124: (PROFILE_STATS, 'handle_PROFILE_STATS'),
+        125: (PROFILE_HISTOGRAM, 'handle_PROFILE_HISTOGRAM'),
+        126: (None, 'handle_TELEMETRY'),
+    }
 
-        if self.message_id == 121:
-            self.handle_RC_NORMAL(*struct.unpack('=ffffff',
-                                                 self.message_buffer))
+    def dispatchMessage(self):
 
-        if self.message_id == 122:
-            self.handle_ATTITUDE_RADIANS(*struct.unpack('=fff',
-                                                        self.message_buffer))
+        handler = self.HANDLERS.get(self.message_id)
 
-        if self.message_id == 123:
-            self.handle_ACTUATOR_TYPE(*struct.unpack('=B',
-                                                     self.message_buffer))
+        if handler is not None:
+            payload, name = handler
+            if payload is None:
+                getattr(self, name)(bytes(self.message_buffer))
+            else:
+                getattr(self, name)(*payload.unpack(self.message_buffer))
 
-    @abc.abstractmethod
     def handle_RC_NORMAL(self, c1, c2, c3, c4, c5, c6):
         return
 
-    @abc.abstractmethod
     def handle_ATTITUDE_RADIANS(self, roll, pitch, yaw):
         return
 
-    @abc.abstractmethod
     def handle_ACTUATOR_TYPE(self, mtype):
         return
 
+    def handle_PROFILE_STATS(self, stage, nstages, count, minusec, meanusec,
+                             maxusec):
+        return
+
+    def handle_PROFILE_HISTOGRAM(self, b0, b1, b2, b3, b4, b5, b6, b7, b8, b9,
+                                 b10, b11, b12, b13, b14, b15):
+        return
+
+    def handle_TELEMETRY(self, payload):
+        return
+
     @staticmethod
     def serialize_RC_NORMAL_Request():
         msg = '$M<' + chr(0) + chr(121) + chr(121)
@@ -51,8 +76,30 @@ class MspParser(Parser, metaclass=abc.ABCMeta):
         msg = '$M<' + chr(0) + chr(123) + chr(123)
         return bytes(msg, 'utf-8')
 
+    @staticmethod
+    def serialize_PROFILE_STATS_Request():
+        msg = '$M<' + chr(0) + chr(124) + chr(124)
+        return bytes(msg, 'utf-8')
+
+    @staticmethod
+    def serialize_PROFILE_HISTOGRAM_Request():
+        msg = '$M<' + chr(0) + chr(125) + chr(125)
+        return bytes(msg, 'utf-8')
+
     @staticmethod
     def serialize_SET_MOTOR_NORMAL(m1, m2, m3, m4):
-        message_buffer = struct.pack('ffff', m1, m2, m3, m4)
+        message_buffer = MspParser.SET_MOTOR_NORMAL.pack(m1, m2, m3, m4)
         msg = [len(message_buffer), 215] + list(message_buffer)
         return bytes([ord('$'), ord('M'), ord('<')] + msg + [Parser.crc8(msg)])
+
+    @staticmethod
+    def serialize_SET_PROFILE_STAGE(stage):
+        message_buffer = MspParser.SET_PROFILE_STAGE.pack(stage)
+        msg = [len(message_buffer), 216] + list(message_buffer)
+        return bytes([ord('$'), ord('M'), ord('<')] + msg + [Parser.crc8(msg)])
+
+    @staticmethod
+    def serialize_SET_TELEMETRY(topic, divisor):
+        message_buffer = MspParser.SET_TELEMETRY.pack(topic, divisor)
+        msg = [len(message_buffer), 217] + list(message_buffer)
+        return bytes([ord('$'), ord('M'), ord('<')] + msg + [Parser.crc8(msg)])
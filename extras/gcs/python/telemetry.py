@@ -0,0 +1,38 @@
+'''
+Decoder for streamed TELEMETRY frames (see src/telemetry.hpp)
+
+Copyright (C) Simon D. Levy 2021
+
+MIT License
+'''
+
+import struct
+
+ATTITUDE, GYRO, RC, DEMANDS, MOTORS, TIMING = range(6)
+
+# Floats per sample for each topic
+TOPIC_SIZES = (3, 3, 6, 4, 4, 2)
+
+
+def decode(payload):
+    '''
+    Returns sequence number, dropped-sample count, and a dictionary mapping
+    each topic in the frame to a list of per-sample value tuples
+    '''
+
+    sequence, dropped = payload[0], payload[1]
+
+    samples = {}
+
+    k = 2
+
+    while k + 2 <= len(payload):
+        topic, count = payload[k], payload[k+1]
+        k += 2
+        size = TOPIC_SIZES[topic]
+        values = struct.unpack('=' + 'f' * (count * size),
+                               payload[k:k+4*count*size])
+        samples[topic] = [values[j*size:(j+1)*size] for j in range(count)]
+        k += 4 * count * size
+
+    return sequence, dropped, samples
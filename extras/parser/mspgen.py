@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+'''
+Generates MSP message code from messages.json:
+
+  src/mspmessages.hpp             packed structs and a table dispatcher
+  extras/gcs/python/mspparser.py  MspParser with precompiled struct.Struct
+
+Messages with ID < 200 are requests answered by the flight controller;
+messages with ID >= 200 are commands sent to it.  A field of type "bytes"
+marks a variable-length message, for which only the ID is generated.
+
+Usage: python3 mspgen.py  (from this directory)
+
+Copyright (c) 2021 Simon D. Levy
+
+MIT License
+'''
+
+import json
+import os
+from collections import OrderedDict
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+CPP_OUTPUT = os.path.join(HERE, '..', '..', 'src', 'mspmessages.hpp')
+PY_OUTPUT = os.path.join(HERE, '..', 'gcs', 'python', 'mspparser.py')
+
+TYPES = {'float': ('float', 'f', 4), 'byte': ('uint8_t', 'B', 1)}
+
+WARNING = 'Generated by extras/parser/mspgen.py from messages.json; do not edit'
+
+
+class Message:
+
+    def __init__(self, name, entries):
+
+        self.name = name
+        self.id = None
+        self.comment = None
+        self.fields = []
+        self.variable = False
+
+        for entry in entries:
+            key, value = list(entry.items())[0]
+            if key == 'ID':
+                self.id = value
+            elif key == 'comment':
+                self.comment = value
+            elif value == 'bytes':
+                self.variable = True
+            else:
+                self.fields.append((key, value))
+
+        self.isrequest = self.id < 200
+
+        self.size = sum(TYPES[ftype][2] for _, ftype in self.fields)
+
+        self.format = '=' + ''.join(TYPES[ftype][1]
+                                    for _, ftype in self.fields)
+
+    def names(self):
+        return [fname for fname, _ in self.fields]
+
+
+def load():
+
+    with open(os.path.join(HERE, 'messages.json')) as f:
+        data = json.load(f, object_pairs_hook=OrderedDict)
+
+    messages = [Message(name, entries) for name, entries in data.items()]
+
+    return sorted(messages, key=lambda m: m.id)
+
+
+def write_cpp(messages):
+
+    fixed = [m for m in messages if not m.variable]
+
+    out = []
+
+    out.append('''/*
+   MSP message structs and dispatcher
+
+   %s
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace hf {
+
+    namespace msp {
+
+#pragma pack(push, 1)''' % WARNING)
+
+    for m in messages:
+
+        out.append('')
+
+        if m.comment:
+            out.append('        // %s' % m.comment)
+
+        out.append('        struct %s {' % m.name)
+        out.append('')
+        out.append('            static const uint8_t ID = %d;' % m.id)
+
+        if m.fields:
+            out.append('')
+
+        for fname, ftype in m.fields:
+            out.append('            %s %s;' % (TYPES[ftype][0], fname))
+
+        out.append('')
+        out.append('        }; // struct %s' % m.name)
+
+        if not m.variable:
+            out.append('')
+            out.append('        static_assert(sizeof(%s) == %d, '
+                       '"%s must match messages.json");' %
+                       (m.name, m.size, m.name))
+
+    out.append('''
+#pragma pack(pop)
+
+        /**
+          * Calls the handler for a message, given its payload.  For requests
+          * (ID < 200) the handler fills in the reply, which goes out through
+          * Task::sendMessage(); for commands the payload is decoded in one
+          * copy and passed to the handler.  Returns false for unknown IDs.
+          */
+        template <class Task>
+        class Dispatcher {
+
+            private:
+
+                typedef void (*thunk_t)(Task * task, const uint8_t * payload);
+
+                typedef struct {
+
+                    uint8_t id;
+                    thunk_t thunk;
+
+                } entry_t;
+''')
+
+    for m in fixed:
+
+        out.append('                static void on_%s(Task * task, '
+                   'const uint8_t * payload)' % m.name)
+        out.append('                {')
+        out.append('                    %s message = {};' % m.name)
+
+        if m.isrequest:
+            out.append('                    (void)payload;')
+            out.append('                    task->handle_%s_Request(message);'
+                       % m.name)
+            out.append('                    task->sendMessage(message);')
+        else:
+            out.append('                    memcpy(&message, payload, '
+                       'sizeof(message));')
+            out.append('                    task->handle_%s(message);'
+                       % m.name)
+
+        out.append('                }')
+        out.append('')
+
+    out.append('''            public:
+
+                static bool dispatch(Task * task, uint8_t id, const uint8_t * payload)
+                {
+                    static const entry_t TABLE[] = {''')
+
+    for m in fixed:
+        out.append('                        {%s::ID, on_%s},' % (m.name, m.name))
+
+    out.append('''                    };
+
+                    static const uint8_t COUNT = sizeof(TABLE) / sizeof(entry_t);
+
+                    for (uint8_t k=0; k<COUNT; ++k) {
+                        if (TABLE[k].id == id) {
+                            TABLE[k].thunk(task, payload);
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+        }; // class Dispatcher
+
+    } // namespace msp
+
+} // namespace hf''')
+
+    with open(CPP_OUTPUT, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def write_py(messages):
+
+    out = []
+
+    out.append('''#  MSP Parser subclass and message builders
+
+#  %s
+
+#  MIT License
+
+import struct
+
+from msp import Parser
+
+
+class MspParser(Parser):
+''' % WARNING)
+
+    for m in messages:
+        if not m.variable:
+            out.append('    %s = struct.Struct(\'%s\')' % (m.name, m.format))
+
+    out.append('''
+    # Message ID => (payload struct or None for raw bytes, handler name)
+    HANDLERS = {''')
+
+    for m in messages:
+        if m.isrequest:
+            out.append('        %d: (%s, \'handle_%s\'),' %
+                       (m.id, 'None' if m.variable else m.name, m.name))
+
+    out.append('''    }
+
+    def dispatchMessage(self):
+
+        handler = self.HANDLERS.get(self.message_id)
+
+        if handler is not None:
+            payload, name = handler
+            if payload is None:
+                getattr(self, name)(bytes(self.message_buffer))
+            else:
+                getattr(self, name)(*payload.unpack(self.message_buffer))''')
+
+    for m in messages:
+        if m.isrequest:
+            out.append('')
+            args = ['self'] + (['payload'] if m.variable else m.names())
+            out.append(wrap_def('handle_%s' % m.name, args, 4))
+            out.append('        return')
+
+    for m in messages:
+        if m.variable:
+            continue
+        out.append('')
+        out.append('    @staticmethod')
+        if m.isrequest:
+            out.append('    def serialize_%s_Request():' % m.name)
+            out.append("        msg = '$M<' + chr(0) + chr(%d) + chr(%d)" %
+                       (m.id, m.id))
+            out.append("        return bytes(msg, 'utf-8')")
+        else:
+            out.append(wrap_def('serialize_%s' % m.name, m.names(), 4))
+            out.append('        message_buffer = MspParser.%s.pack(%s)' %
+                       (m.name, ', '.join(m.names())))
+            out.append('        msg = [len(message_buffer), %d] + '
+                       'list(message_buffer)' % m.id)
+            out.append("        return bytes([ord('$'), ord('M'), ord('<')] "
+                       "+ msg + [Parser.crc8(msg)])")
+
+    with open(PY_OUTPUT, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def wrap_def(name, args, indent):
+
+    # Keep within 79 columns for flake8
+    line = ' ' * indent + 'def %s(%s):' % (name, ', '.join(args))
+
+    if len(line) <= 79:
+        return line
+
+    lead = ' ' * indent + 'def %s(' % name
+    lines = []
+    current = lead
+
+    for k, arg in enumerate(args):
+        piece = arg + (', ' if k < len(args)-1 else '):')
+        if len(current) + len(piece.rstrip()) > 79:
+            lines.append(current.rstrip())
+            current = ' ' * len(lead)
+        current += piece
+
+    lines.append(current)
+
+    return '\n'.join(lines)
+
+
+def main():
+
+    messages = load()
+
+    write_cpp(messages)
+    write_py(messages)
+
+
+main()
@@ -0,0 +1,379 @@
+/*
+   PID auto-tuner: searches over the RatePid, YawPid, and LevelPid gains
+   with a parallel Nelder-Mead simplex, scoring each candidate by flying
+   a batch of step and disturbance responses through the real controller
+   classes in SITL, and prints the tuned constructor calls
+
+   Gains are searched as log multiples of the hand-tuned ones, so they
+   stay positive and each gets the same relative step.  Each Nelder-Mead
+   iteration scores its reflection, expansion, and both contraction points
+   at once, so that all of their flights can run in parallel on the
+   work-stealing pool.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "sitl.hpp"
+#include "workpool.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const double DT = 0.001;
+static const double DURATION = 10.0;
+static const float THROTTLE = 0.14f;
+
+// As in LevelPid: a roll/pitch demand of 0.5 asks for 45 degrees
+static const float DEMAND_TO_ANGLE = 2 * (float)M_PI / 4;
+
+// Beyond this we call the flight a crash
+static const float MAX_ANGLE = 1.2f;
+
+// Cost = time-weighted absolute error + these weights times
+// saturation (fraction of updates) and motor activity (mean change per update)
+static const double SATURATION_WEIGHT = 10;
+static const double ACTIVITY_WEIGHT = 100;
+static const double CRASH_COST = 1000;
+
+// Rate Kp, Ki, Kd; Yaw Kp, Ki; Level Kp
+static const uint8_t NGAINS = 6;
+static const float NOMINAL[NGAINS] = {0.225f, 0.001875f, 0.375f, 2, 0.1f, 0.20f};
+
+// Search space bounds and initial simplex size, in log units
+static const float MAX_LOG_GAIN = 5;
+static const float INITIAL_STEP = 0.5f;
+
+typedef struct {
+
+    const char * name;
+    float roll, pitch, yaw; // sticks
+    float phi, theta;       // initial attitude
+    float dphi, dtheta;     // initial angular velocity
+
+} scenario_t;
+
+static const scenario_t SCENARIOS[] = {
+    {"Roll step",   0.5f, 0,    0,    0,     0,     0,     0},
+    {"Pitch step",  0,    0.5f, 0,    0,     0,     0,     0},
+    {"Yaw step",    0,    0,    0.5f, 0,     0,     0,     0},
+    {"Tilted",      0,    0,    0,    0.3f, -0.2f,  0,     0},
+    {"Tumbling",    0,    0,    0,    0,     0,     1.0f, -1.0f},
+};
+
+static const uint8_t NSCENARIOS = sizeof(SCENARIOS) / sizeof(scenario_t);
+
+// Each scenario is flown by an ideal vehicle and by one with motor lag and sensor noise
+static const uint8_t NVEHICLES = 2;
+
+static const uint8_t NFLIGHTS = NSCENARIOS * NVEHICLES;
+
+typedef std::vector<float> params_t;
+
+static float gain(const params_t & params, uint8_t index)
+{
+    return NOMINAL[index] * expf(params[index]);
+}
+
+static double fly(const params_t & params, uint8_t flight)
+{
+    const scenario_t & scenario = SCENARIOS[flight / NVEHICLES];
+    bool ideal = flight % NVEHICLES == 0;
+
+    hf::RatePid ratePid(gain(params, 0), gain(params, 1), gain(params, 2));
+    hf::YawPid yawPid(gain(params, 3), gain(params, 4));
+    hf::LevelPid levelPid(gain(params, 5));
+
+    hf::vehicle_params_t vehicle;
+    vehicle.motortau = ideal ? 0 : 0.03f;
+
+    hf::Sitl sitl(DT, 1.0, vehicle);
+
+    sitl.hackflight.addClosedLoopController(&levelPid);
+    sitl.hackflight.addClosedLoopController(&ratePid);
+    sitl.hackflight.addClosedLoopController(&yawPid);
+
+    if (!ideal) {
+        sitl.sensors.setNoise(0.005f, 0.02f, flight);
+    }
+
+    sitl.begin();
+
+    sitl.dynamics.setAttitude(scenario.phi, scenario.theta, 0);
+    sitl.dynamics.x[hf::State::DPHI] = scenario.dphi;
+    sitl.dynamics.x[hf::State::DTHETA] = scenario.dtheta;
+    sitl.dynamics.setAirborne(100);
+
+    sitl.receiver.setSticks(THROTTLE, scenario.roll, scenario.pitch, scenario.yaw, +1);
+
+    double error = 0;
+    uint32_t steps = 0;
+    uint32_t saturated = 0;
+    double activity = 0;
+    float prevMotors[hf::Dynamics::NMOTORS] = {};
+
+    while (sitl.time() < DURATION) {
+
+        sitl.step();
+
+        const float * x = sitl.state();
+
+        if (fabsf(x[hf::State::PHI]) > MAX_ANGLE || fabsf(x[hf::State::THETA]) > MAX_ANGLE) {
+            return CRASH_COST;
+        }
+
+        float demands[4] = {};
+        sitl.receiver.readDemands(demands);
+
+        // Pitch demand is positive for stick forward, pitch angle for nose up
+        double e = fabs(x[hf::State::PHI] - demands[hf::DEMANDS_ROLL] * DEMAND_TO_ANGLE) +
+                   fabs(x[hf::State::THETA] + demands[hf::DEMANDS_PITCH] * DEMAND_TO_ANGLE) +
+                   fabs(x[hf::State::DPSI] - demands[hf::DEMANDS_YAW]);
+
+        error += sitl.time() * e * DT;
+
+        const float * motors = sitl.motors.values();
+        bool saturating = false;
+        for (uint8_t k=0; k<hf::Dynamics::NMOTORS; ++k) {
+            saturating |= motors[k] <= 0 || motors[k] >= 1;
+            if (steps) {
+                activity += fabsf(motors[k] - prevMotors[k]);
+            }
+            prevMotors[k] = motors[k];
+        }
+        saturated += saturating;
+        steps++;
+    }
+
+    return error + (SATURATION_WEIGHT * saturated + ACTIVITY_WEIGHT * activity) / steps;
+}
+
+class Tuner {
+
+    private:
+
+        hf::WorkStealingPool & _pool;
+
+        uint32_t _evaluations = 0;
+
+    public:
+
+        Tuner(hf::WorkStealingPool & pool)
+            : _pool(pool)
+        {
+        }
+
+        // Scores several candidates at once, spreading all of their flights over the pool
+        std::vector<double> score(const std::vector<params_t> & candidates, std::vector<double> * perFlight=NULL)
+        {
+            std::vector<double> flights(candidates.size() * NFLIGHTS);
+
+            _pool.run(flights.size(), [&](uint32_t job) {
+                flights[job] = fly(candidates[job / NFLIGHTS], job % NFLIGHTS);
+            });
+
+            std::vector<double> costs(candidates.size());
+
+            for (size_t j=0; j<flights.size(); ++j) {
+                costs[j / NFLIGHTS] += flights[j];
+            }
+
+            if (perFlight) {
+                *perFlight = flights;
+            }
+
+            _evaluations += candidates.size();
+
+            return costs;
+        }
+
+        uint32_t evaluations(void)
+        {
+            return _evaluations;
+        }
+
+}; // class Tuner
+
+static params_t combine(const params_t & a, const params_t & b, float t)
+{
+    // a + t * (b - a), clamped to the search space
+    params_t c(a.size());
+
+    for (size_t k=0; k<a.size(); ++k) {
+        c[k] = fmaxf(-MAX_LOG_GAIN, fminf(+MAX_LOG_GAIN, a[k] + t * (b[k] - a[k])));
+    }
+
+    return c;
+}
+
+static void nelderMead(Tuner & tuner, params_t & best, double & bestCost, uint32_t iterations)
+{
+    const size_t n = NGAINS;
+
+    std::vector<params_t> simplex(n+1, params_t(n));
+
+    for (size_t k=0; k<n; ++k) {
+        simplex[k+1][k] = INITIAL_STEP;
+    }
+
+    std::vector<double> costs = tuner.score(simplex);
+
+    std::vector<size_t> order(n+1);
+
+    for (uint32_t it=0; it<iterations; ++it) {
+
+        for (size_t k=0; k<=n; ++k) {
+            order[k] = k;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return costs[a] < costs[b]; });
+
+        size_t ibest = order[0], iworst = order[n];
+        double fbest = costs[ibest], fsecond = costs[order[n-1]], fworst = costs[iworst];
+
+        if (it % 10 == 0) {
+            printf("Iteration %4u: %5u candidates scored, best cost %8.4f\n", it, tuner.evaluations(), fbest);
+            fflush(stdout);
+        }
+
+        if (fworst - fbest < 1e-4 * fbest) {
+            break;
+        }
+
+        params_t centroid(n);
+        for (size_t k=0; k<=n; ++k) {
+            if (k != iworst) {
+                for (size_t d=0; d<n; ++d) {
+                    centroid[d] += simplex[k][d] / n;
+                }
+            }
+        }
+
+        // Reflection, expansion, outside and inside contraction
+        std::vector<params_t> trials = {
+            combine(centroid, simplex[iworst], -1),
+            combine(centroid, simplex[iworst], -2),
+            combine(centroid, simplex[iworst], -0.5f),
+            combine(centroid, simplex[iworst], +0.5f)
+        };
+
+        std::vector<double> f = tuner.score(trials);
+
+        int accept = -1;
+
+        if (f[0] < fbest) {
+            accept = f[1] < f[0] ? 1 : 0;
+        }
+        else if (f[0] < fsecond) {
+            accept = 0;
+        }
+        else if (f[0] < fworst) {
+            accept = f[2] <= f[0] ? 2 : -1;
+        }
+        else {
+            accept = f[3] < fworst ? 3 : -1;
+        }
+
+        if (accept >= 0) {
+            simplex[iworst] = trials[accept];
+            costs[iworst] = f[accept];
+            continue;
+        }
+
+        // Shrink toward the best
+        std::vector<params_t> shrunk;
+        for (size_t k=0; k<=n; ++k) {
+            if (k != ibest) {
+                simplex[k] = combine(simplex[ibest], simplex[k], 0.5f);
+                shrunk.push_back(simplex[k]);
+            }
+        }
+
+        std::vector<double> g = tuner.score(shrunk);
+        for (size_t k=0, j=0; k<=n; ++k) {
+            if (k != ibest) {
+                costs[k] = g[j++];
+            }
+        }
+    }
+
+    size_t ibest = std::min_element(costs.begin(), costs.end()) - costs.begin();
+
+    best = simplex[ibest];
+    bestCost = costs[ibest];
+}
+
+static void reportFlights(const char * label, const std::vector<double> & flights)
+{
+    printf("%-10s", label);
+
+    for (uint8_t s=0; s<NSCENARIOS; ++s) {
+        double cost = 0;
+        for (uint8_t v=0; v<NVEHICLES; ++v) {
+            cost += flights[s*NVEHICLES + v];
+        }
+        printf(" %12.4f", cost);
+    }
+
+    printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+    // Nelder-Mead iterations, threads (default all cores)
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned nthreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+
+    nthreads = nthreads ? nthreads : 1;
+
+    hf::WorkStealingPool pool(nthreads);
+
+    Tuner tuner(pool);
+
+    auto start = std::chrono::steady_clock::now();
+
+    params_t best(NGAINS);
+    double bestCost = 0;
+
+    nelderMead(tuner, best, bestCost, iterations);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> nominalFlights, tunedFlights;
+    double nominalCost = tuner.score({params_t(NGAINS)}, &nominalFlights)[0];
+    tuner.score({best}, &tunedFlights);
+
+    printf("\nScored %u candidates (%u flights) on %u threads in %3.1f sec\n\n",
+            tuner.evaluations(), tuner.evaluations() * NFLIGHTS, nthreads, wall);
+
+    printf("%-10s", "Cost");
+    for (uint8_t s=0; s<NSCENARIOS; ++s) {
+        printf(" %12s", SCENARIOS[s].name);
+    }
+    printf("\n");
+    reportFlights("Nominal", nominalFlights);
+    reportFlights("Tuned", tunedFlights);
+
+    printf("\nTotal cost %3.4f => %3.4f\n\n", nominalCost, bestCost);
+
+    printf("static hf::RatePid ratePid = hf::RatePid(%.4g, %.4g, %.4g);\n", gain(best, 0), gain(best, 1), gain(best, 2));
+    printf("static hf::YawPid yawPid = hf::YawPid(%.4g, %.4g);\n", gain(best, 3), gain(best, 4));
+    printf("static hf::LevelPid levelPid = hf::LevelPid(%.6ff);\n", gain(best, 5));
+
+    return 0;
+}
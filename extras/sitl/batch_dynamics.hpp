@@ -0,0 +1,255 @@
+/*
+   Batched rigid-body dynamics: the same X-configuration quadcopter model
+   as Dynamics, for many vehicles at once
+
+   Each state variable and motor value is stored as one contiguous array
+   across the vehicles (structure of arrays), and the update is a single
+   branch-free loop over vehicles, so the compiler can vectorize it.  Build
+   with -O3 -fno-trapping-math, which lets GCC turn the selects into vector
+   blends without changing any results.  Sines and cosines come from a
+   polynomial rather than sinf()/cosf(), which compilers won't vectorize
+   without -ffast-math (GCC also fuses them into a scalar sincos call).
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "state.hpp"
+#include "dynamics.hpp"
+
+namespace hf {
+
+    class BatchDynamics {
+
+        public:
+
+            static const uint8_t NMOTORS = Dynamics::NMOTORS;
+
+        private:
+
+            static constexpr float G = 9.80665f;
+
+            // Arrays start on 64-byte boundaries relative to each other
+            static const uint32_t LANES = 16;
+
+            // State, commanded motor values, spin rates, airborne flag (0 or 1)
+            static const uint8_t NARRAYS = State::SIZE + 2*NMOTORS + 1;
+
+            static const uint8_t MOTORS = State::SIZE;
+            static const uint8_t OMEGAS = MOTORS + NMOTORS;
+            static const uint8_t AIRBORNE = OMEGAS + NMOTORS;
+
+            vehicle_params_t _p;
+
+            uint32_t _count = 0;
+            uint32_t _stride = 0;
+
+            std::vector<float> _data;
+
+            float * array(uint8_t index)
+            {
+                return &_data[index * _stride];
+            }
+
+            // Reduces to [-pi/2,+pi/2], then Taylor series to x^11: error < 1e-7
+            static float fastsin(float x)
+            {
+                const float pi = (float)M_PI;
+
+                float k = (float)(int32_t)(x * (0.5f / pi) + (x < 0 ? -0.5f : +0.5f));
+                x -= k * 2 * pi;
+
+                x = x > pi/2 ? pi - x : x;
+                x = x < -pi/2 ? -pi - x : x;
+
+                float x2 = x * x;
+
+                return x * (1 + x2 * (-1.f/6 + x2 * (1.f/120 + x2 * (-1.f/5040 +
+                                x2 * (1.f/362880 + x2 * (-1.f/39916800))))));
+            }
+
+            static float fastcos(float x)
+            {
+                return fastsin(x + (float)M_PI / 2);
+            }
+
+        public:
+
+            BatchDynamics(uint32_t count, const vehicle_params_t & params = vehicle_params_t())
+            {
+                _p = params;
+                _count = count;
+                _stride = (count + LANES - 1) / LANES * LANES;
+                _data.resize(NARRAYS * _stride);
+            }
+
+            uint32_t size(void)
+            {
+                return _count;
+            }
+
+            // One state variable (State::X ... State::DPSI) for every vehicle
+            float * x(uint8_t index)
+            {
+                return array(index);
+            }
+
+            // Motor values in [0,1] for every vehicle, read by update()
+            float * motors(uint8_t index)
+            {
+                return array(MOTORS + index);
+            }
+
+            // Copies one vehicle's state out in hf::State layout
+            void getState(uint32_t vehicle, float * state)
+            {
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    state[k] = array(k)[vehicle];
+                }
+            }
+
+            void reset(void)
+            {
+                memset(&_data[0], 0, _data.size() * sizeof(float));
+            }
+
+            void reset(uint32_t vehicle)
+            {
+                for (uint8_t k=0; k<NARRAYS; ++k) {
+                    array(k)[vehicle] = 0;
+                }
+            }
+
+            // Sets the initial attitude (radians); vehicle is considered airborne
+            void setAttitude(uint32_t vehicle, float phi, float theta, float psi)
+            {
+                array(State::PHI)[vehicle] = phi;
+                array(State::THETA)[vehicle] = theta;
+                array(State::PSI)[vehicle] = psi;
+                array(AIRBORNE)[vehicle] = 1;
+            }
+
+            void setAirborne(uint32_t vehicle, float altitude)
+            {
+                array(State::Z)[vehicle] = altitude;
+                array(AIRBORNE)[vehicle] = 1;
+            }
+
+            // Advances every vehicle by dt seconds; see Dynamics::update()
+            void update(float dt)
+            {
+                const float alpha = _p.motortau > 0 ? dt / (_p.motortau + dt) : 1;
+                const float rpm2rad = _p.maxrpm * (float)M_PI / 30;
+                const float lx = _p.l * (float)M_SQRT1_2;
+                const float b = _p.b, d = _p.d, m = _p.m;
+                const float Ix = _p.Ix, Iy = _p.Iy, Iz = _p.Iz;
+                const float pi = (float)M_PI;
+
+                float * x = array(State::X);
+                float * dx = array(State::DX);
+                float * y = array(State::Y);
+                float * dy = array(State::DY);
+                float * z = array(State::Z);
+                float * dz = array(State::DZ);
+                float * phi = array(State::PHI);
+                float * dphi = array(State::DPHI);
+                float * theta = array(State::THETA);
+                float * dtheta = array(State::DTHETA);
+                float * psi = array(State::PSI);
+                float * dpsi = array(State::DPSI);
+
+                const float * m1 = array(MOTORS);
+                const float * m2 = array(MOTORS+1);
+                const float * m3 = array(MOTORS+2);
+                const float * m4 = array(MOTORS+3);
+
+                float * w1 = array(OMEGAS);
+                float * w2 = array(OMEGAS+1);
+                float * w3 = array(OMEGAS+2);
+                float * w4 = array(OMEGAS+3);
+
+                float * airborne = array(AIRBORNE);
+
+                const uint32_t count = _count;
+
+                // The arrays never overlap
+#if defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+                for (uint32_t i=0; i<count; ++i) {
+
+                    w1[i] += alpha * (m1[i] * rpm2rad - w1[i]);
+                    w2[i] += alpha * (m2[i] * rpm2rad - w2[i]);
+                    w3[i] += alpha * (m3[i] * rpm2rad - w3[i]);
+                    w4[i] += alpha * (m4[i] * rpm2rad - w4[i]);
+
+                    float o1 = w1[i]*w1[i], o2 = w2[i]*w2[i], o3 = w3[i]*w3[i], o4 = w4[i]*w4[i];
+
+                    float u1 = b * (o1 + o2 + o3 + o4);
+                    float u2 = lx * b * (o3 + o4 - o1 - o2);
+                    float u3 = lx * b * (o2 + o4 - o1 - o3);
+                    float u4 = d * (o2 + o3 - o1 - o4);
+
+                    float cph = fastcos(phi[i]), sph = fastsin(phi[i]);
+                    float cth = fastcos(theta[i]), sth = fastsin(theta[i]);
+                    float cps = fastcos(psi[i]), sps = fastsin(psi[i]);
+
+                    float ddx = (cph*sth*cps + sph*sps) * u1 / m;
+                    float ddy = (cph*sth*sps - sph*cps) * u1 / m;
+                    float ddz = cph*cth * u1 / m - G;
+
+                    float ddphi = dtheta[i]*dpsi[i]*(Iy-Iz)/Ix + u2/Ix;
+                    float ddtheta = dphi[i]*dpsi[i]*(Iz-Ix)/Iy + u3/Iy;
+                    float ddpsi = dphi[i]*dtheta[i]*(Ix-Iy)/Iz + u4/Iz;
+
+                    // On the ground, nothing moves until thrust exceeds weight
+                    float flying = ddz > 0 ? 1.f : airborne[i];
+                    float fdt = flying * dt;
+
+                    dx[i] += ddx * fdt;
+                    dy[i] += ddy * fdt;
+                    dz[i] += ddz * fdt;
+                    dphi[i] += ddphi * fdt;
+                    dtheta[i] += ddtheta * fdt;
+                    dpsi[i] += ddpsi * fdt;
+
+                    x[i] += dx[i] * fdt;
+                    y[i] += dy[i] * fdt;
+                    z[i] += dz[i] * fdt;
+                    phi[i] += dphi[i] * fdt;
+                    theta[i] += dtheta[i] * fdt;
+
+                    // Keep heading in [-pi,+pi]
+                    float h = psi[i] + dpsi[i] * fdt;
+                    h -= h > pi ? 2*pi : 0;
+                    h += h < -pi ? 2*pi : 0;
+                    psi[i] = h;
+
+                    // Landing resets everything but heading
+                    float up = z[i] < 0 ? 0.f : 1.f;
+
+                    x[i] *= up; dx[i] *= up;
+                    y[i] *= up; dy[i] *= up;
+                    z[i] *= up; dz[i] *= up;
+                    phi[i] *= up; dphi[i] *= up;
+                    theta[i] *= up; dtheta[i] *= up;
+                    dpsi[i] *= up;
+                    w1[i] *= up; w2[i] *= up; w3[i] *= up; w4[i] *= up;
+
+                    airborne[i] = flying * up;
+                }
+            }
+
+    }; // class BatchDynamics
+
+} // namespace hf
@@ -0,0 +1,98 @@
+/*
+   Checks BatchDynamics against the scalar Dynamics model, then reports
+   how many vehicle updates per millisecond each can do on one core
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "dynamics.hpp"
+#include "batch_dynamics.hpp"
+
+static const float DT = 0.001f;
+
+// Near hover for the default vehicle, with some spread between vehicles and motors
+static const float HOVER = 0.556f;
+static const float SPREAD = 0.002f;
+
+static float motorValue(uint32_t vehicle, uint8_t motor, uint32_t step)
+{
+    return HOVER + SPREAD * sinf(0.001f * step * (1 + vehicle % 7) + motor);
+}
+
+int main(int argc, char ** argv)
+{
+    // Vehicles, steps
+    uint32_t count = argc > 1 ? atoi(argv[1]) : 4096;
+    uint32_t steps = argc > 2 ? atoi(argv[2]) : 1000;
+
+    hf::vehicle_params_t params;
+    params.motortau = 0.02f;
+
+    hf::BatchDynamics batch(count, params);
+    std::vector<hf::Dynamics> scalar(count, hf::Dynamics(params));
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(-0.2f, +0.2f);
+
+    for (uint32_t v=0; v<count; ++v) {
+        float phi = uniform(rng), theta = uniform(rng), psi = 10 * uniform(rng);
+        batch.setAttitude(v, phi, theta, psi);
+        batch.setAirborne(v, 10);
+        scalar[v].reset();
+        scalar[v].setAttitude(phi, theta, psi);
+        scalar[v].setAirborne(10);
+    }
+
+    double batchTime = 0, scalarTime = 0;
+
+    for (uint32_t s=0; s<steps; ++s) {
+
+        for (uint8_t k=0; k<hf::BatchDynamics::NMOTORS; ++k) {
+            float * motors = batch.motors(k);
+            for (uint32_t v=0; v<count; ++v) {
+                motors[v] = motorValue(v, k, s);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        batch.update(DT);
+        batchTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        float motors[hf::Dynamics::NMOTORS] = {};
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t v=0; v<count; ++v) {
+            for (uint8_t k=0; k<hf::Dynamics::NMOTORS; ++k) {
+                motors[k] = motorValue(v, k, s);
+            }
+            scalar[v].update(motors, DT);
+        }
+        scalarTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Same math in a different order (and possibly vector trig), so compare loosely
+    float maxdiff = 0;
+    for (uint32_t v=0; v<count; ++v) {
+        float x[hf::State::SIZE] = {};
+        batch.getState(v, x);
+        for (uint8_t k=0; k<hf::State::SIZE; ++k) {
+            maxdiff = fmaxf(maxdiff, fabsf(x[k] - scalar[v].x[k]));
+        }
+    }
+
+    printf("%u vehicles, %u steps of %3.3f sec\n", count, steps, DT);
+    printf("Max state difference from scalar model: %g\n", maxdiff);
+    printf("Batch:  %10.0f vehicle updates/msec\n", count * (double)steps / batchTime / 1000);
+    printf("Scalar: %10.0f vehicle updates/msec\n", count * (double)steps / scalarTime / 1000);
+
+    return maxdiff < 1e-3f ? 0 : 1;
+}
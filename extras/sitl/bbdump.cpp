@@ -0,0 +1,71 @@
+/*
+   Prints a blackbox log as CSV: time, state, receiver channels and
+   demands, each controller's output demands, and motor values
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+
+#include "blackbox_file.hpp"
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s LOGFILE\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+
+    if (!hf::loadBlackboxFile(argv[1], data)) {
+        fprintf(stderr, "Unable to open %s\n", argv[1]);
+        return 1;
+    }
+
+    hf::BlackboxReader reader(data.data(), data.size());
+
+    hf::BlackboxReader::record_t record = {};
+
+    bool header = true;
+
+    while (reader.next(record)) {
+
+        if (header) {
+            printf("time,x,dx,y,dy,z,dz,phi,dphi,theta,dtheta,psi,dpsi,"
+                    "c1,c2,c3,c4,c5,c6,throttle,roll,pitch,yaw");
+            for (uint8_t j=0; j<record.ncontrollers; ++j) {
+                printf(",pid%d_throttle,pid%d_roll,pid%d_pitch,pid%d_yaw", j, j, j, j);
+            }
+            for (uint8_t k=0; k<record.nmotors; ++k) {
+                printf(",m%d", k+1);
+            }
+            printf("\n");
+            header = false;
+        }
+
+        printf("%f", record.time);
+        for (uint8_t k=0; k<hf::State::SIZE; ++k) {
+            printf(",%g", record.x[k]);
+        }
+        for (uint8_t k=0; k<6; ++k) {
+            printf(",%g", record.channels[k]);
+        }
+        for (uint8_t k=0; k<4; ++k) {
+            printf(",%g", record.demands[k]);
+        }
+        for (uint8_t j=0; j<record.ncontrollers; ++j) {
+            for (uint8_t k=0; k<4; ++k) {
+                printf(",%g", record.controllers[j][k]);
+            }
+        }
+        for (uint8_t k=0; k<record.nmotors; ++k) {
+            printf(",%g", record.motors[k]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
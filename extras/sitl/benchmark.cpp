@@ -0,0 +1,181 @@
+/*
+   Compares the per-loop cost of the dynamic (virtual-dispatch) Hackflight
+   class with the StaticHackflight template, flying the same SITL flight
+   through the same Level/Rate/Yaw PID chain with each.  The level
+   controller runs only in level mode (AUX2 up), which the flight leaves
+   now and then.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "sitl.hpp"
+#include "static_hackflight.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const double DT = 0.001;
+
+// Same vehicle as hf::Sitl, but composed at compile time
+class StaticSitl {
+
+    public:
+
+        hf::SimBoard board;
+
+        hf::SimReceiver receiver;
+
+        hf::SimMotors motors;
+
+        hf::StaticMixerQuadXMW mixer;
+
+        hf::Dynamics dynamics;
+
+        hf::SimSensors sensors;
+
+        hf::LevelPid levelPid = hf::LevelPid(0.20f);
+        hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid = hf::YawPid(2, 0.1);
+
+        hf::SensorList<hf::SimSensors> sensorList;
+
+        typedef hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllers_t;
+
+        controllers_t controllerList;
+
+        hf::StaticHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW,
+            decltype(sensorList), decltype(controllerList)> hackflight;
+
+        StaticSitl(void)
+            : receiver(&board),
+              motors(hf::Dynamics::NMOTORS),
+              mixer(&motors),
+              sensors(&dynamics),
+              sensorList(sensors),
+              controllerList(levelMode(controllers_t(levelPid, ratePid, yawPid), levelPid)),
+              hackflight(&board, receiver, mixer, sensorList, controllerList)
+        {
+        }
+
+        // The Hackflight copies the list, so this has to come first
+        static controllers_t levelMode(controllers_t controllers, hf::LevelPid & levelPid)
+        {
+            controllers.setModeIndex(&levelPid, 1);
+            return controllers;
+        }
+
+        void begin(void)
+        {
+            dynamics.reset();
+            hackflight.begin(true);
+        }
+
+        void step(void)
+        {
+            hackflight.update();
+            dynamics.update(motors.values(), DT);
+            board.step(DT);
+        }
+
+        double time(void)
+        {
+            return board.time();
+        }
+
+}; // class StaticSitl
+
+// Climb, then alternate roll and pitch steps, leaving level mode between
+// some of them
+static void setSticks(hf::SimReceiver & receiver, double t)
+{
+    float throttle = t < 2 ? 0.3f : 0.14f;
+    float roll = fmod(t, 4) > 2 && fmod(t, 8) < 4 ? 0.5f : 0;
+    float pitch = fmod(t, 4) > 2 && fmod(t, 8) > 4 ? 0.5f : 0;
+    float aux2 = fmod(t, 8) > 4 && fmod(t, 8) < 6 ? -1 : +1;
+
+    receiver.setSticks(throttle, roll, pitch, 0, +1, aux2);
+}
+
+template <typename Vehicle>
+static double fly(Vehicle & vehicle, uint32_t steps, float * motorLog)
+{
+    vehicle.begin();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<steps; ++k) {
+        setSticks(vehicle.receiver, vehicle.time());
+        vehicle.step();
+        motorLog[k] = vehicle.motors.values()[0];
+    }
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+static double flyDynamicsOnly(uint32_t steps)
+{
+    hf::Dynamics dynamics;
+    float motors[4] = {0.6f, 0.6f, 0.6f, 0.6f};
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<steps; ++k) {
+        motors[k%4] = 0.55f + (k%7) * 0.01f;
+        dynamics.update(motors, DT);
+    }
+
+    double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps;
+
+    // Keep the optimizer from discarding the loop
+    return dynamics.x[hf::State::Z] == 12345 ? 0 : nsec;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t steps = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    float * dynamicMotors = new float [steps];
+    float * staticMotors = new float [steps];
+
+    static hf::Sitl dynamicSitl(DT);
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+    hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+    hf::YawPid yawPid = hf::YawPid(2, 0.1);
+    dynamicSitl.hackflight.addClosedLoopController(&levelPid, 1);
+    dynamicSitl.hackflight.addClosedLoopController(&ratePid);
+    dynamicSitl.hackflight.addClosedLoopController(&yawPid);
+
+    static StaticSitl staticSitl;
+
+    double physics = flyDynamicsOnly(steps);
+    double dynamicLoop = fly(dynamicSitl, steps, dynamicMotors) - physics;
+    double staticLoop = fly(staticSitl, steps, staticMotors) - physics;
+
+    float maxdiff = 0;
+    for (uint32_t k=0; k<steps; ++k) {
+        maxdiff = fmax(maxdiff, fabs(dynamicMotors[k] - staticMotors[k]));
+    }
+
+    printf("%u loops, %3.1f nsec/step of physics subtracted\n", steps, physics);
+    printf("Hackflight:       %6.1f nsec/loop\n", dynamicLoop);
+    printf("StaticHackflight: %6.1f nsec/loop (%3.2fx)\n", staticLoop, dynamicLoop / staticLoop);
+    printf("Max motor difference: %g\n", maxdiff);
+
+    delete[] dynamicMotors;
+    delete[] staticMotors;
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+   Blackbox support for software-in-the-loop (SITL) testing: sinks that
+   write the log to a file or to memory, and a reader that decodes it
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "blackbox.hpp"
+
+namespace hf {
+
+    class BlackboxFileSink : public BlackboxSink {
+
+        private:
+
+            FILE * _fp = NULL;
+
+        public:
+
+            BlackboxFileSink(const char * filename)
+            {
+                _fp = fopen(filename, "wb");
+            }
+
+            ~BlackboxFileSink(void)
+            {
+                if (_fp) {
+                    fclose(_fp);
+                }
+            }
+
+            bool ok(void)
+            {
+                return _fp != NULL;
+            }
+
+            virtual void write(const uint8_t * data, uint16_t size) override
+            {
+                if (_fp) {
+                    fwrite(data, 1, size, _fp);
+                }
+            }
+
+    }; // class BlackboxFileSink
+
+    // Keeps the log in memory, e.g. for comparing against another log
+    class BlackboxMemorySink : public BlackboxSink {
+
+        public:
+
+            std::vector<uint8_t> data;
+
+            virtual void write(const uint8_t * bytes, uint16_t size) override
+            {
+                data.insert(data.end(), bytes, bytes+size);
+            }
+
+    }; // class BlackboxMemorySink
+
+    inline bool loadBlackboxFile(const char * filename, std::vector<uint8_t> & data)
+    {
+        FILE * fp = fopen(filename, "rb");
+
+        if (!fp) {
+            return false;
+        }
+
+        uint8_t buf[4096];
+        size_t n = 0;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            data.insert(data.end(), buf, buf+n);
+        }
+
+        fclose(fp);
+
+        return true;
+    }
+
+    class BlackboxReader {
+
+        public:
+
+            typedef struct {
+
+                double time;
+                float x[State::SIZE];
+                float channels[6];
+                float demands[4];
+                uint8_t ncontrollers;
+                float controllers[Blackbox::MAXCONTROLLERS][4];
+                uint8_t nmotors;
+                float motors[Blackbox::MAXMOTORS];
+
+            } record_t;
+
+        private:
+
+            const uint8_t * _data = NULL;
+            size_t _size = 0;
+            size_t _pos = 0;
+
+            bool _synced = false;
+            uint8_t _ncontrollers = 0;
+            uint8_t _nmotors = 0;
+            uint32_t _prev[Blackbox::MAXFIELDS] = {};
+
+            bool getVarint(uint32_t & value)
+            {
+                value = 0;
+
+                for (uint8_t shift=0; shift<35; shift+=7) {
+
+                    if (_pos == _size) {
+                        return false;
+                    }
+
+                    uint8_t byte = _data[_pos++];
+
+                    value |= (uint32_t)(byte & 0x7F) << shift;
+
+                    if (!(byte & 0x80)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            static float real(uint32_t bits)
+            {
+                float value = 0;
+                memcpy(&value, &bits, 4);
+                return value;
+            }
+
+        public:
+
+            BlackboxReader(const uint8_t * data, size_t size)
+            {
+                _data = data;
+                _size = size;
+            }
+
+            // Returns false at the end of the log
+            bool next(record_t & record)
+            {
+                while (_pos < _size) {
+
+                    uint8_t tag = _data[_pos++];
+
+                    if (tag == Blackbox::KEYFRAME && _pos + 2 <= _size &&
+                            _data[_pos] <= Blackbox::MAXCONTROLLERS && _data[_pos+1] <= Blackbox::MAXMOTORS) {
+                        _ncontrollers = _data[_pos++];
+                        _nmotors = _data[_pos++];
+                        memset(_prev, 0, sizeof(_prev));
+                        _synced = true;
+                    }
+                    else if (tag != Blackbox::DELTA || !_synced) {
+                        // Not at a record we can decode: look for a keyframe
+                        _synced = false;
+                        continue;
+                    }
+
+                    uint8_t nfields = Blackbox::fieldCount(_ncontrollers, _nmotors);
+
+                    uint32_t fields[Blackbox::MAXFIELDS] = {};
+
+                    bool complete = true;
+
+                    for (uint8_t k=0; k<nfields && complete; ++k) {
+                        uint32_t zigzag = 0;
+                        complete = getVarint(zigzag);
+                        int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+                        fields[k] = _prev[k] + (uint32_t)delta;
+                    }
+
+                    if (!complete) {
+                        _pos = _size;
+                        return false;
+                    }
+
+                    memcpy(_prev, fields, sizeof(_prev));
+
+                    uint8_t f = 0;
+
+                    record.time = fields[f++] / 1e6;
+
+                    for (uint8_t k=0; k<State::SIZE; ++k) {
+                        record.x[k] = real(fields[f++]);
+                    }
+
+                    for (uint8_t k=0; k<6; ++k) {
+                        record.channels[k] = real(fields[f++]);
+                    }
+
+                    for (uint8_t k=0; k<4; ++k) {
+                        record.demands[k] = real(fields[f++]);
+                    }
+
+                    record.ncontrollers = _ncontrollers;
+                    for (uint8_t j=0; j<_ncontrollers; ++j) {
+                        for (uint8_t k=0; k<4; ++k) {
+                            record.controllers[j][k] = real(fields[f++]);
+                        }
+                    }
+
+                    record.nmotors = _nmotors;
+                    for (uint8_t k=0; k<_nmotors; ++k) {
+                        record.motors[k] = real(fields[f++]);
+                    }
+
+                    return true;
+                }
+
+                return false;
+            }
+
+    }; // class BlackboxReader
+
+} // namespace hf
@@ -0,0 +1,583 @@
+/*
+   Checks the cross-core exchange used by DualCoreHackflight, with host
+   threads standing in for the cores, then measures what GCS traffic does
+   to the flight loop with and without the split.
+
+   1. Seqlock: one writer publishes a struct whose fields all hold the same
+      count, several readers copy it; every copy must be coherent and no
+      older than the one before.
+
+   2. SpscRing: one thread pushes a counting sequence without waiting,
+      another pops it; items must arrive in order, the last one must
+      arrive, and any not popped must have been reported overwritten.
+
+   3. Two SITL flights under DualCoreHackflight, one after the other, each
+      with the flight half on one thread and the comms half on another,
+      the same two threads both times, and a GCS asking for profiler
+      statistics.  The GCS subscribes to telemetry in the first flight
+      only.  The profiler reports must be the flight thread's, in both
+      flights, and telemetry must stream in the first flight and not in
+      the second.
+
+   4. A SITL flight under DualCoreHackflight with a GCS flooding the serial
+      port with requests and subscribed to every telemetry topic, first
+      with both halves on one thread (as StaticHackflight runs them), then
+      with the comms half on a thread of its own, given a second CPU.
+      Reports host time per flight pass.
+
+   Exits with status 1 if any of the first three checks fails.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "sitl.hpp"
+#include "dualcore_hackflight.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const uint32_t WRITES = 2000000;
+static const uint8_t READERS = 3;
+
+static const uint32_t ITEMS = 2000000;
+
+static const double DT = 0.0001;
+static const double DURATION = 10;
+
+// Seqlock ------------------------------------------------------------------
+
+typedef struct {
+
+    uint32_t count;
+    float values[31];
+
+} payload_t;
+
+static bool checkSeqlock(void)
+{
+    hf::Seqlock<payload_t> seqlock;
+
+    std::atomic<bool> done(false);
+
+    uint32_t reads[READERS] = {};
+    uint32_t torn[READERS] = {};
+    uint32_t backwards[READERS] = {};
+    uint32_t retries[READERS] = {};
+
+    std::vector<std::thread> readers;
+
+    for (uint8_t r=0; r<READERS; ++r) {
+
+        readers.push_back(std::thread([&, r]() {
+
+            uint32_t last = 0;
+
+            while (!done.load(std::memory_order_acquire)) {
+
+                payload_t payload;
+
+                if (!seqlock.tryRead(payload)) {
+                    ++retries[r];
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                ++reads[r];
+
+                for (uint8_t k=0; k<31; ++k) {
+                    if (payload.values[k] != (float)payload.count) {
+                        ++torn[r];
+                        break;
+                    }
+                }
+
+                if (payload.count < last) {
+                    ++backwards[r];
+                }
+
+                last = payload.count;
+            }
+        }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t n=1; n<=WRITES; ++n) {
+
+        payload_t payload = {};
+
+        payload.count = n;
+
+        for (uint8_t k=0; k<31; ++k) {
+            payload.values[k] = (float)n;
+        }
+
+        seqlock.write(payload);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    done.store(true, std::memory_order_release);
+
+    for (auto & reader : readers) {
+        reader.join();
+    }
+
+    uint32_t totalTorn = 0, totalBackwards = 0;
+
+    printf("Seqlock (%u-byte value, 1 writer, %u readers):\n", (unsigned)sizeof(payload_t), READERS);
+    printf("  %u writes, %.1f nsec/write\n", seqlock.count(), 1e9 * seconds / WRITES);
+
+    for (uint8_t r=0; r<READERS; ++r) {
+        printf("  reader %u: %9u copies, %9u retries, %u torn, %u out of order\n",
+                r, reads[r], retries[r], torn[r], backwards[r]);
+        totalTorn += torn[r];
+        totalBackwards += backwards[r];
+    }
+
+    bool ok = seqlock.count() == WRITES && totalTorn == 0 && totalBackwards == 0;
+
+    printf("  %s\n\n", ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+// SpscRing -----------------------------------------------------------------
+
+static bool checkRing(void)
+{
+    hf::SpscRing<uint32_t, 16> ring;
+
+    uint32_t overwritten = 0;
+
+    uint32_t received = 0;
+    uint32_t misordered = 0;
+    uint32_t last = 0;
+
+    std::thread consumer([&]() {
+
+        bool first = true;
+
+        while (first || last < ITEMS - 1) {
+
+            uint32_t item = 0;
+
+            if (!ring.pop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (!first && item <= last) {
+                ++misordered;
+            }
+
+            first = false;
+            last = item;
+            ++received;
+        }
+    });
+
+    for (uint32_t n=0; n<ITEMS; ++n) {
+
+        if (!ring.push(n)) {
+            ++overwritten;
+        }
+
+        // Give a consumer sharing our CPU a look in, mid-ring
+        if (n % 40 == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.join();
+
+    // Overwritten items are skipped; everything popped must be newer than what came before
+    bool ok = misordered == 0 && last == ITEMS - 1 && received + overwritten >= ITEMS;
+
+    printf("SpscRing (16 slots):\n");
+    printf("  %u pushed, %u popped, %u out of order, last %u; producer overwrote %u\n",
+            ITEMS, received, misordered, last, overwritten);
+    printf("  %s\n\n", ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+// Flight -------------------------------------------------------------------
+
+// Virtual clock readable from the comms thread, and a serial port with a
+// GCS on the other end sending a burst of requests every so often; the
+// last request in each asks for profiler statistics
+class GcsBoard : public hf::SimBoard {
+
+    public:
+
+        static const uint8_t REQUESTS = 20;
+
+        static constexpr float BURST_PERIOD = 0.01;
+
+    private:
+
+        std::atomic<float> _time = {0};
+
+        uint8_t _burst[6*REQUESTS] = {};
+        uint8_t _size = 0;
+        uint8_t _available = 0;
+        float _burstPeriod = 0;
+        float _burstTime = 0;
+
+        // Replies: $M> size id payload checksum
+        uint8_t _reply[6+255] = {};
+        uint16_t _replyBytes = 0;
+
+        void receive(uint8_t c)
+        {
+            _reply[_replyBytes++] = c;
+
+            if (_replyBytes < 5 || _replyBytes < 6 + _reply[3]) {
+                return;
+            }
+
+            if (_reply[4] == hf::msp::TELEMETRY::ID) {
+                ++telemetryFrames;
+            }
+
+            if (_reply[4] == hf::msp::PROFILE_STATS::ID) {
+                memcpy(&profileStats, &_reply[5], sizeof(profileStats));
+                ++profileReplies;
+            }
+
+            _replyBytes = 0;
+        }
+
+    protected:
+
+        virtual float getTime(void) override
+        {
+            return _time.load(std::memory_order_relaxed);
+        }
+
+        virtual uint8_t serialAvailableBytes(void) override
+        {
+            float time = getTime();
+
+            if (_available == 0 && time - _burstTime >= _burstPeriod) {
+                _burstTime = time;
+                _available = _size;
+            }
+
+            return _available;
+        }
+
+        virtual uint8_t serialReadByte(void) override
+        {
+            return _burst[_size - _available--];
+        }
+
+        virtual void serialWriteByte(uint8_t c) override
+        {
+            ++bytesOut;
+            receive(c);
+        }
+
+    public:
+
+        uint32_t bytesOut = 0;
+
+        uint32_t telemetryFrames = 0;
+
+        uint32_t profileReplies = 0;
+        hf::msp::PROFILE_STATS profileStats = {};
+
+        GcsBoard(uint8_t requests, float burstPeriod)
+        {
+            _size = 6 * requests;
+            _burstPeriod = burstPeriod;
+
+            // Alternating attitude and RC requests: $M< size id checksum
+            for (uint8_t k=0; k<requests; ++k) {
+                uint8_t id = k == requests-1 ? hf::msp::PROFILE_STATS::ID :
+                    k % 2 ? hf::msp::RC_NORMAL::ID : hf::msp::ATTITUDE_RADIANS::ID;
+                uint8_t request[6] = {'$', 'M', '<', 0, id, id};
+                memcpy(&_burst[6*k], request, 6);
+            }
+        }
+
+        void step(double dt)
+        {
+            SimBoard::step(dt);
+            _time.store((float)time(), std::memory_order_relaxed);
+        }
+
+}; // class GcsBoard
+
+class Vehicle {
+
+    public:
+
+        GcsBoard board;
+
+        hf::SimReceiver receiver;
+
+        hf::SimMotors motors;
+
+        hf::StaticMixerQuadXMW mixer;
+
+        hf::Dynamics dynamics;
+
+        hf::SimSensors sensors;
+
+        hf::LevelPid levelPid = hf::LevelPid(0.20f);
+        hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid = hf::YawPid(2, 0.1);
+
+        hf::SensorList<hf::SimSensors> sensorList;
+
+        hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllerList;
+
+        hf::DualCoreHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW,
+            decltype(sensorList), decltype(controllerList)> hackflight;
+
+        Vehicle(uint8_t requests=GcsBoard::REQUESTS, float burstPeriod=GcsBoard::BURST_PERIOD)
+            : board(requests, burstPeriod),
+              receiver(&board),
+              motors(hf::Dynamics::NMOTORS),
+              mixer(&motors),
+              sensors(&dynamics),
+              sensorList(sensors),
+              controllerList(levelPid, ratePid, yawPid),
+              hackflight(&board, receiver, mixer, sensorList, controllerList)
+        {
+        }
+
+}; // class Vehicle
+
+static void subscribeAll(void)
+{
+    for (uint8_t k=0; k<hf::Telemetry::NTOPICS; ++k) {
+        hf::_telemetry.subscribe(k, 1);
+    }
+}
+
+// Threads ------------------------------------------------------------------
+
+static bool checkThreads(void)
+{
+    static const uint8_t FLIGHTS = 2;
+    static const double SECONDS = 1;
+
+    // Light enough traffic to leave room for telemetry
+    static const uint8_t REQUESTS = 1;
+    static constexpr float BURST_PERIOD = 0.1;
+
+    Vehicle * vehicles[FLIGHTS] = {};
+
+    uint32_t frames[FLIGHTS] = {};
+    uint32_t replies[FLIGHTS] = {};
+    hf::msp::PROFILE_STATS stats[FLIGHTS] = {};
+
+    // Flights begun, comms halves begun, and flights over
+    std::atomic<uint8_t> begun(0), commsBegun(0), over(0);
+
+    std::thread comms([&]() {
+
+        for (uint8_t f=0; f<FLIGHTS; ++f) {
+
+            while (begun.load(std::memory_order_acquire) <= f) {
+                std::this_thread::yield();
+            }
+
+            Vehicle * vehicle = vehicles[f];
+
+            vehicle->hackflight.beginComms();
+
+            if (f == 0) {
+                subscribeAll();
+            }
+
+            commsBegun.store(f+1, std::memory_order_release);
+
+            while (over.load(std::memory_order_acquire) <= f) {
+                vehicle->hackflight.updateComms();
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread flight([&]() {
+
+        for (uint8_t f=0; f<FLIGHTS; ++f) {
+
+            Vehicle * vehicle = new Vehicle(REQUESTS, BURST_PERIOD);
+
+            vehicles[f] = vehicle;
+
+            vehicle->dynamics.reset();
+            vehicle->hackflight.begin(true);
+            vehicle->dynamics.setAirborne(100);
+
+            // Only this thread's profiler times the flight
+            hf::_profiler.enable();
+
+            begun.store(f+1, std::memory_order_release);
+
+            while (commsBegun.load(std::memory_order_acquire) <= f) {
+                std::this_thread::yield();
+            }
+
+            while (vehicle->board.time() < SECONDS) {
+                vehicle->receiver.setSticks(0.14f, 0, 0, 0, +1);
+                vehicle->hackflight.update();
+                vehicle->dynamics.update(vehicle->motors.values(), DT);
+                vehicle->board.step(DT);
+                std::this_thread::yield();
+            }
+
+            over.store(f+1, std::memory_order_release);
+        }
+    });
+
+    flight.join();
+    comms.join();
+
+    bool ok = true;
+
+    printf("Flight and comms on threads of their own, two flights in turn:\n");
+
+    for (uint8_t f=0; f<FLIGHTS; ++f) {
+
+        frames[f] = vehicles[f]->board.telemetryFrames;
+        replies[f] = vehicles[f]->board.profileReplies;
+        stats[f] = vehicles[f]->board.profileStats;
+
+        // Subscribed in the first flight only
+        bool flightOk = replies[f] > 0 && stats[f].nstages > 0 && stats[f].count > 0 &&
+            (f == 0 ? frames[f] > 0 : frames[f] == 0);
+
+        printf("  flight %u: %u telemetry frames; %u profiler replies, last %.0f stages, %.0f timings  %s\n",
+                f+1, frames[f], replies[f], stats[f].nstages, stats[f].count, flightOk ? "OK" : "FAILED");
+
+        ok = ok && flightOk;
+
+        delete vehicles[f];
+    }
+
+    printf("\n");
+
+    return ok;
+}
+
+// GCS flood ----------------------------------------------------------------
+
+static void report(const char * name, std::vector<float> & usec, Vehicle & vehicle)
+{
+    double sum = 0;
+    for (float u : usec) {
+        sum += u;
+    }
+
+    std::sort(usec.begin(), usec.end());
+
+    printf("  %-26s mean %6.3f usec, 99%% %6.3f usec, 99.9%% %7.3f usec, max %8.3f usec;"
+            " %u bytes to GCS, roll %+6.3f\n",
+            name, sum / usec.size(), usec[usec.size()*99/100], usec[usec.size()*999/1000], usec.back(),
+            vehicle.board.bytesOut, vehicle.dynamics.x[hf::State::PHI]);
+}
+
+static void fly(bool split)
+{
+    Vehicle vehicle;
+
+    vehicle.dynamics.reset();
+    vehicle.hackflight.begin(true);
+    vehicle.dynamics.setAirborne(100);
+
+    std::atomic<bool> done(false);
+
+    std::thread comms;
+
+    if (split) {
+        comms = std::thread([&]() {
+            vehicle.hackflight.beginComms();
+            subscribeAll();
+            while (!done.load(std::memory_order_acquire)) {
+                vehicle.hackflight.updateComms();
+                std::this_thread::yield();
+            }
+        });
+    }
+    else {
+        vehicle.hackflight.beginComms();
+        subscribeAll();
+    }
+
+    std::vector<float> usec;
+    usec.reserve((size_t)(DURATION / DT) + 1);
+
+    while (vehicle.board.time() < DURATION) {
+
+        float roll = vehicle.board.time() >= DURATION / 2 ? 0.25f : 0;
+        vehicle.receiver.setSticks(0.14f, roll, 0, 0, +1);
+
+        auto start = std::chrono::steady_clock::now();
+
+        vehicle.hackflight.update();
+
+        if (!split) {
+            vehicle.hackflight.updateComms();
+        }
+
+        usec.push_back(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        vehicle.dynamics.update(vehicle.motors.values(), DT);
+        vehicle.board.step(DT);
+    }
+
+    done.store(true, std::memory_order_release);
+
+    if (split) {
+        comms.join();
+    }
+
+    report(split ? "flight thread, comms apart" : "one thread", usec, vehicle);
+}
+
+int main(int, char **)
+{
+    bool ok = checkSeqlock();
+
+    ok = checkRing() && ok;
+
+    ok = checkThreads() && ok;
+
+    printf("Flight pass with a GCS flooding requests and subscribed to all telemetry:\n");
+
+    // Each on its own thread, so each gets its own profiler and telemetry
+    std::thread([]() { fly(false); }).join();
+
+    // Otherwise the comms thread just preempts the flight thread
+    if (std::thread::hardware_concurrency() > 1) {
+        std::thread([]() { fly(true); }).join();
+    }
+    else {
+        printf("  (only one CPU here, so no flight with the comms thread apart)\n");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+   Simple rigid-body dynamics for an X-configuration quadcopter, for
+   software-in-the-loop (SITL) testing of Hackflight on a host computer
+
+   Motor numbering follows the MultiWii convention used by MixerQuadXMW:
+
+    4cw   2ccw
+       \ /
+        ^
+       / \
+    3ccw  1cw
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "state.hpp"
+
+namespace hf {
+
+    // Vehicle parameters, defaulting to roughly those of a DJI Phantom
+    typedef struct vehicle_params_t {
+
+        float b = 5.30216718361085E-05f;  // thrust coefficient
+        float d = 2.23656692806239E-06f;  // drag (yaw torque) coefficient
+        float m = 16.47f;                 // mass (kg)
+        float l = 0.6f;                   // arm length (m)
+        float Ix = 2.0f;                  // moments of inertia (kg m^2)
+        float Iy = 2.0f;
+        float Iz = 3.0f;
+        float maxrpm = 15000.0f;          // motor speed at full throttle
+        float motortau = 0.0f;            // first-order motor time constant (s); 0 = instant
+
+    } vehicle_params_t;
+
+    class Dynamics {
+
+        public:
+
+            static const uint8_t NMOTORS = 4;
+
+            // Same layout as hf::State::x (Bouabdallah et al. 2004)
+            float x[State::SIZE] = {};
+
+        private:
+
+            static constexpr float G = 9.80665f;
+
+            vehicle_params_t _p;
+
+            // Spin rates (rad/s), lagging the commanded values when motortau > 0
+            float _omegas[NMOTORS] = {};
+
+            bool _airborne = false;
+
+        public:
+
+            Dynamics(const vehicle_params_t & params = vehicle_params_t())
+            {
+                _p = params;
+            }
+
+            void reset(void)
+            {
+                memset(x, 0, sizeof(x));
+                memset(_omegas, 0, sizeof(_omegas));
+                _airborne = false;
+            }
+
+            // Sets the initial attitude (radians); vehicle is considered airborne
+            void setAttitude(float phi, float theta, float psi)
+            {
+                x[State::PHI] = phi;
+                x[State::THETA] = theta;
+                x[State::PSI] = psi;
+                _airborne = true;
+            }
+
+            void setAirborne(float altitude)
+            {
+                x[State::Z] = altitude;
+                _airborne = true;
+            }
+
+            // Advances the state by dt seconds given motor values in [0,1]
+            void update(const float * motors, float dt)
+            {
+                // Motor values => spin rates, with optional first-order lag
+                float alpha = _p.motortau > 0 ? dt / (_p.motortau + dt) : 1;
+                float o2[NMOTORS] = {};
+                for (uint8_t i=0; i<NMOTORS; ++i) {
+                    float target = motors[i] * _p.maxrpm * (float)M_PI / 30;
+                    _omegas[i] += alpha * (target - _omegas[i]);
+                    o2[i] = _omegas[i] * _omegas[i];
+                }
+
+                // Thrust, then roll (right down), pitch (nose up), yaw (nose right) torques
+                float lx = _p.l * (float)M_SQRT1_2;
+                float u1 = _p.b * (o2[0] + o2[1] + o2[2] + o2[3]);
+                float u2 = lx * _p.b * (o2[2] + o2[3] - o2[0] - o2[1]);
+                float u3 = lx * _p.b * (o2[1] + o2[3] - o2[0] - o2[2]);
+                float u4 = _p.d * (o2[1] + o2[2] - o2[0] - o2[3]);
+
+                float phi = x[State::PHI];
+                float theta = x[State::THETA];
+                float psi = x[State::PSI];
+                float dphi = x[State::DPHI];
+                float dtheta = x[State::DTHETA];
+                float dpsi = x[State::DPSI];
+
+                float cph = cosf(phi), sph = sinf(phi);
+                float cth = cosf(theta), sth = sinf(theta);
+                float cps = cosf(psi), sps = sinf(psi);
+
+                // Translational accelerations in an inertial Z-up frame
+                float ddx = (cph*sth*cps + sph*sps) * u1 / _p.m;
+                float ddy = (cph*sth*sps - sph*cps) * u1 / _p.m;
+                float ddz = cph*cth * u1 / _p.m - G;
+
+                // Rotational accelerations (Bouabdallah eqn. 2, no gyroscopic term)
+                float ddphi = dtheta*dpsi*(_p.Iy-_p.Iz)/_p.Ix + u2/_p.Ix;
+                float ddtheta = dphi*dpsi*(_p.Iz-_p.Ix)/_p.Iy + u3/_p.Iy;
+                float ddpsi = dphi*dtheta*(_p.Ix-_p.Iy)/_p.Iz + u4/_p.Iz;
+
+                // Stay on the ground until thrust exceeds weight
+                if (!_airborne) {
+                    if (ddz <= 0) {
+                        return;
+                    }
+                    _airborne = true;
+                }
+
+                x[State::DX] += ddx * dt;
+                x[State::DY] += ddy * dt;
+                x[State::DZ] += ddz * dt;
+                x[State::DPHI] += ddphi * dt;
+                x[State::DTHETA] += ddtheta * dt;
+                x[State::DPSI] += ddpsi * dt;
+
+                x[State::X] += x[State::DX] * dt;
+                x[State::Y] += x[State::DY] * dt;
+                x[State::Z] += x[State::DZ] * dt;
+                x[State::PHI] += x[State::DPHI] * dt;
+                x[State::THETA] += x[State::DTHETA] * dt;
+                x[State::PSI] += x[State::DPSI] * dt;
+
+                // Keep heading in [-pi,+pi]
+                if (x[State::PSI] > (float)M_PI) x[State::PSI] -= 2*(float)M_PI;
+                if (x[State::PSI] < -(float)M_PI) x[State::PSI] += 2*(float)M_PI;
+
+                // Landing
+                if (x[State::Z] < 0) {
+                    float psi = x[State::PSI];
+                    reset();
+                    x[State::PSI] = psi;
+                }
+            }
+
+    }; // class Dynamics
+
+} // namespace hf
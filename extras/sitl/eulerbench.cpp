@@ -0,0 +1,185 @@
+/*
+   Accuracy and speed of the EulerMath kernels against libm
+
+   Accuracy: a sweep of the floats in [0,1], every one with a stride of 1,
+   through atan2 (in both octants next to the X axis) and asin, against
+   double-precision libm; then a 1-degree grid over the whole attitude envelope through
+   quaternion-to-Euler conversion, reporting the worst angle error away
+   from gimbal lock, and the worst error in the rotation that the angles
+   describe everywhere short of +/-90 degrees pitch.
+
+   Speed: nanoseconds per quaternion-to-Euler conversion on this host.
+   That's only a relative guide for the soft-float boards the fast kernels
+   are meant for, where libm's atan2f/asinf cost several times more.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "eulermath.hpp"
+
+static const uint32_t ONE_BITS = 0x3F800000; // 1.0f
+
+// Angle errors are reported away from gimbal lock, where roll and heading are ill-defined
+static const double MAX_PITCH_DEGREES = 85;
+
+static const uint32_t TIMING_QUATERNIONS = 4096; // power of two
+static const uint32_t TIMING_CALLS = 10000000;
+
+static const char * NAMES[3] = {"libm", "fast", "fastest"};
+
+static float bitsToFloat(uint32_t bits)
+{
+    float f = 0;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+template <uint8_t METHOD>
+static void sweepKernels(uint32_t stride, double & atan2Error, double & asinError)
+{
+    atan2Error = 0;
+    asinError = 0;
+
+    for (uint32_t bits=0; bits<=ONE_BITS; bits+=stride) {
+
+        float z = bitsToFloat(bits);
+
+        // Below and above the diagonal
+        atan2Error = fmax(atan2Error, fabs(hf::EulerMath::atan2<METHOD>(z, 1) - atan2((double)z, 1.)));
+        atan2Error = fmax(atan2Error, fabs(hf::EulerMath::atan2<METHOD>(1, z) - atan2(1., (double)z)));
+
+        asinError = fmax(asinError, fabs(hf::EulerMath::asin<METHOD>(z) - asin((double)z)));
+    }
+}
+
+// Z-Y-X Euler angles to quaternion, in double
+static void toQuaternion(double phi, double theta, double psi, double * q)
+{
+    double cph = cos(phi/2), sph = sin(phi/2);
+    double cth = cos(theta/2), sth = sin(theta/2);
+    double cps = cos(psi/2), sps = sin(psi/2);
+
+    q[0] = cph*cth*cps + sph*sth*sps;
+    q[1] = sph*cth*cps - cph*sth*sps;
+    q[2] = cph*sth*cps + sph*cth*sps;
+    q[3] = cph*cth*sps - sph*sth*cps;
+}
+
+static double wrap(double angle)
+{
+    return fabs(remainder(angle, 2*M_PI));
+}
+
+template <uint8_t METHOD>
+static void sweepEnvelope(double & angleError, double & rotationError)
+{
+    angleError = 0;
+    rotationError = 0;
+
+    for (int32_t theta=-90; theta<=90; ++theta) {
+        for (int32_t phi=-180; phi<180; ++phi) {
+            for (int32_t psi=-180; psi<180; ++psi) {
+
+                double r[3] = {phi * M_PI/180, theta * M_PI/180, psi * M_PI/180};
+
+                double qd[4] = {};
+                toQuaternion(r[0], r[1], r[2], qd);
+
+                float q[4] = {(float)qd[0], (float)qd[1], (float)qd[2], (float)qd[3]};
+
+                float e[3] = {};
+                hf::EulerMath::fromQuaternion<METHOD>(q, e[0], e[1], e[2]);
+
+                if (fabs((double)theta) <= MAX_PITCH_DEGREES) {
+                    for (uint8_t k=0; k<3; ++k) {
+                        angleError = fmax(angleError, wrap(e[k] - r[k]));
+                    }
+                }
+
+                // Roll and heading are undefined at exactly +/-90 degrees pitch
+                if (abs(theta) == 90) {
+                    continue;
+                }
+
+                // Angle of the rotation between the true and recovered attitudes
+                double qe[4] = {};
+                toQuaternion(e[0], e[1], e[2], qe);
+                double dot = fabs(qd[0]*qe[0] + qd[1]*qe[1] + qd[2]*qe[2] + qd[3]*qe[3]);
+                rotationError = fmax(rotationError, 2 * acos(fmin(dot, 1)));
+            }
+        }
+    }
+}
+
+template <uint8_t METHOD>
+static double nsecPerConversion(const std::vector<float> & quaternions)
+{
+    float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<TIMING_CALLS; ++k) {
+        const float * q = &quaternions[4 * (k & (TIMING_QUATERNIONS-1))];
+        float phi = 0, theta = 0, psi = 0;
+        hf::EulerMath::fromQuaternion<METHOD>(q, phi, theta, psi);
+        sink += phi + theta + psi;
+    }
+
+    double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        TIMING_CALLS;
+
+    // Keep the optimizer from discarding the loop
+    return sink == 12345 ? 0 : nsec;
+}
+
+template <uint8_t METHOD>
+static void report(uint32_t stride, const std::vector<float> & quaternions)
+{
+    double atan2Error = 0, asinError = 0, angleError = 0, rotationError = 0;
+
+    sweepKernels<METHOD>(stride, atan2Error, asinError);
+    sweepEnvelope<METHOD>(angleError, rotationError);
+
+    printf("%-8s  %9.2e  %9.2e  %9.2e  %9.2e  %6.1f\n", NAMES[METHOD],
+            atan2Error, asinError, angleError, rotationError, nsecPerConversion<METHOD>(quaternions));
+    fflush(stdout);
+}
+
+int main(int argc, char ** argv)
+{
+    // Every 256th float by default; 1 for every float, which takes minutes
+    uint32_t stride = argc > 1 ? atoi(argv[1]) : 256;
+
+    std::vector<float> quaternions(4 * TIMING_QUATERNIONS);
+    srand(0);
+    for (uint32_t k=0; k<TIMING_QUATERNIONS; ++k) {
+        double q[4] = {};
+        toQuaternion(2*M_PI * rand() / RAND_MAX - M_PI, M_PI * rand() / RAND_MAX - M_PI/2,
+                2*M_PI * rand() / RAND_MAX - M_PI, q);
+        for (uint8_t j=0; j<4; ++j) {
+            quaternions[4*k+j] = (float)q[j];
+        }
+    }
+
+    printf("Max errors (rad): atan2 and asin over every %u float(s) in [0,1];\n"
+            "Euler angles within %2.0f degrees pitch and rotation short of 90, on a 1-degree grid\n\n",
+            stride, MAX_PITCH_DEGREES);
+
+    printf("kernel        atan2       asin      angle   rotation  nsec/conversion\n");
+
+    report<HF_EULER_LIBM>(stride, quaternions);
+    report<HF_EULER_FAST>(stride, quaternions);
+    report<HF_EULER_FASTEST>(stride, quaternions);
+
+    return 0;
+}
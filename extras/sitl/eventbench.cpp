@@ -0,0 +1,272 @@
+/*
+   Compares gyro-to-motor latency of StaticHackflight, which runs all the
+   controllers at a fixed 300 Hz, with EventHackflight, which runs the
+   rate controllers and mixer on each gyro sample.  Both fly the same SITL
+   roll step on a fine virtual clock, with the 834 Hz USFSMAX gyro rate.
+
+   Latency is measured two ways: in virtual time, as the age of the gyro
+   sample behind each motor update, and the fraction of samples that never
+   reach the motors; and on this host, from the profiler stages, as the
+   time each pass takes.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+
+#include "sitl.hpp"
+#include "static_hackflight.hpp"
+#include "event_hackflight.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+// Fine enough to resolve the gyro and loop periods
+static const double DT = 0.00002;
+
+static const double STEP_TIME = 5;
+static const double DURATION = 10;
+static const float ROLL_STEP = 0.25f;
+
+// SimSensors that remember when each sample was taken
+class TimedSimSensors : public hf::SimSensors {
+
+    template <typename...> friend class hf::SensorList;
+
+    protected:
+
+        virtual void modifyState(rft::State * state, float time) override
+        {
+            SimSensors::modifyState(state, time);
+            sampleTime = time;
+            ++samples;
+        }
+
+    public:
+
+        double sampleTime = 0;
+        uint32_t samples = 0;
+
+        TimedSimSensors(hf::Dynamics * dynamics)
+            : SimSensors(dynamics)
+        {
+        }
+
+}; // class TimedSimSensors
+
+// Last controller in the chain: sees each update on its way to the mixer
+class AgeProbe : public rft::ClosedLoopController {
+
+    private:
+
+        hf::SimBoard * _board = NULL;
+        TimedSimSensors * _sensors = NULL;
+
+        uint32_t _lastSample = 0;
+        uint32_t _firstSample = 0;
+
+    public:
+
+        uint32_t updates = 0;
+        uint32_t samplesUsed = 0;
+        double sumAge = 0;
+        double maxAge = 0;
+
+        AgeProbe(hf::SimBoard * board, TimedSimSensors * sensors)
+        {
+            _board = board;
+            _sensors = sensors;
+        }
+
+        virtual void modifyDemands(rft::State * state, float * demands) override
+        {
+            (void)state;
+            (void)demands;
+
+            // Ignore takeoff
+            if (_board->time() < 1) {
+                _lastSample = _sensors->samples;
+                _firstSample = _sensors->samples;
+                return;
+            }
+
+            double age = _board->time() - _sensors->sampleTime;
+
+            ++updates;
+            sumAge += age;
+            maxAge = fmax(maxAge, age);
+
+            if (_sensors->samples != _lastSample) {
+                ++samplesUsed;
+                _lastSample = _sensors->samples;
+            }
+        }
+
+        // Samples since takeoff
+        uint32_t samples(void)
+        {
+            return _sensors->samples - _firstSample;
+        }
+
+}; // class AgeProbe
+
+// The parts both vehicles share
+class Vehicle {
+
+    public:
+
+        hf::SimBoard board;
+
+        hf::SimReceiver receiver;
+
+        hf::SimMotors motors;
+
+        hf::StaticMixerQuadXMW mixer;
+
+        hf::Dynamics dynamics;
+
+        TimedSimSensors sensors;
+
+        hf::LevelPid levelPid = hf::LevelPid(0.20f);
+        hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid = hf::YawPid(2, 0.1);
+
+        AgeProbe probe;
+
+        Vehicle(void)
+            : receiver(&board),
+              motors(hf::Dynamics::NMOTORS),
+              mixer(&motors),
+              sensors(&dynamics),
+              probe(&board, &sensors)
+        {
+        }
+
+}; // class Vehicle
+
+class StaticVehicle : public Vehicle {
+
+    public:
+
+        hf::SensorList<TimedSimSensors> sensorList;
+
+        hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid, AgeProbe> controllerList;
+
+        hf::StaticHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW,
+            decltype(sensorList), decltype(controllerList)> hackflight;
+
+        StaticVehicle(void)
+            : sensorList(sensors),
+              controllerList(levelPid, ratePid, yawPid, probe),
+              hackflight(&board, receiver, mixer, sensorList, controllerList)
+        {
+        }
+
+}; // class StaticVehicle
+
+class EventVehicle : public Vehicle {
+
+    public:
+
+        hf::SensorList<TimedSimSensors> gyro;
+
+        hf::SensorList<> otherSensors;
+
+        hf::ControllerList<hf::LevelPid> outer;
+
+        hf::ControllerList<hf::RatePid, hf::YawPid, AgeProbe> inner;
+
+        hf::EventHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW, decltype(gyro), decltype(otherSensors),
+            decltype(outer), decltype(inner)> hackflight;
+
+        EventVehicle(void)
+            : gyro(sensors),
+              outer(levelPid),
+              inner(ratePid, yawPid, probe),
+              hackflight(&board, receiver, mixer, gyro, otherSensors, outer, inner)
+        {
+        }
+
+}; // class EventVehicle
+
+static void printStage(const char * name)
+{
+    for (uint8_t k=0; k<hf::_profiler.stageCount(); ++k) {
+        if (!strcmp(hf::_profiler.getStage(k)->name, name)) {
+            uint32_t count = 0;
+            float minUsec = 0, meanUsec = 0, maxUsec = 0;
+            hf::_profiler.getStats(k, count, minUsec, meanUsec, maxUsec);
+            printf("    %-30s %8u passes, mean %6.3f usec, max %7.3f usec\n", name, count, meanUsec, maxUsec);
+        }
+    }
+}
+
+template <typename V>
+static void fly(const char * name, V & vehicle, const char ** stages, uint8_t nstages)
+{
+    vehicle.dynamics.reset();
+    vehicle.hackflight.begin(true);
+    vehicle.dynamics.setAirborne(100);
+
+    hf::_profiler.enable();
+
+    double maxRoll = 0;
+
+    while (vehicle.board.time() < DURATION) {
+        float roll = vehicle.board.time() >= STEP_TIME ? ROLL_STEP : 0;
+        vehicle.receiver.setSticks(0.14f, roll, 0, 0, +1);
+        vehicle.hackflight.update();
+        vehicle.dynamics.update(vehicle.motors.values(), DT);
+        vehicle.board.step(DT);
+        maxRoll = fmax(maxRoll, vehicle.dynamics.x[hf::State::PHI]);
+    }
+
+    AgeProbe & probe = vehicle.probe;
+
+    printf("%s:\n", name);
+    printf("  %.0f motor updates/sec; gyro sample age at motors mean %5.3f msec, max %5.3f msec; "
+            "%4.1f%% of samples unused\n",
+            probe.updates / (DURATION - 1), 1000 * probe.sumAge / probe.updates, 1000 * probe.maxAge,
+            100 * (1 - (double)probe.samplesUsed / probe.samples()));
+    printf("  roll step: peak %5.3f rad, final %5.3f rad\n", maxRoll, vehicle.dynamics.x[hf::State::PHI]);
+    printf("  host time per pass:\n");
+
+    for (uint8_t k=0; k<nstages; ++k) {
+        printStage(stages[k]);
+    }
+
+    printf("\n");
+}
+
+int main(int, char **)
+{
+    const char * staticStages[] = {"StaticHackflight.update"};
+    const char * eventStages[] = {
+        "EventHackflight.gyroToMotor", "EventHackflight.attitude", "EventHackflight.background"
+    };
+
+    // Each on its own thread, so each gets its own profiler table
+    std::thread([&]() {
+        StaticVehicle vehicle;
+        fly("StaticHackflight (controllers at 300 Hz)", vehicle, staticStages, 1);
+    }).join();
+
+    std::thread([&]() {
+        EventVehicle vehicle;
+        fly("EventHackflight (rate controllers on each gyro sample)", vehicle, eventStages, 3);
+    }).join();
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+   Benchmarks the GyroFilter bank used by UsfsMaxGyrometer, at the
+   USFSMAX's 834 Hz gyro rate.
+
+   For several banks, reports host time per sample per axis for the
+   bank's three-axis kernel against a straightforward one-axis-at-a-time
+   biquad cascade, which also checks its output.  Then, for a typical
+   bank (biquad low-pass plus two motor-noise notches), measures the gain
+   at frequencies up to Nyquist by filtering sine waves, next to the gain
+   computed from the coefficients.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "sensors/gyrofilter.hpp"
+
+static const float RATE = 834;
+
+static const uint32_t SAMPLES = 2000000;
+
+// One axis, one stage: the textbook form, for reference
+class Biquad {
+
+    private:
+
+        float _b0 = 1, _b1 = 0, _b2 = 0, _a1 = 0, _a2 = 0;
+        float _z1 = 0, _z2 = 0;
+
+    public:
+
+        void pt1(float freq)
+        {
+            float rc = 1 / (2 * (float)M_PI * freq);
+            float k = (1 / RATE) / (rc + 1 / RATE);
+            _b0 = k;
+            _a1 = k - 1;
+        }
+
+        void rbj(bool notch, float freq, float q)
+        {
+            float omega = 2 * (float)M_PI * freq / RATE;
+            float cs = cosf(omega);
+            float alpha = sinf(omega) / (2 * q);
+            float a0 = 1 + alpha;
+            _b0 = notch ? 1 / a0 : (1 - cs) / 2 / a0;
+            _b1 = notch ? -2 * cs / a0 : (1 - cs) / a0;
+            _b2 = _b0;
+            _a1 = -2 * cs / a0;
+            _a2 = (1 - alpha) / a0;
+        }
+
+        float apply(float x)
+        {
+            float y = _b0 * x + _z1;
+            _z1 = _b1 * x - _a1 * y + _z2;
+            _z2 = _b2 * x - _a2 * y;
+            return y;
+        }
+
+}; // class Biquad
+
+typedef struct {
+
+    char type; // 'p'ole, 'l'ow-pass, 'n'otch
+    float freq;
+    float q;
+
+} stage_t;
+
+typedef struct {
+
+    const char * name;
+    uint8_t nstages;
+    stage_t stages[hf::GyroFilter::MAXSTAGES];
+
+} bank_t;
+
+static const bank_t BANKS[] = {
+    {"PT1 100 Hz", 1, {{'p', 100, 0}}},
+    {"biquad 100 Hz", 1, {{'l', 100, 0.7071f}}},
+    {"biquad 150 + notches 220, 330", 3, {{'l', 150, 0.7071f}, {'n', 220, 3}, {'n', 330, 3}}},
+    {"2 x PT1 + biquad + 3 notches", 6,
+        {{'p', 250, 0}, {'p', 250, 0}, {'l', 150, 0.7071f}, {'n', 180, 4}, {'n', 220, 3}, {'n', 330, 3}}},
+};
+
+static void build(const bank_t & bank, hf::GyroFilter & filter, Biquad reference[3][hf::GyroFilter::MAXSTAGES])
+{
+    for (uint8_t s=0; s<bank.nstages; ++s) {
+
+        const stage_t & stage = bank.stages[s];
+
+        switch (stage.type) {
+            case 'p': filter.addPt1(stage.freq); break;
+            case 'l': filter.addLowpass(stage.freq, stage.q); break;
+            default:  filter.addNotch(stage.freq, stage.q);
+        }
+
+        for (uint8_t k=0; k<3; ++k) {
+            if (stage.type == 'p') {
+                reference[k][s].pt1(stage.freq);
+            }
+            else {
+                reference[k][s].rbj(stage.type == 'n', stage.freq, stage.q);
+            }
+        }
+    }
+
+    filter.begin(RATE);
+}
+
+static double nsecSince(std::chrono::steady_clock::time_point start)
+{
+    return 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark(const bank_t & bank, const float * noise)
+{
+    hf::GyroFilter filter;
+    Biquad reference[3][hf::GyroFilter::MAXSTAGES];
+
+    build(bank, filter, reference);
+
+    volatile float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t n=0; n<SAMPLES; ++n) {
+        float rates[3] = {noise[3*(n&1023)], noise[3*(n&1023)+1], noise[3*(n&1023)+2]};
+        filter.apply(rates);
+        sink = rates[0] + rates[1] + rates[2];
+    }
+
+    double bank3 = nsecSince(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t n=0; n<SAMPLES; ++n) {
+        float rates[3] = {noise[3*(n&1023)], noise[3*(n&1023)+1], noise[3*(n&1023)+2]};
+        for (uint8_t k=0; k<3; ++k) {
+            for (uint8_t s=0; s<bank.nstages; ++s) {
+                rates[k] = reference[k][s].apply(rates[k]);
+            }
+        }
+        sink = rates[0] + rates[1] + rates[2];
+    }
+
+    double scalar = nsecSince(start);
+
+    (void)sink;
+
+    // Same input through fresh copies of both, compared sample by sample
+    hf::GyroFilter check;
+    Biquad checkReference[3][hf::GyroFilter::MAXSTAGES];
+    build(bank, check, checkReference);
+
+    float maxError = 0;
+
+    for (uint32_t n=0; n<100000; ++n) {
+        float rates[3] = {noise[3*(n&1023)], noise[3*(n&1023)+1], noise[3*(n&1023)+2]};
+        float expected[3] = {rates[0], rates[1], rates[2]};
+        check.apply(rates);
+        for (uint8_t k=0; k<3; ++k) {
+            for (uint8_t s=0; s<bank.nstages; ++s) {
+                expected[k] = checkReference[k][s].apply(expected[k]);
+            }
+            maxError = fmaxf(maxError, fabsf(rates[k] - expected[k]));
+        }
+    }
+
+    printf("  %-32s %u stages: %5.2f nsec/sample/axis (one axis at a time %5.2f); max difference %.1e\n",
+            bank.name, bank.nstages, bank3 / SAMPLES / 3, scalar / SAMPLES / 3, maxError);
+}
+
+static void response(const bank_t & bank)
+{
+    hf::GyroFilter filter;
+    Biquad unused[3][hf::GyroFilter::MAXSTAGES];
+
+    build(bank, filter, unused);
+
+    printf("\nFrequency response of %s at %.0f Hz:\n", bank.name, RATE);
+    printf("   freq (Hz)  measured (dB)  computed (dB)\n");
+
+    float maxError = 0;
+
+    for (float freq=10; freq<RATE/2; freq += 20) {
+
+        hf::GyroFilter sweep = filter;
+        sweep.begin(RATE);
+
+        // Settle for two seconds, then take the peak over two more
+        float peak = 0;
+
+        for (uint32_t n=0; n<(uint32_t)(4*RATE); ++n) {
+
+            float phase = 2 * (float)M_PI * freq * n / RATE;
+
+            // A different phase on each axis
+            float rates[3] = {sinf(phase), sinf(phase + 2), sinf(phase + 4)};
+
+            sweep.apply(rates);
+
+            if (n >= 2*RATE) {
+                peak = fmaxf(peak, fmaxf(fabsf(rates[0]), fmaxf(fabsf(rates[1]), fabsf(rates[2]))));
+            }
+        }
+
+        float computed = filter.response(freq);
+
+        maxError = fmaxf(maxError, fabsf(peak - computed));
+
+        printf("   %9.0f  %13.1f  %13.1f\n", freq, 20 * log10f(peak), 20 * log10f(computed));
+    }
+
+    printf("   max gain difference %.4f\n", maxError);
+}
+
+int main(int, char **)
+{
+    // Repeating block of white noise, three axes interleaved
+    static float noise[3*1024];
+    srand(0);
+    for (uint16_t k=0; k<3*1024; ++k) {
+        noise[k] = 2 * (float)rand() / RAND_MAX - 1;
+    }
+
+    printf("Host time, %u samples:\n", SAMPLES);
+
+    for (const bank_t & bank : BANKS) {
+        benchmark(bank, noise);
+    }
+
+    response(BANKS[2]);
+
+    return 0;
+}
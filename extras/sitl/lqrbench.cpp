@@ -0,0 +1,219 @@
+/*
+   Compares LqrController with the Level/Rate/Yaw PID chain it replaces:
+   per-loop cost of its five gains against the three modifyDemands()
+   passes, and SITL step responses in roll and yaw rate
+   with each
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "sitl.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/lqr.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const double DT = 0.001;
+
+static const uint32_t TIMING_CALLS = 10000000;
+static const uint32_t TIMING_INPUTS = 1024; // power of two
+
+// Step inputs, after the vehicle has leveled out from takeoff
+static const double STEP_TIME = 5;
+static const double DURATION = 25;
+static const float ROLL_STEP = 0.25f;
+static const float YAW_STEP = 0.3f;
+
+// Settled when within this fraction of the final value
+static const float SETTLING_BAND = 0.05f;
+
+typedef struct {
+
+    hf::State state;
+    float demands[4];
+
+} input_t;
+
+template <typename Controllers>
+static double nsecPerLoop(const std::vector<input_t> & inputs, Controllers controllers)
+{
+    float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<TIMING_CALLS; ++k) {
+        input_t input = inputs[k & (TIMING_INPUTS-1)];
+        controllers(input);
+        sink += input.demands[hf::DEMANDS_ROLL];
+    }
+
+    double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        TIMING_CALLS;
+
+    // Keep the optimizer from discarding the loop
+    return sink == 12345 ? 0 : nsec;
+}
+
+static void timing(void)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(-1, +1);
+
+    std::vector<input_t> inputs(TIMING_INPUTS);
+    for (input_t & input : inputs) {
+        for (uint8_t k=0; k<hf::State::SIZE; ++k) {
+            input.state.x[k] = 0.3f * uniform(rng);
+        }
+        for (uint8_t k=0; k<4; ++k) {
+            input.demands[k] = 0.5f * uniform(rng);
+        }
+    }
+
+    hf::LevelPid levelPid(0.20f);
+    hf::RatePid ratePid(0.225, 0.001875, 0.375);
+    hf::YawPid yawPid(2, 0.1);
+
+    rft::ClosedLoopController * chain[3] = {&levelPid, &ratePid, &yawPid};
+
+    // Cost of fetching inputs, subtracted from both
+    double baseline = nsecPerLoop(inputs, [](input_t & input) {
+        (void)input;
+    });
+
+    double pid = nsecPerLoop(inputs, [&](input_t & input) {
+        for (rft::ClosedLoopController * controller : chain) {
+            controller->modifyDemands(&input.state, input.demands);
+        }
+    });
+
+    hf::LqrController lqr;
+    rft::ClosedLoopController * fused = &lqr;
+
+    double lqrLoop = nsecPerLoop(inputs, [&](input_t & input) {
+        fused->modifyDemands(&input.state, input.demands);
+    });
+
+    pid -= baseline;
+    lqrLoop -= baseline;
+
+    printf("%3.1f nsec/loop of input fetching subtracted\n", baseline);
+    printf("Level/Rate/Yaw PID chain: %5.1f nsec/loop\n", pid);
+    printf("LqrController:            %5.1f nsec/loop (%3.2fx)\n", lqrLoop, pid / lqrLoop);
+}
+
+typedef struct {
+
+    float final;
+    float overshoot;    // fraction of the final value
+    float settlingTime; // seconds after the step
+
+} response_t;
+
+static response_t analyze(const std::vector<float> & log)
+{
+    uint32_t first = (uint32_t)(STEP_TIME / DT);
+    uint32_t last = (uint32_t)log.size();
+
+    // Final value over the last second
+    double sum = 0;
+    uint32_t window = (uint32_t)(1 / DT);
+    for (uint32_t k=last-window; k<last; ++k) {
+        sum += log[k];
+    }
+
+    response_t response = {};
+    response.final = (float)(sum / window);
+
+    float peak = 0;
+    uint32_t settled = first;
+    for (uint32_t k=first; k<last; ++k) {
+        peak = fmaxf(peak, log[k] * (response.final < 0 ? -1 : +1));
+        if (fabsf(log[k] - response.final) > SETTLING_BAND * fabsf(response.final)) {
+            settled = k;
+        }
+    }
+
+    response.overshoot = peak / fabsf(response.final) - 1;
+    response.settlingTime = (float)((settled - first) * DT);
+
+    return response;
+}
+
+// Flies a step in roll (yaw = false) or yaw rate, logging roll angle or yaw rate
+static response_t step(std::vector<rft::ClosedLoopController *> controllers, bool yaw)
+{
+    hf::Sitl sitl(DT);
+
+    for (rft::ClosedLoopController * controller : controllers) {
+        sitl.hackflight.addClosedLoopController(controller);
+    }
+
+    sitl.begin();
+    sitl.dynamics.setAirborne(100);
+
+    std::vector<float> log;
+
+    while (sitl.time() < DURATION) {
+        bool stepped = sitl.time() >= STEP_TIME;
+        sitl.receiver.setSticks(0.14f, stepped && !yaw ? ROLL_STEP : 0, 0, stepped && yaw ? YAW_STEP : 0, +1);
+        sitl.step();
+        log.push_back(sitl.dynamics.x[yaw ? hf::State::DPSI : hf::State::PHI]);
+    }
+
+    return analyze(log);
+}
+
+static void report(const char * name, const response_t & roll, const response_t & yaw)
+{
+    printf("%-9s roll %6.3f rad, %5.1f%% overshoot, settles in %5.2f sec; "
+            "yaw rate %6.3f rad/s, %5.1f%% overshoot, settles in %5.2f sec\n",
+            name,
+            roll.final, 100 * roll.overshoot, roll.settlingTime,
+            yaw.final, 100 * yaw.overshoot, yaw.settlingTime);
+}
+
+int main(int, char **)
+{
+    timing();
+
+    // Fresh controllers for each flight, so no integral carries over
+    {
+        hf::LevelPid levelPid(0.20f);
+        hf::RatePid ratePid(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid(2, 0.1);
+        response_t roll = step({&levelPid, &ratePid, &yawPid}, false);
+
+        hf::LevelPid levelPid2(0.20f);
+        hf::RatePid ratePid2(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid2(2, 0.1);
+        response_t yaw = step({&levelPid2, &ratePid2, &yawPid2}, true);
+
+        report("PID:", roll, yaw);
+    }
+
+    {
+        hf::LqrController lqr;
+        response_t roll = step({&lqr}, false);
+        response_t yaw = step({&lqr}, true);
+
+        report("LQR:", roll, yaw);
+    }
+
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*
+   Computes the LqrController gain matrix for the SITL vehicle and writes
+   it as a header
+
+   Linearizes the quad-X mixer plus the Dynamics model about hover, by
+   central differences over one closed-loop period with the demands held
+   constant, then iterates the discrete algebraic Riccati equation to a
+   fixed point.  Positions, linear velocities, and heading carry no weight,
+   since the firmware doesn't estimate them; their gains come out zero,
+   and so does the throttle row, leaving throttle to the pilot.  Nor does
+   any axis feed back from another, so the header keeps just five gains,
+   after checking that the rest are zero.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "dynamics.hpp"
+#include "demands.hpp"
+#include "actuators/mixers/quadxmw.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const uint8_t N = hf::State::SIZE;
+static const uint8_t M = 4;
+
+// Closed-loop period, split into physics steps near the SITL's 1 msec
+static const double PERIOD = 1. / 300;
+static const uint8_t SUBSTEPS = 3;
+
+static const float EPSILON = 1e-3f;
+static const float ALTITUDE = 10;
+
+// State and demand weights: attitude, angular velocity, yaw rate
+static const double Q_ANGLE = 1;
+static const double Q_RATE = 0.1;
+static const double Q_YAW_RATE = 100;
+static const double R_THROTTLE = 1;
+static const double R_ROLL_PITCH = 100;
+static const double R_YAW = 100;
+
+static const uint32_t MAX_ITERATIONS = 1000000;
+static const double TOLERANCE = 1e-12;
+
+// Gains below float resolution of the largest are noise
+static const double GAIN_NOISE = 1e-6;
+
+typedef double matrix_t[N][N];
+
+// One closed-loop period from state x with demands u
+static void advance(const float * x, const float * u, float * xnext)
+{
+    float demands[M] = {u[0], u[1], u[2], u[3]};
+    float motors[hf::Dynamics::NMOTORS] = {};
+    hf::StaticMixerQuadXMW::mix(demands, motors);
+
+    hf::Dynamics dynamics;
+    dynamics.setAirborne(ALTITUDE);
+    memcpy(dynamics.x, x, sizeof(dynamics.x));
+
+    for (uint8_t s=0; s<SUBSTEPS; ++s) {
+        dynamics.update(motors, (float)(PERIOD / SUBSTEPS));
+    }
+
+    memcpy(xnext, dynamics.x, sizeof(dynamics.x));
+}
+
+// Throttle demand at which the vehicle neither climbs nor sinks
+static float hoverThrottle(void)
+{
+    float lo = -1, hi = +1;
+
+    for (uint8_t k=0; k<40; ++k) {
+        float mid = (lo + hi) / 2;
+        float x[N] = {}, xnext[N] = {};
+        float u[M] = {mid, 0, 0, 0};
+        x[hf::State::Z] = ALTITUDE;
+        advance(x, u, xnext);
+        if (xnext[hf::State::DZ] > 0) {
+            hi = mid;
+        }
+        else {
+            lo = mid;
+        }
+    }
+
+    return (lo + hi) / 2;
+}
+
+static void linearize(float throttle, matrix_t & A, double (&B)[N][M])
+{
+    float x0[N] = {};
+    x0[hf::State::Z] = ALTITUDE;
+    float u0[M] = {throttle, 0, 0, 0};
+
+    for (uint8_t k=0; k<N; ++k) {
+        float xp[N], xm[N], fp[N], fm[N];
+        memcpy(xp, x0, sizeof(xp));
+        memcpy(xm, x0, sizeof(xm));
+        xp[k] += EPSILON;
+        xm[k] -= EPSILON;
+        advance(xp, u0, fp);
+        advance(xm, u0, fm);
+        for (uint8_t i=0; i<N; ++i) {
+            A[i][k] = (fp[i] - fm[i]) / (2 * EPSILON);
+        }
+    }
+
+    for (uint8_t k=0; k<M; ++k) {
+        float up[M], um[M], fp[N], fm[N];
+        memcpy(up, u0, sizeof(up));
+        memcpy(um, u0, sizeof(um));
+        up[k] += EPSILON;
+        um[k] -= EPSILON;
+        advance(x0, up, fp);
+        advance(x0, um, fm);
+        for (uint8_t i=0; i<N; ++i) {
+            B[i][k] = (fp[i] - fm[i]) / (2 * EPSILON);
+        }
+    }
+
+    // Drop finite-difference noise below float resolution
+    for (uint8_t i=0; i<N; ++i) {
+        for (uint8_t k=0; k<N; ++k) {
+            A[i][k] = fabs(A[i][k]) < 1e-4 ? 0 : A[i][k];
+        }
+        for (uint8_t k=0; k<M; ++k) {
+            B[i][k] = fabs(B[i][k]) < 1e-6 ? 0 : B[i][k];
+        }
+    }
+}
+
+// In-place Gauss-Jordan inverse of a small positive-definite matrix
+static void invert(double (&S)[M][M])
+{
+    double I[M][M] = {};
+    for (uint8_t i=0; i<M; ++i) {
+        I[i][i] = 1;
+    }
+
+    for (uint8_t c=0; c<M; ++c) {
+        double pivot = S[c][c];
+        for (uint8_t k=0; k<M; ++k) {
+            S[c][k] /= pivot;
+            I[c][k] /= pivot;
+        }
+        for (uint8_t r=0; r<M; ++r) {
+            if (r != c) {
+                double f = S[r][c];
+                for (uint8_t k=0; k<M; ++k) {
+                    S[r][k] -= f * S[c][k];
+                    I[r][k] -= f * I[c][k];
+                }
+            }
+        }
+    }
+
+    memcpy(S, I, sizeof(I));
+}
+
+// Iterates P = Q + A'PA - A'PB (R + B'PB)^-1 B'PA; returns K = (R + B'PB)^-1 B'PA
+static bool riccati(const matrix_t & A, const double (&B)[N][M], const double * Q, const double * R,
+        double (&K)[M][N])
+{
+    static matrix_t P;
+    memset(P, 0, sizeof(P));
+    for (uint8_t i=0; i<N; ++i) {
+        P[i][i] = Q[i];
+    }
+
+    for (uint32_t iter=0; iter<MAX_ITERATIONS; ++iter) {
+
+        // PA, PB
+        double PA[N][N] = {}, PB[N][M] = {};
+        for (uint8_t i=0; i<N; ++i) {
+            for (uint8_t j=0; j<N; ++j) {
+                for (uint8_t k=0; k<N; ++k) {
+                    PA[i][j] += P[i][k] * A[k][j];
+                }
+            }
+            for (uint8_t j=0; j<M; ++j) {
+                for (uint8_t k=0; k<N; ++k) {
+                    PB[i][j] += P[i][k] * B[k][j];
+                }
+            }
+        }
+
+        // S = R + B'PB, K = S^-1 B'PA
+        double S[M][M] = {}, BtPA[M][N] = {};
+        for (uint8_t i=0; i<M; ++i) {
+            S[i][i] = R[i];
+            for (uint8_t j=0; j<M; ++j) {
+                for (uint8_t k=0; k<N; ++k) {
+                    S[i][j] += B[k][i] * PB[k][j];
+                }
+            }
+            for (uint8_t j=0; j<N; ++j) {
+                for (uint8_t k=0; k<N; ++k) {
+                    BtPA[i][j] += B[k][i] * PA[k][j];
+                }
+            }
+        }
+        invert(S);
+        memset(K, 0, sizeof(K));
+        for (uint8_t i=0; i<M; ++i) {
+            for (uint8_t j=0; j<N; ++j) {
+                for (uint8_t k=0; k<M; ++k) {
+                    K[i][j] += S[i][k] * BtPA[k][j];
+                }
+            }
+        }
+
+        // Pnext = Q + A'(PA - PB K)
+        double change = 0, size = 0;
+        static matrix_t Pnext;
+        for (uint8_t i=0; i<N; ++i) {
+            for (uint8_t j=0; j<N; ++j) {
+                double acc = i == j ? Q[i] : 0;
+                for (uint8_t k=0; k<N; ++k) {
+                    double PABK = PA[k][j];
+                    for (uint8_t l=0; l<M; ++l) {
+                        PABK -= PB[k][l] * K[l][j];
+                    }
+                    acc += A[k][i] * PABK;
+                }
+                Pnext[i][j] = acc;
+                change = fmax(change, fabs(acc - P[i][j]));
+                size = fmax(size, fabs(acc));
+            }
+        }
+
+        memcpy(P, Pnext, sizeof(P));
+
+        if (change <= TOLERANCE * size) {
+            printf("Riccati converged in %u iterations\n", iter+1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Time for a unit error in one state to decay to 5% on the linear closed loop
+static double settlingTime(const matrix_t & A, const double (&B)[N][M], const double (&K)[M][N], uint8_t index)
+{
+    double x[N] = {};
+    x[index] = 1;
+
+    double settled = 0;
+
+    for (uint32_t step=1; step<100000; ++step) {
+
+        double u[M] = {}, xnext[N] = {};
+        for (uint8_t i=0; i<M; ++i) {
+            for (uint8_t j=0; j<N; ++j) {
+                u[i] -= K[i][j] * x[j];
+            }
+        }
+        for (uint8_t i=0; i<N; ++i) {
+            for (uint8_t j=0; j<N; ++j) {
+                xnext[i] += A[i][j] * x[j];
+            }
+            for (uint8_t j=0; j<M; ++j) {
+                xnext[i] += B[i][j] * u[j];
+            }
+        }
+        memcpy(x, xnext, sizeof(x));
+
+        if (fabs(x[index]) > 0.05) {
+            settled = step * PERIOD;
+        }
+    }
+
+    return settled;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * filename = argc > 1 ? argv[1] : "../../src/pidcontrollers/lqr_gains.hpp";
+
+    float throttle = hoverThrottle();
+
+    static matrix_t A;
+    double B[N][M] = {};
+    linearize(throttle, A, B);
+
+    double Q[N] = {};
+    Q[hf::State::PHI] = Q_ANGLE;
+    Q[hf::State::THETA] = Q_ANGLE;
+    Q[hf::State::DPHI] = Q_RATE;
+    Q[hf::State::DTHETA] = Q_RATE;
+    Q[hf::State::DPSI] = Q_YAW_RATE;
+
+    double R[M] = {};
+    R[hf::DEMANDS_THROTTLE] = R_THROTTLE;
+    R[hf::DEMANDS_ROLL] = R_ROLL_PITCH;
+    R[hf::DEMANDS_PITCH] = R_ROLL_PITCH;
+    R[hf::DEMANDS_YAW] = R_YAW;
+
+    double K[M][N] = {};
+    if (!riccati(A, B, Q, R, K)) {
+        fprintf(stderr, "Riccati iteration did not converge\n");
+        return 1;
+    }
+
+    printf("Hover throttle demand %3.4f; linear-model 5%% settling: roll %3.2f sec, yaw rate %3.2f sec\n",
+            throttle, settlingTime(A, B, K, hf::State::PHI), settlingTime(A, B, K, hf::State::DPSI));
+
+    // Each axis feeds back only from its own angle and rate, and yaw only from
+    // yaw rate; the header keeps just those gains, so check that the rest are zero
+    bool kept[M][N] = {};
+    kept[hf::DEMANDS_ROLL][hf::State::PHI] = true;
+    kept[hf::DEMANDS_ROLL][hf::State::DPHI] = true;
+    kept[hf::DEMANDS_PITCH][hf::State::THETA] = true;
+    kept[hf::DEMANDS_PITCH][hf::State::DTHETA] = true;
+    kept[hf::DEMANDS_YAW][hf::State::DPSI] = true;
+
+    for (uint8_t i=0; i<M; ++i) {
+        for (uint8_t j=0; j<N; ++j) {
+            if (!kept[i][j] && fabs(K[i][j]) >= GAIN_NOISE) {
+                fprintf(stderr, "Gain K[%u][%u] = %g is not zero\n", i, j, K[i][j]);
+                return 1;
+            }
+        }
+    }
+
+    FILE * fp = fopen(filename, "w");
+
+    if (!fp) {
+        fprintf(stderr, "Unable to write %s\n", filename);
+        return 1;
+    }
+
+    fprintf(fp,
+            "/*\n"
+            "   LqrController gains: generated by extras/sitl/lqrgains.cpp; do not edit\n"
+            "\n"
+            "   Copyright (c) 2021 Simon D. Levy\n"
+            "\n"
+            "   MIT License\n"
+            " */\n"
+            "\n"
+            "#pragma once\n"
+            "\n"
+            "namespace hf {\n"
+            "\n"
+            "    namespace lqr {\n"
+            "\n"
+            "        // The rows of K for roll, pitch, yaw, without the gains that are zero:\n"
+            "        // those on other axes, on unweighted states, and for throttle\n"
+            "        // Q: angle %g, rate %g, yaw rate %g; R: throttle %g, roll/pitch %g, yaw %g\n"
+            "\n"
+            "        // On PHI, DPHI\n"
+            "        static constexpr float ROLL[2] = {%.9g, %.9g};\n"
+            "\n"
+            "        // On THETA, DTHETA\n"
+            "        static constexpr float PITCH[2] = {%.9g, %.9g};\n"
+            "\n"
+            "        // On DPSI\n"
+            "        static constexpr float YAW = %.9g;\n"
+            "\n"
+            "    } // namespace lqr\n"
+            "\n"
+            "} // namespace hf\n",
+            Q_ANGLE, Q_RATE, Q_YAW_RATE, R_THROTTLE, R_ROLL_PITCH, R_YAW,
+            K[hf::DEMANDS_ROLL][hf::State::PHI], K[hf::DEMANDS_ROLL][hf::State::DPHI],
+            K[hf::DEMANDS_PITCH][hf::State::THETA], K[hf::DEMANDS_PITCH][hf::State::DTHETA],
+            K[hf::DEMANDS_YAW][hf::State::DPSI]);
+
+    fclose(fp);
+
+    printf("Wrote %s\n", filename);
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+   Collects training and test data for MlpController by flying the
+   Level/Rate/Yaw PID chain in SITL and recording, at each closed-loop
+   update, the policy inputs going into the chain and the roll, pitch, and
+   yaw demands coming out of it
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "sitl.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/mlp.hpp"
+
+namespace hf {
+
+    typedef struct {
+
+        float inputs[MlpController::NINPUTS];
+        float outputs[MlpController::NOUTPUTS];
+
+    } mlp_sample_t;
+
+    // Flight envelope: the largest attitude (radians), angular velocity
+    // (radians / sec), and roll/pitch/yaw demand (full stick, at the SITL
+    // receiver's demand scale of 1) the policy is expected to see.  Flights
+    // start and fly across all of it, and the quantized policy maps its edges
+    // to full int16 scale.
+    static const float MLP_MAX_ANGLE = (float)M_PI / 2;
+    static const float MLP_MAX_RATE = (float)M_PI;
+    static const float MLP_MAX_DEMAND = 0.5f;
+
+    static const float MLP_ENVELOPE[MlpController::NINPUTS] = {
+        MLP_MAX_ANGLE, MLP_MAX_ANGLE,
+        MLP_MAX_RATE, MLP_MAX_RATE, MLP_MAX_RATE,
+        MLP_MAX_DEMAND, MLP_MAX_DEMAND, MLP_MAX_DEMAND
+    };
+
+    static bool mlpInEnvelope(const mlp_sample_t & sample)
+    {
+        for (uint8_t k=0; k<MlpController::NINPUTS; ++k) {
+            if (fabsf(sample.inputs[k]) > MLP_ENVELOPE[k]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Pass-through controller that copies what it sees into a sample
+    class MlpTap : public rft::PidController {
+
+        private:
+
+            mlp_sample_t * _sample = NULL;
+            bool _input = false;
+
+        public:
+
+            uint32_t count = 0;
+
+            MlpTap(mlp_sample_t * sample, bool input)
+            {
+                _sample = sample;
+                _input = input;
+            }
+
+            virtual void modifyDemands(rft::State * state, float * demands) override
+            {
+                if (_input) {
+                    MlpController::getInputs((State *)state, demands, _sample->inputs);
+                }
+                else {
+                    _sample->outputs[0] = demands[DEMANDS_ROLL];
+                    _sample->outputs[1] = demands[DEMANDS_PITCH];
+                    _sample->outputs[2] = demands[DEMANDS_YAW];
+                }
+
+                count++;
+            }
+
+    }; // class MlpTap
+
+    // One flight with random initial attitude and angular velocity, and random
+    // full-range stick steps; samples outside the envelope are left out
+    static void collectMlpSamples(uint32_t seed, double duration, std::vector<mlp_sample_t> & samples)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> uniform(-1, +1);
+
+        // Far enough from the envelope's edges that the chain pulls the vehicle back inside
+        static const float START_ANGLE = 0.75f * MLP_MAX_ANGLE;
+        static const float START_RATE = 0.5f * MLP_MAX_RATE;
+
+        mlp_sample_t sample = {};
+
+        MlpTap tapIn(&sample, true);
+        MlpTap tapOut(&sample, false);
+
+        RatePid ratePid(0.225, 0.001875, 0.375);
+        YawPid yawPid(2, 0.1);
+        LevelPid levelPid(0.20f);
+
+        Sitl sitl;
+
+        sitl.hackflight.addClosedLoopController(&tapIn);
+        sitl.hackflight.addClosedLoopController(&levelPid);
+        sitl.hackflight.addClosedLoopController(&ratePid);
+        sitl.hackflight.addClosedLoopController(&yawPid);
+        sitl.hackflight.addClosedLoopController(&tapOut);
+
+        sitl.sensors.setNoise(0.002f, 0.01f, rng());
+
+        sitl.begin();
+
+        sitl.dynamics.setAttitude(START_ANGLE * uniform(rng), START_ANGLE * uniform(rng), (float)M_PI * uniform(rng));
+        sitl.dynamics.setAirborne(100);
+
+        sitl.dynamics.x[State::DPHI] = START_RATE * uniform(rng);
+        sitl.dynamics.x[State::DTHETA] = START_RATE * uniform(rng);
+        sitl.dynamics.x[State::DPSI] = START_RATE * uniform(rng);
+
+        float roll = 0, pitch = 0, yaw = 0;
+        double nextStick = 0;
+
+        while (sitl.time() < duration) {
+
+            // Hold each stick position for a quarter second to a second; centered a third of the time
+            if (sitl.time() >= nextStick) {
+                bool centered = uniform(rng) < -1.f/3;
+                roll = centered ? 0 : uniform(rng);
+                pitch = centered ? 0 : uniform(rng);
+                yaw = centered ? 0 : uniform(rng);
+                nextStick = sitl.time() + 0.625 + 0.375 * uniform(rng);
+            }
+
+            sitl.receiver.setSticks(0.14f, roll, pitch, yaw, +1);
+
+            // A new sample shows up when the closed loop runs
+            uint32_t count = tapOut.count;
+
+            sitl.step();
+
+            if (tapOut.count != count && mlpInEnvelope(sample)) {
+                samples.push_back(sample);
+            }
+        }
+    }
+
+} // namespace hf
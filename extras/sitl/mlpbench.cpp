@@ -0,0 +1,261 @@
+/*
+   Checks MlpController against the float network it was quantized from
+   and the PID chain it was trained to imitate: per-call latency of the
+   fixed-point and float kernels and of the Level/Rate/Yaw chain,
+   fixed-vs-float and fixed-vs-PID error on fresh flight data,
+   fixed-vs-float error across the whole flight envelope, and a
+   closed-loop SITL flight with each controller
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "mlp_data.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const uint8_t NINPUTS = hf::MlpController::NINPUTS;
+static const uint8_t NOUTPUTS = hf::MlpController::NOUTPUTS;
+
+// Seeds past the ones mlptrain uses
+static const uint32_t FIRST_SEED = 1000;
+static const uint32_t NFLIGHTS = 4;
+static const double FLIGHT_DURATION = 10;
+
+static const double DT = 0.001;
+static const double CLOSED_LOOP_DURATION = 30;
+
+// Roughly as many repetitions as it takes to swamp the timer
+static const uint32_t TIMING_REPS = 20;
+
+template <typename Work>
+static double nsecPerCall(const std::vector<hf::mlp_sample_t> & samples, Work work)
+{
+    float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t r=0; r<TIMING_REPS; ++r) {
+        for (const hf::mlp_sample_t & sample : samples) {
+            sink += work(sample);
+        }
+    }
+
+    double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        (TIMING_REPS * samples.size());
+
+    // Keep the optimizer from discarding the loop
+    return sink == 12345 ? 0 : nsec;
+}
+
+// Rebuilds the state and demands a PID chain would have seen for a sample
+static void unpack(const hf::mlp_sample_t & sample, hf::State & state, float * demands)
+{
+    state.x[hf::State::PHI] = sample.inputs[0];
+    state.x[hf::State::THETA] = sample.inputs[1];
+    state.x[hf::State::DPHI] = sample.inputs[2];
+    state.x[hf::State::DTHETA] = sample.inputs[3];
+    state.x[hf::State::DPSI] = sample.inputs[4];
+    demands[hf::DEMANDS_THROTTLE] = 0.14f;
+    demands[hf::DEMANDS_ROLL] = sample.inputs[5];
+    demands[hf::DEMANDS_PITCH] = sample.inputs[6];
+    demands[hf::DEMANDS_YAW] = sample.inputs[7];
+}
+
+static void timing(const std::vector<hf::mlp_sample_t> & samples)
+{
+    double fixed = nsecPerCall(samples, [](const hf::mlp_sample_t & sample) {
+        float outputs[NOUTPUTS] = {};
+        hf::MlpController::infer(sample.inputs, outputs);
+        return outputs[0];
+    });
+
+    double flt = nsecPerCall(samples, [](const hf::mlp_sample_t & sample) {
+        float outputs[NOUTPUTS] = {};
+        hf::MlpController::inferFloat(sample.inputs, outputs);
+        return outputs[0];
+    });
+
+    hf::LevelPid levelPid(0.20f);
+    hf::RatePid ratePid(0.225, 0.001875, 0.375);
+    hf::YawPid yawPid(2, 0.1);
+
+    double chain = nsecPerCall(samples, [&](const hf::mlp_sample_t & sample) {
+        hf::State state = {};
+        float demands[4] = {};
+        unpack(sample, state, demands);
+        levelPid.modifyDemands(&state, demands);
+        ratePid.modifyDemands(&state, demands);
+        yawPid.modifyDemands(&state, demands);
+        return demands[hf::DEMANDS_ROLL];
+    });
+
+    hf::MlpController mlp;
+
+    double controller = nsecPerCall(samples, [&](const hf::mlp_sample_t & sample) {
+        hf::State state = {};
+        float demands[4] = {};
+        unpack(sample, state, demands);
+        mlp.modifyDemands(&state, demands);
+        return demands[hf::DEMANDS_ROLL];
+    });
+
+    uint32_t macs = hf::mlp::NINPUTS * hf::mlp::NHIDDEN + hf::mlp::NHIDDEN * hf::mlp::NHIDDEN +
+        hf::mlp::NHIDDEN * hf::mlp::NOUTPUTS;
+
+    printf("Latency (%u multiply-adds per inference):\n", macs);
+    printf("  fixed-point infer():         %6.1f nsec\n", fixed);
+    printf("  float inferFloat():          %6.1f nsec\n", flt);
+    printf("  MlpController:               %6.1f nsec\n", controller);
+    printf("  Level/Rate/Yaw PID chain:    %6.1f nsec\n", chain);
+}
+
+static void accuracy(const std::vector<hf::mlp_sample_t> & samples)
+{
+    double fixedFloat = 0, fixedTarget = 0, floatTarget = 0, target = 0;
+    float maxFixedFloat = 0;
+
+    for (const hf::mlp_sample_t & sample : samples) {
+
+        float fixed[NOUTPUTS] = {}, flt[NOUTPUTS] = {};
+        hf::MlpController::infer(sample.inputs, fixed);
+        hf::MlpController::inferFloat(sample.inputs, flt);
+
+        for (uint8_t j=0; j<NOUTPUTS; ++j) {
+            fixedFloat += (fixed[j] - flt[j]) * (fixed[j] - flt[j]);
+            fixedTarget += (fixed[j] - sample.outputs[j]) * (fixed[j] - sample.outputs[j]);
+            floatTarget += (flt[j] - sample.outputs[j]) * (flt[j] - sample.outputs[j]);
+            target += sample.outputs[j] * sample.outputs[j];
+            maxFixedFloat = fmaxf(maxFixedFloat, fabsf(fixed[j] - flt[j]));
+        }
+    }
+
+    double n = samples.size() * NOUTPUTS;
+
+    printf("Accuracy on %lu fresh samples (RMS PID demand %3.5f):\n", (unsigned long)samples.size(), sqrt(target/n));
+    printf("  fixed vs. float:  RMS %3.6f, max %3.6f\n", sqrt(fixedFloat/n), maxFixedFloat);
+    printf("  float vs. PID:    RMS %3.6f\n", sqrt(floatTarget/n));
+    printf("  fixed vs. PID:    RMS %3.6f\n", sqrt(fixedTarget/n));
+}
+
+// Inputs drawn uniformly from the whole flight envelope, which the int16
+// inputs should cover without saturating
+static void envelope(void)
+{
+    static const uint32_t COUNT = 10000;
+
+    std::mt19937 rng(FIRST_SEED);
+    std::uniform_real_distribution<float> uniform(-1, +1);
+
+    double fixedFloat = 0, output = 0;
+    float maxFixedFloat = 0;
+    uint32_t saturated = 0;
+
+    for (uint32_t n=0; n<COUNT; ++n) {
+
+        float inputs[NINPUTS] = {};
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            inputs[k] = hf::MLP_ENVELOPE[k] * uniform(rng);
+            saturated += fabsf(inputs[k] * hf::mlp::INPUT_SCALE[k]) > 32767;
+        }
+
+        float fixed[NOUTPUTS] = {}, flt[NOUTPUTS] = {};
+        hf::MlpController::infer(inputs, fixed);
+        hf::MlpController::inferFloat(inputs, flt);
+
+        for (uint8_t j=0; j<NOUTPUTS; ++j) {
+            fixedFloat += (fixed[j] - flt[j]) * (fixed[j] - flt[j]);
+            output += flt[j] * flt[j];
+            maxFixedFloat = fmaxf(maxFixedFloat, fabsf(fixed[j] - flt[j]));
+        }
+    }
+
+    printf("Across the flight envelope (%u random inputs, %u saturated, RMS float demand %3.5f):\n",
+            COUNT, saturated, sqrt(output/(COUNT*NOUTPUTS)));
+    printf("  fixed vs. float:  RMS %3.6f, max %3.6f\n", sqrt(fixedFloat/(COUNT*NOUTPUTS)), maxFixedFloat);
+}
+
+// Alternating roll and pitch steps, with a yaw step now and then
+static void setSticks(hf::SimReceiver & receiver, double t)
+{
+    float roll = fmod(t, 4) > 2 && fmod(t, 8) < 4 ? 0.3f : 0;
+    float pitch = fmod(t, 4) > 2 && fmod(t, 8) > 4 ? 0.3f : 0;
+    float yaw = fmod(t, 10) > 8 ? 0.3f : 0;
+
+    receiver.setSticks(0.14f, roll, pitch, yaw, +1);
+}
+
+static void fly(hf::Sitl & sitl, std::vector<float> & log)
+{
+    sitl.begin();
+
+    sitl.dynamics.setAttitude(0.2f, -0.2f, 0);
+    sitl.dynamics.setAirborne(100);
+
+    while (sitl.time() < CLOSED_LOOP_DURATION) {
+        setSticks(sitl.receiver, sitl.time());
+        sitl.step();
+        log.push_back(sitl.dynamics.x[hf::State::PHI]);
+        log.push_back(sitl.dynamics.x[hf::State::THETA]);
+        log.push_back(sitl.dynamics.x[hf::State::DPSI]);
+    }
+}
+
+static void closedLoop(void)
+{
+    hf::Sitl pidSitl(DT);
+    hf::LevelPid levelPid(0.20f);
+    hf::RatePid ratePid(0.225, 0.001875, 0.375);
+    hf::YawPid yawPid(2, 0.1);
+    pidSitl.hackflight.addClosedLoopController(&levelPid);
+    pidSitl.hackflight.addClosedLoopController(&ratePid);
+    pidSitl.hackflight.addClosedLoopController(&yawPid);
+
+    hf::Sitl mlpSitl(DT);
+    hf::MlpController mlp;
+    mlpSitl.hackflight.addClosedLoopController(&mlp);
+
+    std::vector<float> pidLog, mlpLog;
+    fly(pidSitl, pidLog);
+    fly(mlpSitl, mlpLog);
+
+    double diff[3] = {}, range[3] = {};
+    for (size_t k=0; k<pidLog.size(); ++k) {
+        diff[k%3] += (pidLog[k] - mlpLog[k]) * (pidLog[k] - mlpLog[k]);
+        range[k%3] = fmax(range[k%3], fabs(pidLog[k]));
+    }
+
+    double n = pidLog.size() / 3;
+
+    printf("Closed loop, %2.0f sec of roll/pitch/yaw steps, MlpController vs. PID chain:\n", CLOSED_LOOP_DURATION);
+    printf("  roll  RMS difference %3.4f rad   (PID peak %3.4f)\n", sqrt(diff[0]/n), range[0]);
+    printf("  pitch RMS difference %3.4f rad   (PID peak %3.4f)\n", sqrt(diff[1]/n), range[1]);
+    printf("  yaw   RMS difference %3.4f rad/s (PID peak %3.4f)\n", sqrt(diff[2]/n), range[2]);
+}
+
+int main(int, char **)
+{
+    std::vector<hf::mlp_sample_t> samples;
+
+    for (uint32_t f=0; f<NFLIGHTS; ++f) {
+        hf::collectMlpSamples(FIRST_SEED + f, FLIGHT_DURATION, samples);
+    }
+
+    timing(samples);
+    accuracy(samples);
+    envelope();
+    closedLoop();
+
+    return 0;
+}
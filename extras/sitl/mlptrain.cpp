@@ -0,0 +1,524 @@
+/*
+   Trains the MlpController policy to imitate the Level/Rate/Yaw PID chain
+   on SITL flight data, quantizes it, and writes the weights header
+
+   The float network is trained with Adam on normalized inputs and
+   outputs; the normalization is then folded into the first and last
+   layers.  For the fixed-point network, each hidden layer's weights get
+   one int8 scale, and each output its own.  The int16 inputs get scales
+   that keep the flight envelope in mlp_data.hpp inside int16 range, and
+   each hidden layer's int16 activations a scale from the largest
+   activation any input in the envelope can produce.  The rescaling between hidden
+   layers becomes an integer multiplier and shift.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "mlp_data.hpp"
+#include "workpool.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const uint8_t NINPUTS = hf::MlpController::NINPUTS;
+static const uint8_t NOUTPUTS = hf::MlpController::NOUTPUTS;
+static const uint8_t NHIDDEN = 8;
+
+static const uint32_t NFLIGHTS = 48;
+static const double FLIGHT_DURATION = 10;
+
+static const uint32_t EPOCHS = 30;
+static const uint32_t BATCH = 64;
+static const float LEARNING_RATE = 3e-3f;
+
+// All float, so it can be treated as one parameter vector
+typedef struct {
+
+    float W1[NHIDDEN][NINPUTS];
+    float B1[NHIDDEN];
+    float W2[NHIDDEN][NHIDDEN];
+    float B2[NHIDDEN];
+    float W3[NOUTPUTS][NHIDDEN];
+    float B3[NOUTPUTS];
+
+} network_t;
+
+static const size_t NPARAMS = sizeof(network_t) / sizeof(float);
+
+static void forward(const network_t & net, const float * x, float * h1, float * h2, float * y)
+{
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        float acc = net.B1[j];
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            acc += net.W1[j][k] * x[k];
+        }
+        h1[j] = acc > 0 ? acc : 0;
+    }
+
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        float acc = net.B2[j];
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            acc += net.W2[j][k] * h1[k];
+        }
+        h2[j] = acc > 0 ? acc : 0;
+    }
+
+    for (uint8_t j=0; j<NOUTPUTS; ++j) {
+        float acc = net.B3[j];
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            acc += net.W3[j][k] * h2[k];
+        }
+        y[j] = acc;
+    }
+}
+
+// Adds the gradient of the squared error for one sample into grad
+static void backward(const network_t & net, const float * x, const float * t, network_t & grad)
+{
+    float h1[NHIDDEN], h2[NHIDDEN], y[NOUTPUTS];
+    forward(net, x, h1, h2, y);
+
+    float dy[NOUTPUTS];
+    for (uint8_t j=0; j<NOUTPUTS; ++j) {
+        dy[j] = 2 * (y[j] - t[j]) / NOUTPUTS;
+        grad.B3[j] += dy[j];
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            grad.W3[j][k] += dy[j] * h2[k];
+        }
+    }
+
+    float dh2[NHIDDEN] = {};
+    for (uint8_t k=0; k<NHIDDEN; ++k) {
+        for (uint8_t j=0; j<NOUTPUTS; ++j) {
+            dh2[k] += net.W3[j][k] * dy[j];
+        }
+        dh2[k] = h2[k] > 0 ? dh2[k] : 0;
+        grad.B2[k] += dh2[k];
+        for (uint8_t i=0; i<NHIDDEN; ++i) {
+            grad.W2[k][i] += dh2[k] * h1[i];
+        }
+    }
+
+    float dh1[NHIDDEN] = {};
+    for (uint8_t i=0; i<NHIDDEN; ++i) {
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            dh1[i] += net.W2[k][i] * dh2[k];
+        }
+        dh1[i] = h1[i] > 0 ? dh1[i] : 0;
+        grad.B1[i] += dh1[i];
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            grad.W1[i][k] += dh1[i] * x[k];
+        }
+    }
+}
+
+static double rmsError(const network_t & net, const std::vector<hf::mlp_sample_t> & samples)
+{
+    double sum = 0;
+
+    for (const hf::mlp_sample_t & sample : samples) {
+        float h1[NHIDDEN], h2[NHIDDEN], y[NOUTPUTS];
+        forward(net, sample.inputs, h1, h2, y);
+        for (uint8_t j=0; j<NOUTPUTS; ++j) {
+            sum += (y[j] - sample.outputs[j]) * (y[j] - sample.outputs[j]);
+        }
+    }
+
+    return sqrt(sum / (samples.size() * NOUTPUTS));
+}
+
+static network_t train(std::vector<hf::mlp_sample_t> samples, const float * xmean, const float * xstd, const float * ystd)
+{
+    std::mt19937 rng(0);
+
+    for (hf::mlp_sample_t & sample : samples) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            sample.inputs[k] = (sample.inputs[k] - xmean[k]) / xstd[k];
+        }
+        for (uint8_t k=0; k<NOUTPUTS; ++k) {
+            sample.outputs[k] /= ystd[k];
+        }
+    }
+
+    // He initialization
+    network_t net = {};
+    std::normal_distribution<float> normal;
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            net.W1[j][k] = normal(rng) * sqrtf(2.f / NINPUTS);
+        }
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            net.W2[j][k] = normal(rng) * sqrtf(2.f / NHIDDEN);
+        }
+    }
+    for (uint8_t j=0; j<NOUTPUTS; ++j) {
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            net.W3[j][k] = normal(rng) * sqrtf(1.f / NHIDDEN);
+        }
+    }
+
+    // Adam
+    std::vector<float> m(NPARAMS), v(NPARAMS);
+    const float beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f;
+    uint32_t t = 0;
+
+    float * params = (float *)&net;
+
+    for (uint32_t epoch=0; epoch<EPOCHS; ++epoch) {
+
+        std::shuffle(samples.begin(), samples.end(), rng);
+
+        // Step the learning rate down over the last two thirds
+        float lr = LEARNING_RATE * (epoch < EPOCHS/3 ? 1 : (epoch < 2*EPOCHS/3 ? 0.3f : 0.1f));
+
+        for (size_t start=0; start+BATCH<=samples.size(); start+=BATCH) {
+
+            network_t grad = {};
+
+            for (size_t s=start; s<start+BATCH; ++s) {
+                backward(net, samples[s].inputs, samples[s].outputs, grad);
+            }
+
+            float * g = (float *)&grad;
+
+            t++;
+
+            for (size_t p=0; p<NPARAMS; ++p) {
+                float gp = g[p] / BATCH;
+                m[p] = beta1 * m[p] + (1 - beta1) * gp;
+                v[p] = beta2 * v[p] + (1 - beta2) * gp * gp;
+                float mhat = m[p] / (1 - powf(beta1, t));
+                float vhat = v[p] / (1 - powf(beta2, t));
+                params[p] -= lr * mhat / (sqrtf(vhat) + epsilon);
+            }
+        }
+
+        if (epoch % 5 == 4) {
+            printf("Epoch %2u: RMS error %3.5f (normalized)\n", epoch+1, rmsError(net, samples));
+            fflush(stdout);
+        }
+    }
+
+    // Fold normalization into the first and last layers
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            net.W1[j][k] /= xstd[k];
+            net.B1[j] -= net.W1[j][k] * xmean[k];
+        }
+    }
+    for (uint8_t j=0; j<NOUTPUTS; ++j) {
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            net.W3[j][k] *= ystd[j];
+        }
+        net.B3[j] *= ystd[j];
+    }
+
+    return net;
+}
+
+// Multiplier in [2^30, 2^31) and shift such that value ~= multiplier / 2^shift
+static void multiplierAndShift(double value, int32_t & multiplier, uint8_t & shift)
+{
+    shift = 0;
+
+    while (value < (1u << 30) && shift < 62) {
+        value *= 2;
+        shift++;
+    }
+
+    multiplier = (int32_t)lround(value);
+}
+
+static float maxAbs(const float * values, size_t count)
+{
+    float m = 0;
+    for (size_t k=0; k<count; ++k) {
+        m = fmaxf(m, fabsf(values[k]));
+    }
+    return m;
+}
+
+typedef struct {
+
+    float inputScale[NINPUTS];
+
+    int8_t W1[NHIDDEN][NINPUTS];
+    int32_t B1[NHIDDEN];
+    int32_t M1;
+    uint8_t S1;
+
+    int8_t W2[NHIDDEN][NHIDDEN];
+    int32_t B2[NHIDDEN];
+    int32_t M2;
+    uint8_t S2;
+
+    int8_t W3[NOUTPUTS][NHIDDEN];
+    int32_t B3[NOUTPUTS];
+
+    float outputScale[NOUTPUTS];
+
+} quantized_t;
+
+static quantized_t quantize(const network_t & net)
+{
+    quantized_t q = {};
+
+    // Largest activation each hidden neuron can reach anywhere in the
+    // envelope: bounded over the box of inputs, then over the box of
+    // first-layer activations that gives
+    float h1max[NHIDDEN] = {};
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        float acc = net.B1[j];
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            acc += fabsf(net.W1[j][k]) * hf::MLP_ENVELOPE[k];
+        }
+        h1max[j] = fmaxf(acc, 0);
+    }
+    float h2max[NHIDDEN] = {};
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        float acc = net.B2[j];
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            acc += fmaxf(net.W2[j][k], 0) * h1max[k];
+        }
+        h2max[j] = fmaxf(acc, 0);
+    }
+
+    // Largest first-layer weight on each input
+    float w1max[NINPUTS] = {};
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            w1max[k] = fmaxf(w1max[k], fabsf(net.W1[j][k]));
+        }
+    }
+
+    // One int16 step of each input must be no finer than the envelope over
+    // full scale, so inputs saturate only outside it; inputs the first layer
+    // weighs less get coarser steps, so each one's weights use the full int8
+    // range
+    float step = 0;
+    for (uint8_t k=0; k<NINPUTS; ++k) {
+        step = fmaxf(step, w1max[k] * hf::MLP_ENVELOPE[k] / 32767);
+    }
+
+    // Real value of one int16 step at each layer's input
+    float sx[NINPUTS] = {};
+    for (uint8_t k=0; k<NINPUTS; ++k) {
+        sx[k] = w1max[k] > 0 ? step / w1max[k] : hf::MLP_ENVELOPE[k] / 32767;
+        q.inputScale[k] = 1 / sx[k];
+    }
+    float sh1 = maxAbs(h1max, NHIDDEN) / 32767;
+    float sh2 = maxAbs(h2max, NHIDDEN) / 32767;
+
+    // Layer 1: the per-input scales go into the weights
+    float W1[NHIDDEN][NINPUTS] = {};
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            W1[j][k] = net.W1[j][k] * sx[k];
+        }
+    }
+    float sw1 = maxAbs(&W1[0][0], NHIDDEN*NINPUTS) / 127;
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            q.W1[j][k] = (int8_t)lroundf(W1[j][k] / sw1);
+        }
+        q.B1[j] = (int32_t)lroundf(net.B1[j] / sw1);
+    }
+    multiplierAndShift(sw1 / sh1, q.M1, q.S1);
+
+    // Layer 2
+    float sw2 = maxAbs(&net.W2[0][0], NHIDDEN*NHIDDEN) * sh1 / 127;
+    for (uint8_t j=0; j<NHIDDEN; ++j) {
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            q.W2[j][k] = (int8_t)lroundf(net.W2[j][k] * sh1 / sw2);
+        }
+        q.B2[j] = (int32_t)lroundf(net.B2[j] / sw2);
+    }
+    multiplierAndShift(sw2 / sh2, q.M2, q.S2);
+
+    // Output layer: each accumulator times its own float scale, as the
+    // outputs' ranges differ
+    for (uint8_t j=0; j<NOUTPUTS; ++j) {
+        float sw3 = maxAbs(net.W3[j], NHIDDEN) * sh2 / 127;
+        for (uint8_t k=0; k<NHIDDEN; ++k) {
+            q.W3[j][k] = (int8_t)lroundf(net.W3[j][k] * sh2 / sw3);
+        }
+        q.B3[j] = (int32_t)lroundf(net.B3[j] / sw3);
+        q.outputScale[j] = sw3;
+    }
+
+    return q;
+}
+
+template <typename T>
+static void writeArray(FILE * fp, const char * type, const char * name, const T * values, uint8_t rows, uint8_t cols,
+        const char * rowsName, const char * colsName, const char * format)
+{
+    if (cols) {
+        fprintf(fp, "        static constexpr %s %s[%s][%s] = {\n", type, name, rowsName, colsName);
+    }
+    else {
+        fprintf(fp, "        static constexpr %s %s[%s] = {\n", type, name, rowsName);
+    }
+
+    for (uint8_t j=0; j<rows; ++j) {
+        fprintf(fp, "            ");
+        uint8_t n = cols ? cols : 1;
+        if (cols) {
+            fprintf(fp, "{");
+        }
+        for (uint8_t k=0; k<n; ++k) {
+            fprintf(fp, format, values[j*n+k]);
+            if (k < n-1) {
+                fprintf(fp, ", ");
+            }
+        }
+        fprintf(fp, cols ? "},\n" : ",\n");
+    }
+
+    fprintf(fp, "        };\n\n");
+}
+
+static bool writeHeader(const char * filename, const network_t & net, const quantized_t & q)
+{
+    FILE * fp = fopen(filename, "w");
+
+    if (!fp) {
+        return false;
+    }
+
+    fprintf(fp,
+            "/*\n"
+            "   MlpController weights: generated by extras/sitl/mlptrain.cpp; do not edit\n"
+            "\n"
+            "   Copyright (c) 2021 Simon D. Levy\n"
+            "\n"
+            "   MIT License\n"
+            " */\n"
+            "\n"
+            "#pragma once\n"
+            "\n"
+            "#include <stdint.h>\n"
+            "\n"
+            "namespace hf {\n"
+            "\n"
+            "    namespace mlp {\n"
+            "\n"
+            "        static const uint8_t NINPUTS = %u;\n"
+            "        static const uint8_t NHIDDEN = %u;\n"
+            "        static const uint8_t NOUTPUTS = %u;\n"
+            "\n"
+            "        // Input to int16\n",
+            NINPUTS, NHIDDEN, NOUTPUTS);
+
+    writeArray(fp, "float", "INPUT_SCALE", q.inputScale, NINPUTS, 0, "NINPUTS", NULL, "%.9g");
+
+    fprintf(fp, "        // Hidden layer 1: int16 = relu(WEIGHTS1 x + BIASES1) * MULTIPLIER1 >> SHIFT1\n");
+    writeArray(fp, "int8_t", "WEIGHTS1", &q.W1[0][0], NHIDDEN, NINPUTS, "NHIDDEN", "NINPUTS", "%4d");
+    writeArray(fp, "int32_t", "BIASES1", q.B1, NHIDDEN, 0, "NHIDDEN", NULL, "%d");
+    fprintf(fp, "        static const int32_t MULTIPLIER1 = %d;\n", q.M1);
+    fprintf(fp, "        static const uint8_t SHIFT1 = %u;\n\n", q.S1);
+
+    fprintf(fp, "        // Hidden layer 2\n");
+    writeArray(fp, "int8_t", "WEIGHTS2", &q.W2[0][0], NHIDDEN, NHIDDEN, "NHIDDEN", "NHIDDEN", "%4d");
+    writeArray(fp, "int32_t", "BIASES2", q.B2, NHIDDEN, 0, "NHIDDEN", NULL, "%d");
+    fprintf(fp, "        static const int32_t MULTIPLIER2 = %d;\n", q.M2);
+    fprintf(fp, "        static const uint8_t SHIFT2 = %u;\n\n", q.S2);
+
+    fprintf(fp, "        // Output layer: demand = (WEIGHTS3 h + BIASES3) * OUTPUT_SCALE\n");
+    writeArray(fp, "int8_t", "WEIGHTS3", &q.W3[0][0], NOUTPUTS, NHIDDEN, "NOUTPUTS", "NHIDDEN", "%4d");
+    writeArray(fp, "int32_t", "BIASES3", q.B3, NOUTPUTS, 0, "NOUTPUTS", NULL, "%d");
+    writeArray(fp, "float", "OUTPUT_SCALE", q.outputScale, NOUTPUTS, 0, "NOUTPUTS", NULL, "%.9g");
+
+    fprintf(fp, "#if !defined(ARDUINO)\n\n");
+    fprintf(fp, "        // Float weights, for checking the fixed-point ones on the host\n");
+    writeArray(fp, "float", "WEIGHTS1_FLOAT", &net.W1[0][0], NHIDDEN, NINPUTS, "NHIDDEN", "NINPUTS", "%.9g");
+    writeArray(fp, "float", "BIASES1_FLOAT", net.B1, NHIDDEN, 0, "NHIDDEN", NULL, "%.9g");
+    writeArray(fp, "float", "WEIGHTS2_FLOAT", &net.W2[0][0], NHIDDEN, NHIDDEN, "NHIDDEN", "NHIDDEN", "%.9g");
+    writeArray(fp, "float", "BIASES2_FLOAT", net.B2, NHIDDEN, 0, "NHIDDEN", NULL, "%.9g");
+    writeArray(fp, "float", "WEIGHTS3_FLOAT", &net.W3[0][0], NOUTPUTS, NHIDDEN, "NOUTPUTS", "NHIDDEN", "%.9g");
+    writeArray(fp, "float", "BIASES3_FLOAT", net.B3, NOUTPUTS, 0, "NOUTPUTS", NULL, "%.9g");
+    fprintf(fp, "#endif\n\n");
+
+    fprintf(fp, "    } // namespace mlp\n\n} // namespace hf\n");
+
+    fclose(fp);
+
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * filename = argc > 1 ? argv[1] : "../../src/pidcontrollers/mlp_weights.hpp";
+
+    unsigned nthreads = std::thread::hardware_concurrency();
+    hf::WorkStealingPool pool(nthreads ? nthreads : 1);
+
+    // Training flights, plus a tenth as many for testing
+    uint32_t ntest = NFLIGHTS / 10 ? NFLIGHTS / 10 : 1;
+    std::vector<std::vector<hf::mlp_sample_t>> flights(NFLIGHTS + ntest);
+
+    pool.run(flights.size(), [&](uint32_t job) {
+        hf::collectMlpSamples(job, FLIGHT_DURATION, flights[job]);
+    });
+
+    std::vector<hf::mlp_sample_t> training, testing;
+    for (uint32_t f=0; f<flights.size(); ++f) {
+        std::vector<hf::mlp_sample_t> & dest = f < NFLIGHTS ? training : testing;
+        dest.insert(dest.end(), flights[f].begin(), flights[f].end());
+    }
+
+    printf("Collected %lu training and %lu test samples\n",
+            (unsigned long)training.size(), (unsigned long)testing.size());
+
+    float xmean[NINPUTS] = {}, xstd[NINPUTS] = {}, ystd[NOUTPUTS] = {};
+
+    for (const hf::mlp_sample_t & sample : training) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            xmean[k] += sample.inputs[k] / training.size();
+        }
+    }
+
+    for (const hf::mlp_sample_t & sample : training) {
+        for (uint8_t k=0; k<NINPUTS; ++k) {
+            xstd[k] += (sample.inputs[k] - xmean[k]) * (sample.inputs[k] - xmean[k]) / training.size();
+        }
+        for (uint8_t k=0; k<NOUTPUTS; ++k) {
+            ystd[k] += sample.outputs[k] * sample.outputs[k] / training.size();
+        }
+    }
+
+    for (uint8_t k=0; k<NINPUTS; ++k) {
+        xstd[k] = sqrtf(xstd[k]) + 1e-6f;
+    }
+    for (uint8_t k=0; k<NOUTPUTS; ++k) {
+        ystd[k] = sqrtf(ystd[k]) + 1e-6f;
+    }
+
+    network_t net = train(training, xmean, xstd, ystd);
+
+    printf("Float RMS error: training %3.5f, test %3.5f\n", rmsError(net, training), rmsError(net, testing));
+
+    quantized_t q = quantize(net);
+
+    if (!writeHeader(filename, net, q)) {
+        fprintf(stderr, "Unable to write %s\n", filename);
+        return 1;
+    }
+
+    printf("Wrote %s\n", filename);
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+   Monte-Carlo flight campaign: flies many independent SITL vehicles in
+   parallel, each with its own randomized initial attitude, sensor noise,
+   motor lag, and Rate/Yaw/Level PID gains, through a roll step input,
+   and reports statistics of settling time, overshoot, and motor
+   saturation over the campaign
+
+   Flights are spread over the cores by a work-stealing thread pool, so a
+   few slow (e.g. unstable) flights don't leave the other cores idle.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "sitl.hpp"
+#include "workpool.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const double DT = 0.001;
+
+// Recover from the initial attitude, then hold a roll step
+static const double STEP_TIME = 20.0;
+static const double DURATION = 40.0;
+static const float STEP_ROLL = 0.5f;
+static const float THROTTLE = 0.14f;
+
+// Final value is the mean over this last part of the step
+static const double FINAL_WINDOW = 5.0;
+
+// Settled when within this fraction of the final value
+static const float SETTLING_BAND = 0.05f;
+
+// Spread of each randomized parameter
+static const float GAIN_SPREAD = 0.3f;      // +/- fraction of nominal
+static const float MAX_INITIAL_ANGLE = 0.3f; // radians
+static const float MAX_ANGLE_NOISE = 0.01f; // radians
+static const float MAX_GYRO_NOISE = 0.05f;  // radians/sec
+static const float MAX_MOTOR_TAU = 0.05f;   // seconds
+
+typedef struct {
+
+    float settlingTime;     // seconds after the step; DURATION-STEP_TIME if never
+    float overshoot;        // fraction of the final roll angle
+    float saturation;       // fraction of updates with a motor at 0 or 1
+
+} result_t;
+
+static result_t fly(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-1, +1);
+
+    auto spread = [&](float nominal) { return nominal * (1 + GAIN_SPREAD * uniform(rng)); };
+
+    hf::RatePid ratePid(spread(0.225f), spread(0.001875f), spread(0.375f));
+    hf::YawPid yawPid(spread(2), spread(0.1f));
+    hf::LevelPid levelPid(spread(0.20f));
+
+    hf::vehicle_params_t params;
+    params.motortau = MAX_MOTOR_TAU * (1 + uniform(rng)) / 2;
+
+    hf::Sitl sitl(DT, 1.0, params);
+
+    sitl.hackflight.addClosedLoopController(&levelPid);
+    sitl.hackflight.addClosedLoopController(&ratePid);
+    sitl.hackflight.addClosedLoopController(&yawPid);
+
+    sitl.sensors.setNoise(MAX_ANGLE_NOISE * (1 + uniform(rng)) / 2,
+                          MAX_GYRO_NOISE * (1 + uniform(rng)) / 2,
+                          rng());
+
+    sitl.begin();
+
+    sitl.dynamics.setAttitude(MAX_INITIAL_ANGLE * uniform(rng),
+                              MAX_INITIAL_ANGLE * uniform(rng),
+                              (float)M_PI * uniform(rng));
+    sitl.dynamics.setAirborne(100);
+
+    std::vector<float> phis;
+    uint32_t steps = 0;
+    uint32_t saturated = 0;
+
+    while (sitl.time() < DURATION) {
+
+        bool stepped = sitl.time() >= STEP_TIME;
+
+        sitl.receiver.setSticks(THROTTLE, stepped ? STEP_ROLL : 0, 0, 0, +1);
+
+        sitl.step();
+
+        const float * motors = sitl.motors.values();
+        for (uint8_t k=0; k<hf::Dynamics::NMOTORS; ++k) {
+            if (motors[k] <= 0 || motors[k] >= 1) {
+                saturated++;
+                break;
+            }
+        }
+        steps++;
+
+        if (stepped) {
+            phis.push_back(sitl.state()[hf::State::PHI]);
+        }
+    }
+
+    size_t nfinal = (size_t)(FINAL_WINDOW / DT);
+    nfinal = nfinal < phis.size() ? nfinal : phis.size();
+
+    float final = 0;
+    for (size_t k=phis.size()-nfinal; k<phis.size(); ++k) {
+        final += phis[k];
+    }
+    final /= nfinal;
+
+    float peak = 0;
+    size_t lastOutside = 0;
+    for (size_t k=0; k<phis.size(); ++k) {
+        peak = fmaxf(peak, phis[k] * (final < 0 ? -1 : +1));
+        if (fabsf(phis[k] - final) > SETTLING_BAND * fabsf(final)) {
+            lastOutside = k + 1;
+        }
+    }
+
+    result_t result = {};
+    result.settlingTime = lastOutside * DT;
+    result.overshoot = final != 0 ? fmaxf(0, peak / fabsf(final) - 1) : 0;
+    result.saturation = (float)saturated / steps;
+
+    return result;
+}
+
+static void report(const char * name, const char * units, float scale, std::vector<float> values)
+{
+    std::sort(values.begin(), values.end());
+
+    double sum = 0;
+    for (float value : values) {
+        sum += value;
+    }
+
+    auto percentile = [&](double p) { return scale * values[(size_t)(p * (values.size()-1))]; };
+
+    printf("%-20s %-5s %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, units,
+            scale * sum / values.size(), percentile(0.5), percentile(0.9), percentile(0.99), percentile(1));
+}
+
+int main(int argc, char ** argv)
+{
+    // Flights, threads (default all cores), seed
+    uint32_t nflights = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned nthreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    uint32_t seed = argc > 3 ? atoi(argv[3]) : 0;
+
+    nthreads = nthreads ? nthreads : 1;
+
+    if (!nflights) {
+        fprintf(stderr, "Usage: %s [FLIGHTS] [THREADS] [SEED]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<result_t> results(nflights);
+
+    auto start = std::chrono::steady_clock::now();
+
+    hf::WorkStealingPool pool(nthreads);
+
+    // Each flight's seed depends only on its index, so results don't depend on the thread count
+    pool.run(nflights, [&](uint32_t job) {
+        results[job] = fly(seed * 2654435761u + job);
+    });
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<float> settling, overshoot, saturation;
+
+    for (const result_t & result : results) {
+        settling.push_back(result.settlingTime);
+        overshoot.push_back(result.overshoot);
+        saturation.push_back(result.saturation);
+    }
+
+    printf("Flew %u flights of %3.1f sec on %u threads in %3.3f sec (%3.0fx realtime)\n\n",
+            nflights, DURATION, nthreads, wall, nflights * DURATION / wall);
+
+    printf("%-20s %-5s %10s %10s %10s %10s %10s\n", "Metric", "Units", "Mean", "P50", "P90", "P99", "Max");
+    report("Settling time", "sec", 1, settling);
+    report("Overshoot", "%", 100, overshoot);
+    report("Motor saturation", "%", 100, saturation);
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+   Checks the attitude that UsfsGyrometer and UsfsMaxGyrometer propagate
+   from the gyro between quaternions against the next quaternion.
+
+   A simulated IMU turns through a steady yaw with roll and pitch
+   oscillations: its quaternion is integrated exactly from its gyro rates,
+   which arrive at the sensor's gyro rate, with a quaternion every few
+   samples (834 Hz and every eighth for the USFSMAX, 330 Hz and every fifth
+   for the USFS).  Rates and quaternions go through the same UsfsMaxFrame or
+   UsfsFrame conversions as the sensors, into an AttitudePropagator.  Just
+   before each correction, the propagated roll, pitch, and heading are
+   compared with those of the arriving quaternion, with the propagator
+   correcting from Euler angles and from the quaternion.  For the USFSMAX,
+   the same is then done with the controller rates, whose yaw has the
+   opposite sign, to show what a wrong sign costs.
+
+   Exits with status 1 if the propagated attitude is off by more than the
+   tolerance: looser for Euler angles, whose kinematic coefficients are
+   held from one quaternion to the next.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "state.hpp"
+#include "sensors/propagator.hpp"
+#include "sensors/usfs_frame.hpp"
+#include "sensors/usfsmax_frame.hpp"
+
+static const float DURATION = 10;
+
+// Radians
+static const float QUATERNION_TOLERANCE = 0.001f;
+
+typedef void (*rates_t)(const float gyro[3], float rates[3]);
+
+typedef void (*quaternion_t)(const float q[4], float hfq[4]);
+
+typedef struct {
+
+    const char * name;
+    float gyroRate;
+    uint8_t gyrosPerQuaternion;
+    float psiMin;
+    quaternion_t quaternion;
+
+    // Radians; grows with the time between quaternions
+    float eulerTolerance;
+
+} imu_t;
+
+static const imu_t USFSMAX = {"USFSMAX", 834, 8, -(float)M_PI, hf::UsfsMaxFrame::quaternion, 0.01f};
+static const imu_t USFS = {"USFS", 330, 5, 0, hf::UsfsFrame::quaternion, 0.02f};
+
+// Sensor rates in degrees / sec: steady yaw, rolling and pitching back and forth
+static void gyroAt(float t, float gyro[3])
+{
+    gyro[0] = 40 * sinf(2 * (float)M_PI * 0.5f * t);
+    gyro[1] = 30 * cosf(2 * (float)M_PI * 0.3f * t);
+    gyro[2] = 120 + 30 * sinf(2 * (float)M_PI * 0.2f * t);
+}
+
+// q = q * exp((0, w) dt/2), w in radians / sec
+static void rotate(double q[4], const float gyro[3], double dt)
+{
+    double w[3] = {};
+    for (uint8_t k=0; k<3; ++k) {
+        w[k] = gyro[k] * M_PI / 180;
+    }
+
+    double rate = sqrt(w[0]*w[0] + w[1]*w[1] + w[2]*w[2]);
+
+    double c = cos(rate * dt / 2);
+    double s = rate > 0 ? sin(rate * dt / 2) / rate : 0;
+
+    double r[4] = {c, s * w[0], s * w[1], s * w[2]};
+
+    double p[4] = {
+        q[0]*r[0] - q[1]*r[1] - q[2]*r[2] - q[3]*r[3],
+        q[0]*r[1] + q[1]*r[0] + q[2]*r[3] - q[3]*r[2],
+        q[0]*r[2] - q[1]*r[3] + q[2]*r[0] + q[3]*r[1],
+        q[0]*r[3] + q[1]*r[2] - q[2]*r[1] + q[3]*r[0]
+    };
+
+    for (uint8_t k=0; k<4; ++k) {
+        q[k] = p[k];
+    }
+}
+
+static float angleDifference(float a, float b)
+{
+    float d = fmodf(a - b + 3 * (float)M_PI, 2 * (float)M_PI);
+
+    return fabsf(d - (float)M_PI);
+}
+
+// Largest error in roll, pitch, heading over the flight
+static void fly(const imu_t & imu, rates_t rates, bool quaternion, float error[3])
+{
+    hf::AttitudePropagator propagator(imu.psiMin);
+
+    hf::State state = {};
+
+    // Start rolled, pitched, and turned a little, in the sensor's frame
+    double q[4] = {1, 0, 0, 0};
+    float start[3] = {10, -15, 30};
+    rotate(q, start, 1);
+
+    for (uint8_t k=0; k<3; ++k) {
+        error[k] = 0;
+    }
+
+    uint32_t samples = (uint32_t)(DURATION * imu.gyroRate);
+
+    for (uint32_t n=0; n<=samples; ++n) {
+
+        float time = n / imu.gyroRate;
+
+        if (n > 0) {
+
+            // Constant over each sample period, as the sensors report it
+            float gyro[3] = {};
+            gyroAt(time, gyro);
+
+            rotate(q, gyro, 1 / imu.gyroRate);
+
+            float body[3] = {};
+            rates(gyro, body);
+
+            propagator.propagate(body[0], body[1], body[2], time, &state);
+        }
+
+        if (n % imu.gyrosPerQuaternion) {
+            continue;
+        }
+
+        float sensorq[4] = {(float)q[0], (float)q[1], (float)q[2], (float)q[3]};
+
+        float hfq[4] = {};
+        imu.quaternion(sensorq, hfq);
+
+        float truth[3] = {};
+        hf::EulerMath::fromQuaternion(hfq, truth[0], truth[1], truth[2]);
+
+        if (n > 0) {
+
+            state.updateEuler();
+
+            float propagated[3] = {state.x[hf::State::PHI], state.x[hf::State::THETA], state.x[hf::State::PSI]};
+
+            for (uint8_t k=0; k<3; ++k) {
+                error[k] = fmaxf(error[k], angleDifference(propagated[k], truth[k]));
+            }
+        }
+
+        // As the quaternion sensor does
+        state.setQuaternion(hfq, imu.psiMin);
+
+        if (quaternion) {
+            propagator.correct(hfq, time);
+        }
+        else {
+            state.updateEuler();
+            propagator.correct(state.x[hf::State::PHI], state.x[hf::State::THETA], state.x[hf::State::PSI], time);
+        }
+    }
+}
+
+static bool report(const imu_t & imu, const char * name, rates_t rates, bool check)
+{
+    bool ok = true;
+
+    for (uint8_t quaternion=0; quaternion<2; ++quaternion) {
+
+        float error[3] = {};
+
+        fly(imu, rates, quaternion, error);
+
+        printf("  %-8s %-16s %-10s: max error roll %.5f, pitch %.5f, heading %.5f rad\n",
+                imu.name, name, quaternion ? "quaternion" : "Euler", error[0], error[1], error[2]);
+
+        float tolerance = quaternion ? QUATERNION_TOLERANCE : imu.eulerTolerance;
+
+        for (uint8_t k=0; k<3; ++k) {
+            ok = ok && error[k] < tolerance;
+        }
+    }
+
+    return !check || ok;
+}
+
+int main(int, char **)
+{
+    printf("Propagated attitude against the next quaternion:\n");
+
+    bool ok = report(USFSMAX, "body rates", hf::UsfsMaxFrame::bodyRates, true);
+
+    report(USFSMAX, "controller rates", hf::UsfsMaxFrame::controllerRates, false);
+
+    ok = report(USFS, "body rates", hf::UsfsFrame::bodyRates, true) && ok;
+
+    printf("  %s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+   Checks QuaternionLevelPid's tilt error against the attitude it comes
+   from.
+
+   The vehicle is tilted from level to inverted, one degree at a time,
+   about the roll axis, the pitch axis, and the axis between them, at two
+   headings.  With the sticks centered, the size of the error must grow
+   at every step, up to 2 when inverted; within a few degrees of level it
+   must match LevelPid's angle error, sign included.  With the roll or
+   pitch stick held, the error must vanish at the demanded tilt.
+
+   Exits with status 1 if any check fails.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "pidcontrollers/quatlevel.hpp"
+
+// Relative, for matching LevelPid
+static const float LEVEL_TOLERANCE = 0.01f;
+
+static const float ZERO_TOLERANCE = 1e-4f;
+
+static const float DEMAND_TO_ANGLE = 2 * 45 * (float)M_PI / 180;
+
+static float deg2rad(float degrees)
+{
+    return degrees * (float)M_PI / 180;
+}
+
+// Heading psi, then a rotation by angle about the body axis (ax, ay, 0)
+static void attitude(float psi, float ax, float ay, float angle, float q[4])
+{
+    float cy = cosf(psi/2), sy = sinf(psi/2);
+    float ct = cosf(angle/2), st = sinf(angle/2);
+
+    q[0] = cy * ct;
+    q[1] = cy * st * ax - sy * st * ay;
+    q[2] = cy * st * ay + sy * st * ax;
+    q[3] = sy * ct;
+}
+
+// Tilting about (ax, ay) at heading psi, sticks centered
+static bool sweep(const char * name, float psi, float ax, float ay)
+{
+    uint32_t shrinking = 0;
+    float previous = 0;
+    float levelError = 0;
+    float inverted = 0;
+
+    for (uint16_t degrees=1; degrees<=180; ++degrees) {
+
+        float angle = deg2rad(degrees);
+
+        float q[4] = {};
+        attitude(psi, ax, ay, angle, q);
+
+        float roll = 0, pitch = 0;
+        hf::QuaternionLevelPid::tiltError(q, 0, 0, roll, pitch);
+
+        float size = sqrtf(roll*roll + pitch*pitch);
+
+        if (size <= previous) {
+            shrinking++;
+        }
+        previous = size;
+
+        // Near level, LevelPid's errors are -phi and -(-theta)
+        if (degrees <= 3) {
+
+            float phi = 0, theta = 0, heading = 0;
+            hf::EulerMath::fromQuaternion(q, phi, theta, heading);
+
+            float expected[2] = {-phi, theta};
+            float got[2] = {roll, pitch};
+
+            for (uint8_t k=0; k<2; ++k) {
+                levelError = fmaxf(levelError, fabsf(got[k] - expected[k]) / angle);
+            }
+        }
+
+        inverted = size;
+    }
+
+    bool ok = shrinking == 0 && levelError < LEVEL_TOLERANCE && fabsf(inverted - 2) < ZERO_TOLERANCE;
+
+    printf("  %-10s heading %3.0f deg: %3u steps not growing, %.5f off LevelPid near level, %.5f inverted: %s\n",
+            name, psi * 180 / M_PI, shrinking, levelError, inverted, ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+// Holding the stick at demand, at the tilt it asks for
+static bool demanded(const char * name, float rollDemand, float pitchDemand)
+{
+    // Tangent of the demanded tilt is the angle LevelPid would demand;
+    // roll right down, and pitch stick forward for nose down
+    float phi = atanf(rollDemand * DEMAND_TO_ANGLE);
+    float theta = -atanf(pitchDemand * DEMAND_TO_ANGLE);
+
+    float q[4] = {};
+
+    if (rollDemand != 0) {
+        attitude(0, 1, 0, phi, q);
+    }
+    else {
+        attitude(0, 0, 1, theta, q);
+    }
+
+    float roll = 0, pitch = 0;
+    hf::QuaternionLevelPid::tiltError(q, rollDemand, pitchDemand, roll, pitch);
+
+    bool ok = fabsf(roll) < ZERO_TOLERANCE && fabsf(pitch) < ZERO_TOLERANCE;
+
+    printf("  %-10s stick held: error %+.6f, %+.6f: %s\n", name, roll, pitch, ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+int main(int, char **)
+{
+    printf("QuaternionLevelPid tilt error, level to inverted:\n");
+
+    bool ok = true;
+
+    for (uint8_t k=0; k<2; ++k) {
+
+        float psi = k * deg2rad(60);
+
+        ok = sweep("roll", psi, 1, 0) && ok;
+        ok = sweep("pitch", psi, 0, 1) && ok;
+        ok = sweep("diagonal", psi, (float)M_SQRT1_2, (float)M_SQRT1_2) && ok;
+    }
+
+    ok = demanded("roll", 0.3f, 0) && ok;
+    ok = demanded("pitch", 0, 0.3f) && ok;
+
+    printf("  %s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/*
+   Checks RcSmoother against frame timings: a known stick motion is
+   sampled at each frame time, and the closed loop reads the demand at
+   300 Hz either as delivered (a staircase) or interpolated with several
+   leads.  Reports the measured frame period and jitter against the true
+   ones, and for each method the error from the true stick, the effective
+   latency, the loop-to-loop roughness of the setpoint, and the overshoot
+   when the stick snaps from center; then the feedforward's error from the
+   true stick rate.  Last, it stops the frames while the stick is moving
+   and checks that the feedforward drops to zero, exiting with status 1 if
+   it doesn't.
+
+   Frame times are read from a file, one per line in seconds, if given
+   (e.g. timestamps logged by a receiver's gotNewFrame()); otherwise the
+   built-in schedules model DSMX and SBUS timing with jitter and dropped
+   frames.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "rcsmoother.hpp"
+
+static const double LOOP_FREQ = 300;
+
+static const float LEADS[3] = {0, 0.5f, 1};
+
+// Stick snap for the overshoot test
+static const float STEP = 0.3f;
+static const double STEP_TIME = 2;
+
+// Latency is searched in steps of this many seconds
+static const double LAG_STEP = 0.0001;
+static const double MAX_LAG = 0.05;
+
+// Stick motion: demand in [-0.5,+0.5] and its rate
+static double stick(double t)
+{
+    return 0.3 * sin(2 * M_PI * 1.0 * t) + 0.15 * sin(2 * M_PI * 3.1 * t);
+}
+
+static double stickRate(double t)
+{
+    return 0.3 * 2 * M_PI * 1.0 * cos(2 * M_PI * 1.0 * t) + 0.15 * 2 * M_PI * 3.1 * cos(2 * M_PI * 3.1 * t);
+}
+
+static std::vector<double> schedule(double period, double jitter, double dropRate, double duration)
+{
+    std::mt19937 rng(0);
+    std::normal_distribution<double> noise(0, jitter);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    std::vector<double> times;
+    for (double t=0; t<duration; t+=period) {
+        if (uniform(rng) >= dropRate) {
+            times.push_back(t + noise(rng));
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+
+    return times;
+}
+
+typedef struct {
+
+    double rms;
+    double lag;
+    double roughness;
+
+} quality_t;
+
+// Output sampled at loop times t[k]; lag is the stick delay that fits it best
+static quality_t quality(const std::vector<double> & t, const std::vector<double> & y)
+{
+    quality_t q = {};
+
+    double best = 1e9;
+
+    for (double lag=0; lag<=MAX_LAG; lag+=LAG_STEP) {
+        double sum = 0;
+        for (size_t k=0; k<t.size(); ++k) {
+            double e = y[k] - stick(t[k] - lag);
+            sum += e * e;
+        }
+        if (sum < best) {
+            best = sum;
+            q.lag = lag;
+        }
+    }
+
+    double sum = 0, rough = 0;
+    for (size_t k=0; k<t.size(); ++k) {
+        double e = y[k] - stick(t[k]);
+        sum += e * e;
+        if (k > 0) {
+            double d = y[k] - y[k-1];
+            rough += d * d;
+        }
+    }
+
+    q.rms = sqrt(sum / t.size());
+    q.roughness = sqrt(rough / (t.size() - 1));
+
+    return q;
+}
+
+// Stick motion sampled at each frame, read back by the closed loop
+// Peak overshoot of a snap from centered stick to STEP, as a fraction of STEP
+static double overshoot(const std::vector<double> & frames, float lead, bool smoothing)
+{
+    hf::RcSmoother smoother(lead);
+
+    float held[4] = {};
+
+    double peak = 0;
+
+    size_t next = 0;
+
+    for (double t=frames[0]; t<frames[0]+STEP_TIME+1; t+=1/LOOP_FREQ) {
+
+        while (next < frames.size() && frames[next] <= t) {
+            held[1] = frames[next] >= frames[0] + STEP_TIME ? STEP : 0;
+            smoother.frame((float)frames[next], held);
+            ++next;
+        }
+
+        float smoothed[4] = {};
+        smoother.interpolate((float)t, smoothed);
+
+        peak = fmax(peak, smoothing ? smoothed[1] : held[1]);
+    }
+
+    return peak / STEP - 1;
+}
+
+static void report(const char * label, const std::vector<double> & frames, float lead, bool smoothing)
+{
+    hf::RcSmoother smoother(lead);
+
+    float held[4] = {};
+
+    std::vector<double> times, log;
+    double ffError = 0, ffScale = 0;
+
+    size_t next = 0;
+
+    for (double t=frames[0]; t<frames.back(); t+=1/LOOP_FREQ) {
+
+        // Deliver any frames that have arrived since the last loop
+        while (next < frames.size() && frames[next] <= t) {
+            held[1] = (float)stick(frames[next]);
+            smoother.frame((float)frames[next], held);
+            ++next;
+        }
+
+        float smoothed[4] = {};
+        smoother.interpolate((float)t, smoothed);
+
+        // Skip the first second, while the period is measured
+        if (t - frames[0] < 1) {
+            continue;
+        }
+
+        times.push_back(t);
+        log.push_back(smoothing ? smoothed[1] : held[1]);
+
+        float feedforward[4] = {};
+        smoother.getFeedforward((float)t, feedforward);
+        double e = feedforward[1] - stickRate(t);
+        ffError += e * e;
+        ffScale += stickRate(t) * stickRate(t);
+    }
+
+    quality_t q = quality(times, log);
+
+    printf("  %-12s  %8.2f  %6.2f  %9.4f  %7.1f  %9.4f  %8.0f%%",
+            label, 1000 * smoother.period(), 1000 * smoother.jitter(),
+            q.rms, 1000 * q.lag, q.roughness, 100 * overshoot(frames, lead, smoothing));
+
+    if (smoothing) {
+        printf("  %10.0f%%", 100 * sqrt(ffError / ffScale));
+    }
+
+    printf("\n");
+}
+
+static void run(const char * name, const std::vector<double> & frames)
+{
+    // True period and jitter, leaving out intervals that span dropped frames
+    std::vector<double> intervals;
+    for (size_t k=1; k<frames.size(); ++k) {
+        intervals.push_back(frames[k] - frames[k-1]);
+    }
+    std::vector<double> sorted = intervals;
+    std::sort(sorted.begin(), sorted.end());
+    double median = sorted[sorted.size()/2];
+
+    double period = 0, jitter = 0;
+    uint32_t count = 0;
+    for (double interval : intervals) {
+        if (interval < 1.5 * median) {
+            period += interval;
+            ++count;
+        }
+    }
+    period /= count;
+    for (double interval : intervals) {
+        if (interval < 1.5 * median) {
+            jitter += fabs(interval - period);
+        }
+    }
+    jitter /= count;
+
+    printf("%s: %zu frames\n", name, frames.size());
+    printf("  period %5.2f msec, jitter %4.2f msec; measured period, jitter, latency in msec\n\n",
+            1000 * period, 1000 * jitter);
+    printf("  %-12s  %8s  %6s  %9s  %7s  %9s  %9s  %11s\n",
+            "", "period", "jitter", "rms error", "latency", "roughness", "overshoot", "feedforward");
+
+    report("staircase", frames, 0, false);
+
+    for (float lead : LEADS) {
+        char label[20] = {};
+        snprintf(label, sizeof(label), "lead %3.1f", lead);
+        report(label, frames, lead, true);
+    }
+
+    printf("\n");
+}
+
+// Frames stop while the stick is moving
+static bool stopped(void)
+{
+    static const double PERIOD = 0.011;
+    static const double STOP = 1;
+    static const double AFTER = 0.5;
+
+    hf::RcSmoother smoother;
+
+    float demands[4] = {};
+
+    double last = 0;
+
+    for (double t=0; t<STOP; t+=PERIOD) {
+        demands[1] = (float)stick(t);
+        smoother.frame((float)t, demands);
+        last = t;
+    }
+
+    float feedforward[4] = {};
+    smoother.getFeedforward((float)(last + PERIOD / 2), feedforward);
+    float before = feedforward[1];
+
+    // Time after the last frame until the feedforward is zero for good
+    double zeroAfter = 0;
+
+    for (double t=last; t<last+AFTER; t+=1/LOOP_FREQ) {
+        smoother.getFeedforward((float)t, feedforward);
+        if (feedforward[1] != 0) {
+            zeroAfter = t - last + 1/LOOP_FREQ;
+        }
+    }
+
+    // Zero within two periods of the last frame
+    bool ok = before != 0 && zeroAfter <= 2 * PERIOD;
+
+    printf("Frames stopped with the stick moving, %2.0f msec period:\n", 1000 * PERIOD);
+    printf("  feedforward %+.3f/sec half a period after the last frame, zero %4.1f msec after it: %s\n",
+            before, 1000 * zeroAfter, ok ? "OK" : "FAILED");
+
+    return ok;
+}
+
+static std::vector<double> load(const char * filename)
+{
+    std::vector<double> times;
+
+    FILE * fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", filename);
+        exit(1);
+    }
+
+    double t = 0;
+    while (fscanf(fp, "%lf", &t) == 1) {
+        times.push_back(t);
+    }
+
+    fclose(fp);
+
+    if (times.size() < 3) {
+        fprintf(stderr, "%s has too few frame times\n", filename);
+        exit(1);
+    }
+
+    return times;
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc > 1) {
+        for (int k=1; k<argc; ++k) {
+            run(argv[k], load(argv[k]));
+        }
+    }
+
+    else {
+        run("DSMX 22 msec, 0.3 msec jitter", schedule(0.022, 0.0003, 0, 20));
+        run("DSMX 11 msec, 0.3 msec jitter", schedule(0.011, 0.0003, 0, 20));
+        run("SBUS 9 msec, 1 msec jitter, 2% dropped", schedule(0.009, 0.001, 0.02, 20));
+    }
+
+    return stopped() ? 0 : 1;
+}
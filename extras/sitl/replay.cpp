@@ -0,0 +1,198 @@
+/*
+   Replays a blackbox log through the real Hackflight controller chain:
+   the logged state and receiver channels are fed back in through a replay
+   sensor and receiver on a virtual clock, and the recomputed receiver
+   demands, controller outputs, and motor values are compared with the
+   logged ones.  Exits with status 1 if any differ by more than the
+   tolerance, so a changed controller or mixer can be qualified against
+   a library of recorded flights.
+
+   The controllers and mixer below must match the ones that flew the log
+   (here, those in sitl.cpp, added in the same order so that their
+   blackbox slots line up).
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "hackflight.hpp"
+#include "actuators/mixers/quadxmw.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+#include "sim_board.hpp"
+#include "sim_motors.hpp"
+#include "replay.hpp"
+#include "blackbox_file.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+// Times are logged in microseconds from a float clock
+static const double TIME_TOLERANCE = 1e-5;
+
+static hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+static hf::YawPid yawPid = hf::YawPid(2, 0.1);
+static hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+static float maxDiff(const float * a, const float * b, uint8_t n)
+{
+    float diff = 0;
+
+    for (uint8_t k=0; k<n; ++k) {
+        diff = fmax(diff, fabs(a[k] - b[k]));
+    }
+
+    return diff;
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s LOGFILE [TOLERANCE] [OUTFILE]\n", argv[0]);
+        return 1;
+    }
+
+    float tolerance = argc > 2 ? atof(argv[2]) : 0;
+    const char * outname = argc > 3 ? argv[3] : NULL;
+
+    std::vector<uint8_t> data;
+
+    if (!hf::loadBlackboxFile(argv[1], data)) {
+        fprintf(stderr, "Unable to open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<hf::BlackboxReader::record_t> logged;
+
+    hf::BlackboxReader reader(data.data(), data.size());
+    hf::BlackboxReader::record_t record = {};
+    while (reader.next(record)) {
+        logged.push_back(record);
+    }
+
+    if (logged.empty()) {
+        fprintf(stderr, "No records in %s\n", argv[1]);
+        return 1;
+    }
+
+    static hf::SimBoard board;
+    static hf::ReplayReceiver receiver;
+    static hf::SimMotors motors(logged[0].nmotors);
+    static hf::MixerQuadXMW mixer(&motors);
+    static hf::ReplaySensor sensor;
+    static hf::Hackflight hackflight(&board, &receiver, &mixer);
+
+    hackflight.addSensor(&sensor);
+
+    hackflight.addClosedLoopController(&levelPid);
+    hackflight.addClosedLoopController(&ratePid);
+    hackflight.addClosedLoopController(&yawPid);
+
+    hackflight.begin(true);
+
+    static hf::BlackboxMemorySink replayed;
+    hackflight.startBlackbox(&replayed);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The sensors run after the controllers, so each pass loads the state
+    // the controllers will see on the next one; this first pass, before
+    // the closed-loop period has elapsed, loads the state for the first record
+    sensor.set(logged[0].x);
+    receiver.set(logged[0].channels);
+    hackflight.update();
+
+    for (size_t i=0; i<logged.size(); ++i) {
+
+        board.step(logged[i].time - board.time());
+
+        receiver.set(logged[i].channels);
+
+        if (i+1 < logged.size()) {
+            sensor.set(logged[i+1].x);
+        }
+
+        hackflight.update();
+
+        while (hf::_blackbox.pending()) {
+            hf::_blackbox.flush();
+        }
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (outname) {
+        FILE * fp = fopen(outname, "wb");
+        if (!fp) {
+            fprintf(stderr, "Unable to open %s\n", outname);
+            return 1;
+        }
+        fwrite(replayed.data.data(), 1, replayed.data.size(), fp);
+        fclose(fp);
+    }
+
+    // Compare the recomputed outputs with the logged ones
+    hf::BlackboxReader rereader(replayed.data.data(), replayed.data.size());
+
+    size_t count = 0;
+    size_t mismatches = 0;
+    double firstMismatch = -1;
+    float demandsDiff = 0;
+    float controllersDiff = 0;
+    float motorsDiff = 0;
+
+    while (count < logged.size() && rereader.next(record)) {
+
+        const hf::BlackboxReader::record_t & original = logged[count++];
+
+        float d = maxDiff(record.demands, original.demands, 4);
+
+        float c = 0;
+        for (uint8_t j=0; j<original.ncontrollers && j<record.ncontrollers; ++j) {
+            c = fmax(c, maxDiff(record.controllers[j], original.controllers[j], 4));
+        }
+
+        float m = maxDiff(record.motors, original.motors, original.nmotors);
+
+        demandsDiff = fmax(demandsDiff, d);
+        controllersDiff = fmax(controllersDiff, c);
+        motorsDiff = fmax(motorsDiff, m);
+
+        if (d > tolerance || c > tolerance || m > tolerance ||
+                record.ncontrollers != original.ncontrollers || fabs(record.time - original.time) > TIME_TOLERANCE) {
+            if (firstMismatch < 0) {
+                firstMismatch = original.time;
+            }
+            mismatches++;
+        }
+    }
+
+    mismatches += logged.size() - count;
+
+    printf("%s: replayed %lu of %lu records in %3.3f sec (%3.0fx realtime)\n",
+            argv[1], (unsigned long)count, (unsigned long)logged.size(), wall,
+            (logged.back().time - logged[0].time) / wall);
+    printf("Max difference: demands %g, controllers %g, motors %g\n",
+            demandsDiff, controllersDiff, motorsDiff);
+
+    if (mismatches) {
+        printf("%lu records differ by more than %g; first at %3.6f sec\n",
+                (unsigned long)mismatches, tolerance, firstMismatch);
+        return 1;
+    }
+
+    printf("All records match\n");
+
+    return 0;
+}
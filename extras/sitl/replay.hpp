@@ -0,0 +1,109 @@
+/*
+   Replay support: a sensor and a receiver that serve the state and
+   receiver channels from a blackbox log, so that a recorded flight can be
+   re-run through the real Hackflight controller chain
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_sensor.hpp>
+
+#include "receiver.hpp"
+#include "state.hpp"
+
+namespace hf {
+
+    class ReplaySensor : public rft::Sensor {
+
+        private:
+
+            float _x[State::SIZE] = {};
+
+            bool _fresh = false;
+
+        protected:
+
+            virtual bool ready(float time) override
+            {
+                (void)time;
+                return _fresh;
+            }
+
+            virtual void modifyState(rft::State * state, float time) override
+            {
+                (void)time;
+
+                State * hfstate = (State *)state;
+
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    hfstate->x[k] = _x[k];
+                }
+
+                _fresh = false;
+            }
+
+        public:
+
+            // State to be written on the next pass through the sensors
+            void set(const float * x)
+            {
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    _x[k] = x[k];
+                }
+
+                _fresh = true;
+            }
+
+    }; // class ReplaySensor
+
+    // Logged channels are already mapped, so this receiver uses the identity map
+    static const uint8_t REPLAY_CHANNEL_MAP[6] = {0, 1, 2, 3, 4, 5};
+
+    class ReplayReceiver : public Receiver {
+
+        private:
+
+            float _channels[6] = {};
+
+            bool _fresh = false;
+
+        protected:
+
+            virtual bool gotNewFrame(void) override
+            {
+                bool fresh = _fresh;
+                _fresh = false;
+                return fresh;
+            }
+
+            virtual void readRawvals(void) override
+            {
+                for (uint8_t k=0; k<6; ++k) {
+                    rawvals[k] = _channels[k];
+                }
+            }
+
+        public:
+
+            ReplayReceiver(float demandScale=1.0)
+                : Receiver(REPLAY_CHANNEL_MAP, demandScale)
+            {
+            }
+
+            // Frame to be served on the next pass through the receiver
+            void set(const float * channels)
+            {
+                for (uint8_t k=0; k<6; ++k) {
+                    _channels[k] = channels[k];
+                }
+
+                _fresh = true;
+            }
+
+    }; // class ReplayReceiver
+
+} // namespace hf
@@ -0,0 +1,297 @@
+/*
+   Runs ScheduledHackflight under SITL on the virtual clock, against
+   StaticHackflight, which asks every sensor whether it's ready on every
+   pass.  Reports how often the sensor is polled, how closely the two
+   flights agree, and host time per pass;
+   then the scheduler's per-task statistics, including on a virtual clock
+   too coarse for the gyro rate, where its task overruns.
+
+   Last, the sensor's samples come on a clock of its own, running 2% slow
+   and 2% fast against the rate the task was added at.  The task should
+   follow it: no sample skipped, and each read within a couple of ticks of
+   when the sample came.  Exits with status 1 if not.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sitl.hpp"
+#include "static_hackflight.hpp"
+#include "scheduled_hackflight.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const double STEP_TIME = 5;
+static const double DURATION = 10;
+static const float ROLL_STEP = 0.25f;
+
+// SimSensors that count calls to ready(), and can take their samples on
+// a clock of their own
+class CountingSimSensors : public hf::SimSensors {
+
+    template <typename...> friend class hf::SensorList;
+
+    private:
+
+        float _samplePeriod = 0; // zero for SimSensors' own timing
+
+        uint32_t _sample = 0xFFFFFFFF;
+
+    protected:
+
+        virtual bool ready(float time) override
+        {
+            ++polls;
+
+            if (_samplePeriod == 0) {
+                return SimSensors::ready(time);
+            }
+
+            uint32_t sample = (uint32_t)(time / _samplePeriod);
+
+            if (sample == _sample) {
+                return false;
+            }
+
+            skipped += sample - _sample - 1;
+
+            float latency = time - sample * _samplePeriod;
+            maxLatency = latency > maxLatency ? latency : maxLatency;
+
+            _sample = sample;
+            ++reads;
+
+            return true;
+        }
+
+    public:
+
+        uint32_t polls = 0;
+
+        // With a clock of their own
+        uint32_t reads = 0;
+        uint32_t skipped = 0;
+        float maxLatency = 0;
+
+        void setClock(float rate)
+        {
+            _samplePeriod = 1 / rate;
+        }
+
+        CountingSimSensors(hf::Dynamics * dynamics)
+            : SimSensors(dynamics)
+        {
+        }
+
+}; // class CountingSimSensors
+
+// The parts both vehicles share
+class Vehicle {
+
+    public:
+
+        hf::SimBoard board;
+
+        hf::SimReceiver receiver;
+
+        hf::SimMotors motors;
+
+        hf::StaticMixerQuadXMW mixer;
+
+        hf::Dynamics dynamics;
+
+        CountingSimSensors sensors;
+
+        hf::LevelPid levelPid = hf::LevelPid(0.20f);
+        hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+        hf::YawPid yawPid = hf::YawPid(2, 0.1);
+
+        hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllerList;
+
+        Vehicle(void)
+            : receiver(&board),
+              motors(hf::Dynamics::NMOTORS),
+              mixer(&motors),
+              sensors(&dynamics),
+              controllerList(levelPid, ratePid, yawPid)
+        {
+        }
+
+}; // class Vehicle
+
+class StaticVehicle : public Vehicle {
+
+    public:
+
+        hf::SensorList<CountingSimSensors> sensorList;
+
+        hf::StaticHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW,
+            decltype(sensorList), decltype(controllerList)> hackflight;
+
+        StaticVehicle(void)
+            : sensorList(sensors),
+              hackflight(&board, receiver, mixer, sensorList, controllerList)
+        {
+        }
+
+}; // class StaticVehicle
+
+class ScheduledVehicle : public Vehicle {
+
+    public:
+
+        hf::SensorTask<CountingSimSensors> sensorTask;
+
+        hf::ScheduledHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW, decltype(controllerList)> hackflight;
+
+        // SimSensors default to the USFSMAX gyro rate
+        ScheduledVehicle(void)
+            : sensorTask(sensors),
+              hackflight(&board, receiver, mixer, controllerList)
+        {
+            hackflight.addSensorTask(sensorTask, "SimSensors", 834, 0);
+        }
+
+}; // class ScheduledVehicle
+
+typedef struct {
+
+    double pollsPerSecond;
+    double nsecPerPass;
+    std::vector<float> roll;
+
+} flight_t;
+
+template <typename V>
+static flight_t fly(V & vehicle, double dt)
+{
+    vehicle.dynamics.reset();
+    vehicle.hackflight.begin(true);
+    vehicle.dynamics.setAirborne(100);
+
+    flight_t flight = {};
+
+    uint32_t passes = 0;
+    double hostTime = 0;
+
+    while (vehicle.board.time() < DURATION) {
+
+        vehicle.receiver.setSticks(0.14f, vehicle.board.time() >= STEP_TIME ? ROLL_STEP : 0, 0, 0, +1);
+
+        auto start = std::chrono::steady_clock::now();
+        vehicle.hackflight.update();
+        hostTime += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ++passes;
+
+        vehicle.dynamics.update(vehicle.motors.values(), dt);
+        vehicle.board.step(dt);
+
+        flight.roll.push_back(vehicle.dynamics.x[hf::State::PHI]);
+    }
+
+    flight.pollsPerSecond = vehicle.sensors.polls / DURATION;
+    flight.nsecPerPass = hostTime / passes;
+
+    return flight;
+}
+
+static void printTasks(hf::Scheduler & scheduler)
+{
+    printf("    %-12s %8s %9s %17s\n", "task", "runs", "overruns", "max late (msec)");
+
+    for (uint8_t k=0; k<scheduler.taskCount(); ++k) {
+        const char * name = NULL;
+        uint32_t runs = 0, overruns = 0;
+        float maxLateness = 0;
+        scheduler.getStats(k, name, runs, overruns, maxLateness);
+        printf("    %-12s %8u %9u %17.2f\n", name, runs, overruns, 1000 * maxLateness);
+    }
+}
+
+static void compare(double dt)
+{
+    flight_t polled = {}, scheduled = {};
+
+    // Each on its own thread, so each gets its own profiler table
+    std::thread([&]() {
+        StaticVehicle vehicle;
+        polled = fly(vehicle, dt);
+    }).join();
+
+    std::thread([&]() {
+        ScheduledVehicle vehicle;
+        scheduled = fly(vehicle, dt);
+
+        printf("%4.0f usec virtual steps (%.0f passes/sec)\n", 1e6 * dt, 1 / dt);
+        printf("                      sensor polls/sec  host nsec/pass\n");
+        printf("  StaticHackflight    %16.0f  %14.1f\n", polled.pollsPerSecond, polled.nsecPerPass);
+        printf("  ScheduledHackflight %16.0f  %14.1f\n", scheduled.pollsPerSecond, scheduled.nsecPerPass);
+
+        float maxDiff = 0;
+        for (size_t k=0; k<polled.roll.size() && k<scheduled.roll.size(); ++k) {
+            maxDiff = fmaxf(maxDiff, fabsf(polled.roll[k] - scheduled.roll[k]));
+        }
+        printf("  roll after step %5.3f and %5.3f rad; max difference %6.4f rad\n",
+                polled.roll.back(), scheduled.roll.back(), maxDiff);
+
+        printTasks(vehicle.hackflight.scheduler());
+        printf("\n");
+    }).join();
+}
+
+static bool drift(float error)
+{
+    static const double DT = 0.0001;
+
+    bool ok = false;
+
+    std::thread([&]() {
+
+        ScheduledVehicle vehicle;
+
+        vehicle.sensors.setClock(834 * (1 + error));
+
+        fly(vehicle, DT);
+
+        CountingSimSensors & sensors = vehicle.sensors;
+
+        ok = sensors.skipped == 0 && sensors.maxLatency <= 2 * DT;
+
+        printf("  %+3.0f%%: %6u reads, %5.2f polls per read, %u skipped, max latency %5.3f msec  %s\n",
+                100 * error, sensors.reads, sensors.polls / (double)sensors.reads,
+                sensors.skipped, 1000 * sensors.maxLatency, ok ? "OK" : "FAILED");
+    }).join();
+
+    return ok;
+}
+
+int main(int, char **)
+{
+    compare(0.0001);
+
+    // Too coarse for the 834 Hz gyro: the sensor task overruns
+    compare(0.002);
+
+    printf("Sensor clock drifting from 834 Hz, %4.0f usec virtual steps:\n", 1e6 * 0.0001);
+
+    bool ok = drift(-0.02f);
+    ok = drift(0) && ok;
+    ok = drift(+0.02f) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+/*
+   Board class for software-in-the-loop (SITL) testing: time is
+   virtual, advanced in fixed steps by the caller
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <RFT_board.hpp>
+
+namespace hf {
+
+    class SimBoard : public rft::Board {
+
+        private:
+
+            double _time = 0;
+
+        protected:
+
+            virtual float getTime(void) override
+            {
+                return (float)_time;
+            }
+
+        public:
+
+            void step(double dt)
+            {
+                _time += dt;
+            }
+
+            double time(void)
+            {
+                return _time;
+            }
+
+    }; // class SimBoard
+
+} // namespace hf
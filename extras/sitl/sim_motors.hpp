@@ -0,0 +1,45 @@
+/*
+   Motor class for software-in-the-loop (SITL) testing: just stores the
+   values it is sent
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_motor.hpp>
+
+namespace hf {
+
+    class SimMotors : public rft::Motor {
+
+        private:
+
+            static const uint8_t MAXMOTORS = 20; // arbitrary
+
+            float _values[MAXMOTORS] = {};
+
+        protected:
+
+            virtual void write(uint8_t index, float value) override
+            {
+                _values[index] = value;
+            }
+
+        public:
+
+            SimMotors(uint8_t count)
+                : rft::Motor(count)
+            {
+            }
+
+            const float * values(void)
+            {
+                return _values;
+            }
+
+    }; // class SimMotors
+
+} // namespace hf
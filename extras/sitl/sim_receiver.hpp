@@ -0,0 +1,81 @@
+/*
+   Receiver class for software-in-the-loop (SITL) testing: stick values
+   are set by the caller, and frames arrive at a fixed rate in virtual time
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include "receiver.hpp"
+
+#include "sim_board.hpp"
+
+namespace hf {
+
+    static constexpr uint8_t SIM_CHANNEL_MAP[6] = {0, 1, 2, 3, 4, 5};
+
+    class SimReceiver : public Receiver {
+
+        private:
+
+            SimBoard * _board = NULL;
+
+            double _period = 0;
+            double _frameTime = 0;
+
+            float _sticks[MAXCHAN] = {};
+
+        protected:
+
+            virtual bool gotNewFrame(void) override
+            {
+                if (_board->time() - _frameTime < _period) {
+                    return false;
+                }
+
+                _frameTime = _board->time();
+
+                return true;
+            }
+
+            virtual void readRawvals(void) override
+            {
+                for (uint8_t k=0; k<MAXCHAN; ++k) {
+                    rawvals[k] = _sticks[k];
+                }
+            }
+
+        public:
+
+            // DSMX delivers a frame every 11 or 22 msec
+            SimReceiver(SimBoard * board, float demandScale=1.0, float frameRate=45)
+                : Receiver(SIM_CHANNEL_MAP, demandScale)
+            {
+                _board = board;
+                _period = 1. / frameRate;
+                _frameTime = -_period;
+            }
+
+            // Stick values in [-1,+1]
+            void setSticks(float throttle, float roll, float pitch, float yaw, float aux1=-1, float aux2=-1)
+            {
+                _sticks[CHANNEL_THROTTLE] = throttle;
+                _sticks[CHANNEL_ROLL] = roll;
+                _sticks[CHANNEL_PITCH] = pitch;
+                _sticks[CHANNEL_YAW] = yaw;
+                _sticks[CHANNEL_AUX1] = aux1;
+                _sticks[CHANNEL_AUX2] = aux2;
+            }
+
+            // Throttle, roll, pitch, yaw demands as the controllers get them
+            void readDemands(float * demands)
+            {
+                getDemands(demands);
+            }
+
+    }; // class SimReceiver
+
+} // namespace hf
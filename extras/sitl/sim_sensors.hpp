@@ -0,0 +1,130 @@
+/*
+   Sensor class for software-in-the-loop (SITL) testing: copies the
+   simulated vehicle state into the Hackflight state at a fixed rate,
+   optionally adding Gaussian noise to the attitude and gyro readings
+
+   The attitude quaternion is filled in too.  With eulerAngles false, as
+   for the hardware quaternion sensors, the Euler angles are left to
+   State::updateEuler().
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+#include <random>
+
+#include <RFT_sensor.hpp>
+
+#include "state.hpp"
+#include "profiler.hpp"
+
+#include "dynamics.hpp"
+
+namespace hf {
+
+    class SimSensors : public rft::Sensor {
+
+        template <typename...> friend class SensorList;
+
+        private:
+
+            Dynamics * _dynamics = NULL;
+
+            float _period = 0;
+            float _readTime = 0;
+
+            bool _eulerAngles = true;
+
+            float _angleNoise = 0;
+            float _gyroNoise = 0;
+
+            std::mt19937 _rng;
+            std::normal_distribution<float> _normal;
+
+            uint8_t _profileStage = _profiler.addStage("SimSensors.modifyState");
+
+        protected:
+
+            virtual bool ready(float time) override
+            {
+                if (time - _readTime < _period) {
+                    return false;
+                }
+
+                _readTime = time;
+
+                return true;
+            }
+
+            virtual void modifyState(rft::State * state, float time) override
+            {
+                (void)time;
+
+                ProfileTimer timer(_profileStage);
+
+                State * hfstate = (State *)state;
+
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    hfstate->x[k] = _dynamics->x[k];
+                }
+
+                if (_angleNoise > 0 || _gyroNoise > 0) {
+                    for (uint8_t k=State::PHI; k<State::SIZE; k+=2) {
+                        hfstate->x[k] += _angleNoise * _normal(_rng);
+                        hfstate->x[k+1] += _gyroNoise * _normal(_rng);
+                    }
+                }
+
+                // Z-Y-X Euler angles to quaternion
+                float cph = cosf(hfstate->x[State::PHI]/2), sph = sinf(hfstate->x[State::PHI]/2);
+                float cth = cosf(hfstate->x[State::THETA]/2), sth = sinf(hfstate->x[State::THETA]/2);
+                float cps = cosf(hfstate->x[State::PSI]/2), sps = sinf(hfstate->x[State::PSI]/2);
+
+                float q[4] = {
+                    cph*cth*cps + sph*sth*sps,
+                    sph*cth*cps - cph*sth*sps,
+                    cph*sth*cps + sph*cth*sps,
+                    cph*cth*sps - sph*sth*cps
+                };
+
+                if (_eulerAngles) {
+                    for (uint8_t k=0; k<4; ++k) {
+                        hfstate->q[k] = q[k];
+                    }
+                }
+                else {
+                    hfstate->setQuaternion(q, -(float)M_PI);
+                }
+            }
+
+        public:
+
+            // Default to the USFSMAX gyro rate
+            SimSensors(Dynamics * dynamics, float rate=834)
+            {
+                _dynamics = dynamics;
+                _period = 1 / rate;
+                _readTime = -_period;
+            }
+
+            // Standard deviations in radians and radians/sec; zero for none
+            void setNoise(float angleNoise, float gyroNoise, uint32_t seed=0)
+            {
+                _angleNoise = angleNoise;
+                _gyroNoise = gyroNoise;
+                _rng.seed(seed);
+            }
+
+            // False to provide only the quaternion, as for QuaternionLevelPid
+            void setEulerAngles(bool eulerAngles)
+            {
+                _eulerAngles = eulerAngles;
+            }
+
+    }; // class SimSensors
+
+} // namespace hf
@@ -0,0 +1,124 @@
+/*
+   Headless SITL flight: arms, climbs, then runs roll and pitch step
+   inputs through the Level/Rate/Yaw PID chain, reporting the attitude
+   response, how much faster than realtime the flight ran, and the time
+   spent in each stage of the loop; optionally writes a blackbox log
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "sitl.hpp"
+#include "blackbox_file.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static void reportProfile(void)
+{
+    printf("\n%-28s %10s %10s %10s %10s\n", "Stage", "Count", "Min usec", "Mean usec", "Max usec");
+
+    for (uint8_t k=0; k<hf::_profiler.stageCount(); ++k) {
+
+        uint32_t count = 0;
+        float minUsec = 0, meanUsec = 0, maxUsec = 0;
+        hf::_profiler.getStats(k, count, minUsec, meanUsec, maxUsec);
+
+        printf("%-28s %10u %10.3f %10.3f %10.3f\n",
+                hf::_profiler.getStage(k)->name, count, minUsec, meanUsec, maxUsec);
+    }
+}
+
+static hf::RatePid ratePid = hf::RatePid(0.225, 0.001875, 0.375);
+static hf::YawPid yawPid = hf::YawPid(2, 0.1);
+static hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+int main(int argc, char ** argv)
+{
+    // Simulated seconds, step size, blackbox log file
+    double duration = argc > 1 ? atof(argv[1]) : 30;
+    double dt = argc > 2 ? atof(argv[2]) : 0.001;
+    const char * logname = argc > 3 ? argv[3] : NULL;
+
+    static hf::Sitl sitl(dt);
+
+    sitl.hackflight.addClosedLoopController(&levelPid);
+    sitl.hackflight.addClosedLoopController(&ratePid);
+    sitl.hackflight.addClosedLoopController(&yawPid);
+
+    sitl.begin();
+
+    sitl.hackflight.enableProfiling();
+
+    static hf::BlackboxFileSink logfile(logname ? logname : "/dev/null");
+
+    if (logname) {
+        if (!logfile.ok()) {
+            fprintf(stderr, "Unable to open %s\n", logname);
+            return 1;
+        }
+        sitl.hackflight.startBlackbox(&logfile);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    float maxPhi = 0, maxTheta = 0;
+    uint64_t steps = 0;
+
+    while (sitl.time() < duration) {
+
+        double t = sitl.time();
+
+        // Climb for two seconds, then alternate roll and pitch steps
+        float throttle = t < 2 ? 0.3f : 0.14f;
+        float roll = fmod(t, 4) > 2 && fmod(t, 8) < 4 ? 0.5f : 0;
+        float pitch = fmod(t, 4) > 2 && fmod(t, 8) > 4 ? 0.5f : 0;
+
+        sitl.receiver.setSticks(throttle, roll, pitch, 0, +1);
+
+        sitl.step();
+
+        const float * x = sitl.state();
+        maxPhi = fmax(maxPhi, fabs(x[hf::State::PHI]));
+        maxTheta = fmax(maxTheta, fabs(x[hf::State::THETA]));
+
+        steps++;
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const float * x = sitl.state();
+
+    printf("Simulated %3.1f sec in %lu steps of %3.3f msec\n", sitl.time(), (unsigned long)steps, 1000*dt);
+    printf("Final altitude %+3.2f m, attitude %+3.3f %+3.3f %+3.3f rad\n",
+            x[hf::State::Z], x[hf::State::PHI], x[hf::State::THETA], x[hf::State::PSI]);
+    printf("Max |roll| %3.3f rad, max |pitch| %3.3f rad\n", maxPhi, maxTheta);
+    printf("Wall time %3.3f sec (%3.0fx realtime)\n", wall, sitl.time() / wall);
+
+    if (logname) {
+
+        // Hand the sink whatever is still in the ring
+        while (hf::_blackbox.pending()) {
+            hf::_blackbox.flush();
+        }
+
+        printf("Logged %u blackbox records to %s (%u dropped)\n",
+                hf::_blackbox.recordCount(), logname, hf::_blackbox.droppedCount());
+    }
+
+    reportProfile();
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+   Software-in-the-loop (SITL) harness: runs the real Hackflight core
+   against simulated dynamics with a fixed-step virtual clock, so a flight
+   runs as fast as the host can compute it
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include "hackflight.hpp"
+#include "actuators/mixers/quadxmw.hpp"
+
+#include "sim_board.hpp"
+#include "sim_motors.hpp"
+#include "sim_receiver.hpp"
+#include "sim_sensors.hpp"
+#include "dynamics.hpp"
+
+namespace hf {
+
+    class Sitl {
+
+        private:
+
+            double _dt = 0;
+
+        public:
+
+            SimBoard board;
+
+            SimReceiver receiver;
+
+            SimMotors motors;
+
+            MixerQuadXMW mixer;
+
+            Dynamics dynamics;
+
+            SimSensors sensors;
+
+            Hackflight hackflight;
+
+            Sitl(double dt=0.001,
+                 float demandScale=1.0,
+                 const vehicle_params_t & params=vehicle_params_t())
+                : receiver(&board, demandScale),
+                  motors(Dynamics::NMOTORS),
+                  mixer(&motors),
+                  dynamics(params),
+                  sensors(&dynamics),
+                  hackflight(&board, &receiver, &mixer)
+            {
+                _dt = dt;
+
+                hackflight.addSensor(&sensors);
+            }
+
+            // Starts armed, as with MulticopterSim
+            void begin(bool armed=true)
+            {
+                dynamics.reset();
+
+                hackflight.begin(armed);
+            }
+
+            // Runs one firmware update, then advances physics and clock by dt
+            void step(void)
+            {
+                hackflight.update();
+
+                dynamics.update(motors.values(), _dt);
+
+                board.step(_dt);
+            }
+
+            double time(void)
+            {
+                return board.time();
+            }
+
+            const float * state(void)
+            {
+                return dynamics.x;
+            }
+
+    }; // class Sitl
+
+} // namespace hf
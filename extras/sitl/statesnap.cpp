@@ -0,0 +1,258 @@
+/*
+   Stress test for the State snapshots each Hackflight class publishes
+   through a Seqlock once per loop, when built with HF_STATE_SNAPSHOT.
+
+   One writer thread publishes States whose fields all encode the same
+   count, as fast as it can, while 0 to MAXREADERS reader threads copy
+   them; a copy mixing two publishes is a torn read, and a copy older than
+   the one before is out of order.  Reports both (which must be zero), the
+   readers' copies and retries, and the writer's time per publish against
+   a plain State copy.  Then flies StaticHackflight under SITL to put the
+   publish next to the time of a whole pass through the loop.
+
+   Exits with status 1 on any torn or out-of-order read.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+// Publish snapshots through a Seqlock
+#define HF_STATE_SNAPSHOT
+
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sitl.hpp"
+#include "static_hackflight.hpp"
+
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/yaw.hpp"
+#include "pidcontrollers/level.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+static const uint32_t PUBLISHES = 1000000;
+
+static const uint8_t MAXREADERS = 8;
+
+static const uint32_t LOOPS = 1000000;
+
+// Writer's own CPU time, so that readers sharing its CPU don't count
+static double cpuSeconds(void)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#else
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Every field a different function of the count, so a copy from two publishes shows
+static void fill(hf::State & state, uint32_t count)
+{
+    memset(&state, 0, sizeof(state));
+
+    for (uint8_t k=0; k<hf::State::SIZE; ++k) {
+        state.x[k] = (float)(count + k);
+    }
+
+    for (uint8_t k=0; k<4; ++k) {
+        state.q[k] = (float)(count + 100 + k);
+    }
+}
+
+static bool coherent(const hf::State & state, uint32_t & count)
+{
+    count = (uint32_t)state.x[0];
+
+    hf::State expected;
+    fill(expected, count);
+
+    return !memcmp(state.x, expected.x, sizeof(state.x)) && !memcmp(state.q, expected.q, sizeof(state.q));
+}
+
+typedef struct {
+
+    uint32_t copies;
+    uint32_t retries;
+    uint32_t torn;
+    uint32_t backwards;
+
+} reader_t;
+
+// Returns false on any torn or out-of-order read
+static bool stress(uint8_t nreaders, double & nsecPerPublish)
+{
+    hf::Seqlock<hf::State> snapshot;
+
+    std::atomic<bool> done(false);
+
+    reader_t stats[MAXREADERS] = {};
+
+    std::vector<std::thread> readers;
+
+    for (uint8_t r=0; r<nreaders; ++r) {
+
+        readers.push_back(std::thread([&, r]() {
+
+            uint32_t last = 0;
+
+            while (!done.load(std::memory_order_acquire)) {
+
+                // Nothing to check until the first publish
+                if (snapshot.count() == 0) {
+                    continue;
+                }
+
+                hf::State state;
+
+                if (!snapshot.tryRead(state)) {
+                    stats[r].retries++;
+                    continue;
+                }
+
+                stats[r].copies++;
+
+                uint32_t count = 0;
+
+                if (!coherent(state, count)) {
+                    stats[r].torn++;
+                }
+
+                else if (count < last) {
+                    stats[r].backwards++;
+                }
+
+                last = count;
+            }
+        }));
+    }
+
+    hf::State state;
+
+    double start = cpuSeconds();
+
+    for (uint32_t n=1; n<=PUBLISHES; ++n) {
+        fill(state, n);
+        snapshot.write(state);
+    }
+
+    double publish = cpuSeconds() - start;
+
+    // Same loop, plain copy instead of the publish
+    static hf::State copy;
+
+    start = cpuSeconds();
+
+    for (uint32_t n=1; n<=PUBLISHES; ++n) {
+        fill(state, n);
+        copy = state;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    double plain = cpuSeconds() - start;
+
+    done.store(true, std::memory_order_release);
+
+    for (auto & reader : readers) {
+        reader.join();
+    }
+
+    reader_t total = {};
+
+    for (uint8_t r=0; r<nreaders; ++r) {
+        total.copies += stats[r].copies;
+        total.retries += stats[r].retries;
+        total.torn += stats[r].torn;
+        total.backwards += stats[r].backwards;
+    }
+
+    nsecPerPublish = 1e9 * (publish - plain) / PUBLISHES;
+
+    printf("  %u readers: %10u copies, %8u retries, %u torn, %u out of order; "
+            "publish %5.1f nsec (plain copy %5.1f nsec)\n",
+            nreaders, total.copies, total.retries, total.torn, total.backwards,
+            1e9 * publish / PUBLISHES, 1e9 * plain / PUBLISHES);
+
+    return total.torn == 0 && total.backwards == 0;
+}
+
+static void fly(double nsecPerPublish)
+{
+    hf::SimBoard board;
+    hf::SimReceiver receiver(&board);
+    hf::SimMotors motors(hf::Dynamics::NMOTORS);
+    hf::StaticMixerQuadXMW mixer(&motors);
+    hf::Dynamics dynamics;
+    hf::SimSensors sensors(&dynamics);
+
+    hf::LevelPid levelPid(0.20f);
+    hf::RatePid ratePid(0.225, 0.001875, 0.375);
+    hf::YawPid yawPid(2, 0.1);
+
+    hf::SensorList<hf::SimSensors> sensorList(sensors);
+
+    hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllerList(levelPid, ratePid, yawPid);
+
+    hf::StaticHackflight<hf::SimReceiver, hf::StaticMixerQuadXMW,
+        decltype(sensorList), decltype(controllerList)> hackflight(&board, receiver, mixer, sensorList, controllerList);
+
+    dynamics.reset();
+    hackflight.begin(true);
+    dynamics.setAirborne(100);
+
+    receiver.setSticks(0.14f, 0, 0, 0, +1);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<LOOPS; ++k) {
+        hackflight.update();
+        dynamics.update(motors.values(), 0.0001);
+        board.step(0.0001);
+    }
+
+    double nsecPerLoop = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / LOOPS;
+
+    hf::State state;
+    hackflight.stateSnapshot().read(state);
+
+    printf("\nStaticHackflight under SITL: %u snapshots in %u loops, %.1f nsec/loop; "
+            "the publish is %.1f%% of that\n",
+            hackflight.stateSnapshot().count(), LOOPS, nsecPerLoop, 100 * nsecPerPublish / nsecPerLoop);
+    printf("  last snapshot z %.3f m, vehicle's %.3f m\n", state.x[hf::State::Z], dynamics.x[hf::State::Z]);
+}
+
+int main(int, char **)
+{
+    printf("Seqlock<State> (%u bytes), %u publishes, %u CPUs:\n",
+            (unsigned)sizeof(hf::State), PUBLISHES, std::thread::hardware_concurrency());
+
+    bool ok = true;
+
+    double nsecPerPublish = 0;
+
+    for (uint8_t nreaders=0; nreaders<=MAXREADERS; nreaders = nreaders ? 2*nreaders : 1) {
+        double nsec = 0;
+        ok = stress(nreaders, nsec) && ok;
+        if (nreaders == 0) {
+            nsecPerPublish = nsec;
+        }
+    }
+
+    printf("  %s\n", ok ? "OK" : "FAILED");
+
+    fly(nsecPerPublish);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+   Checks the StickCurve lookup tables against the closed-form curves they
+   are filled from: the worst difference over a dense sweep of stick
+   values, for the Receiver defaults and a steeper rates profile, and the
+   time per stick value of each
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "stickcurve.hpp"
+
+static const uint32_t SWEEP_POINTS = 1000000;
+
+static const uint32_t TIMING_CALLS = 10000000;
+static const uint32_t TIMING_INPUTS = 1024; // power of two
+
+// Stick values at random, the same for both timings
+static std::vector<float> inputs(float min)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(min, 1);
+
+    std::vector<float> values(TIMING_INPUTS);
+    for (float & value : values) {
+        value = uniform(rng);
+    }
+
+    return values;
+}
+
+template <typename Curve>
+static double nsecPerValue(const std::vector<float> & values, Curve curve)
+{
+    float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<TIMING_CALLS; ++k) {
+        sink += curve(values[k & (TIMING_INPUTS-1)]);
+    }
+
+    double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        TIMING_CALLS;
+
+    // Keep the optimizer from discarding the loop
+    return sink == 12345 ? 0 : nsec;
+}
+
+static void report(const char * name, float min, const hf::StickCurve & table, float (*curve)(float))
+{
+    double maxError = 0;
+    double maxValue = 0;
+
+    for (uint32_t k=0; k<=SWEEP_POINTS; ++k) {
+        float x = min + (1 - min) * k / SWEEP_POINTS;
+        double y = curve(x);
+        maxError = fmax(maxError, fabs(table.lookup(x) - y));
+        maxValue = fmax(maxValue, fabs(y));
+    }
+
+    std::vector<float> values = inputs(min);
+
+    double tableTime = nsecPerValue(values, [&](float x) { return table.lookup(x); });
+    double closedTime = nsecPerValue(values, curve);
+
+    printf("%-28s  %9.2e  %9.2e  %10.2f  %16.2f\n", name, maxError, maxError / maxValue, tableTime, closedTime);
+}
+
+// Fixed parameters, so the compiler can fold them into the closed form as it would in Receiver
+static float defaultCyclic(float x) { return hf::StickCurve::rateCurve(x, 0.90f, 0.65f, 0); }
+static float steepCyclic(float x) { return hf::StickCurve::rateCurve(x, 1.00f, 0.30f, 0.70f); }
+static float linearYaw(float x) { return hf::StickCurve::rateCurve(x, 1, 0, 0); }
+static float defaultThrottle(float x) { return hf::StickCurve::throttleCurve(x, 0.5f, 0.20f); }
+static float hoverThrottle(float x) { return hf::StickCurve::throttleCurve(x, 0.3f, 0.50f); }
+
+int main(int, char **)
+{
+    printf("%u-entry tables; errors over %u stick values\n\n", hf::StickCurve::SIZE, SWEEP_POINTS);
+
+    printf("curve                         max error   relative  nsec/table  nsec/closed-form\n");
+
+    hf::StickCurve curve;
+
+    curve.setRate(0.90f, 0.65f);
+    report("cyclic (Receiver default)", 0, curve, defaultCyclic);
+
+    curve.setRate(1.00f, 0.30f, 0.70f);
+    report("cyclic, super rate 0.7", 0, curve, steepCyclic);
+
+    curve.setRate(1, 0);
+    report("yaw (Receiver default)", 0, curve, linearYaw);
+
+    curve.setThrottle(0.5f, 0.20f);
+    report("throttle (Receiver default)", -1, curve, defaultThrottle);
+
+    curve.setThrottle(0.3f, 0.50f);
+    report("throttle, mid 0.3, expo 0.5", -1, curve, hoverThrottle);
+
+    return 0;
+}
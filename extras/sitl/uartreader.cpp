@@ -0,0 +1,298 @@
+/*
+   Checks the UartReader that hands receiver frames from the reader task to
+   the flight loop, with host threads standing in for the two.
+
+   A simulated receiver sends a frame every FRAME_USEC at 115200 baud,
+   byte by byte in real time, through a ByteSource; a reader thread polls
+   it every millisecond, as DSMX_ESP32_Serial1's task does.  Each frame
+   holds a count, and every channel is a different function of it.  The
+   flight loop, on the main thread, runs at 1 kHz and checks that:
+
+   1. every frame it takes is whole (all channels from the same count) and
+      newer than the one before; frames skipped because a newer one came
+      in first are counted, but are not an error;
+
+   2. after stalling for STALL_USEC, far longer than the ring holds, the
+      frame it takes is the newest sent, not one from before the stall;
+
+   3. lostSignal() is false while frames arrive and true once they have
+      stopped for longer than the timeout.
+
+   Exits with status 1 if any check fails.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "receivers/uartreader.hpp"
+
+static const uint8_t NCHAN = 8;
+
+static const uint32_t FRAME_USEC = 11000;
+static const uint32_t BYTE_USEC = 87;
+static const uint8_t FRAME_BYTES = 2 + NCHAN;
+
+static const uint32_t FRAMES = 300;
+
+static const uint32_t TIMEOUT_USEC = 100000;
+
+static const uint32_t STALL_USEC = 200000;
+
+// Frames are sync, count, then one byte per channel
+static const uint8_t SYNC = 0xA5;
+
+static uint8_t channelByte(uint8_t count, uint8_t channel)
+{
+    return (uint8_t)(count * 7 + channel * 31);
+}
+
+static float normalize(uint8_t value)
+{
+    return value / 127.5f - 1;
+}
+
+class HostClock : public hf::MicrosClock {
+
+    private:
+
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+    public:
+
+        virtual uint32_t micros(void) override
+        {
+            return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - _start).count();
+        }
+
+}; // class HostClock
+
+// Bytes become available as they would on the wire; read only by the reader thread
+class SimReceiverSource : public hf::ByteSource {
+
+    private:
+
+        hf::MicrosClock * _clock = NULL;
+
+        uint32_t _read = 0;
+
+        uint32_t arrived(void)
+        {
+            uint32_t usec = _clock->micros();
+
+            uint32_t frames = usec / FRAME_USEC;
+
+            if (frames >= FRAMES) {
+                return FRAMES * FRAME_BYTES;
+            }
+
+            uint32_t bytes = (usec % FRAME_USEC) / BYTE_USEC;
+
+            return frames * FRAME_BYTES + (bytes < FRAME_BYTES ? bytes : FRAME_BYTES);
+        }
+
+    public:
+
+        SimReceiverSource(hf::MicrosClock * clock)
+        {
+            _clock = clock;
+        }
+
+        virtual int available(void) override
+        {
+            return arrived() - _read;
+        }
+
+        virtual uint8_t read(void) override
+        {
+            uint32_t frame = _read / FRAME_BYTES;
+            uint8_t index = _read % FRAME_BYTES;
+
+            ++_read;
+
+            return index == 0 ? SYNC : index == 1 ? (uint8_t)frame : channelByte((uint8_t)frame, index - 2);
+        }
+
+}; // class SimReceiverSource
+
+class SimParser {
+
+    private:
+
+        uint8_t _bytes[FRAME_BYTES] = {};
+        uint8_t _index = 0;
+
+        bool _gotNewFrame = false;
+
+    public:
+
+        void handleSerialEvent(uint8_t value, uint32_t usec)
+        {
+            (void)usec;
+
+            if (_index == 0 && value != SYNC) {
+                return;
+            }
+
+            _bytes[_index++] = value;
+
+            if (_index == FRAME_BYTES) {
+                _index = 0;
+                _gotNewFrame = true;
+            }
+        }
+
+        bool gotNewFrame(void)
+        {
+            bool result = _gotNewFrame;
+            _gotNewFrame = false;
+            return result;
+        }
+
+        void getChannelValuesNormalized(float * values, uint8_t count)
+        {
+            // The count goes out in channel 0's place, so the frame can be checked
+            values[0] = _bytes[1];
+
+            for (uint8_t k=1; k<count; ++k) {
+                values[k] = normalize(_bytes[k+2]);
+            }
+        }
+
+}; // class SimParser
+
+typedef hf::UartReader<SimParser, NCHAN> reader_t;
+
+static bool whole(const reader_t::frame_t & frame, uint8_t & count)
+{
+    count = (uint8_t)frame.values[0];
+
+    for (uint8_t k=1; k<NCHAN; ++k) {
+        if (frame.values[k] != normalize(channelByte(count, k))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int, char **)
+{
+    HostClock clock;
+    SimReceiverSource source(&clock);
+
+    reader_t reader(&source, &clock);
+
+    std::atomic<bool> done(false);
+
+    std::thread task([&]() {
+        while (!done.load()) {
+            reader.poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    uint32_t taken = 0;
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    uint32_t skipped = 0;
+    uint32_t lost = 0;
+
+    int32_t last = -1;
+
+    bool stalled = false;
+    uint32_t stallBehind = 0;
+
+    bool lostAfter = false;
+
+    while (true) {
+
+        uint32_t usec = clock.micros();
+
+        // Stall once, halfway through
+        if (!stalled && usec > FRAMES * FRAME_USEC / 2) {
+
+            std::this_thread::sleep_for(std::chrono::microseconds(STALL_USEC));
+
+            stalled = true;
+
+            // Newest whole frame on the wire, less one for the reader's polling
+            int32_t newest = (int32_t)((clock.micros() - FRAME_BYTES * BYTE_USEC) / FRAME_USEC) - 1;
+
+            reader_t::frame_t frame = {};
+
+            // Wait for whatever the reader has for us
+            while (!reader.gotNewFrame()) {
+                std::this_thread::yield();
+            }
+
+            frame = reader.frame();
+
+            uint8_t count = 0;
+            torn += !whole(frame, count);
+
+            int32_t got = last + (int32_t)(uint8_t)(count - (uint8_t)last);
+
+            stallBehind = got < newest ? newest - got : 0;
+
+            last = got;
+            ++taken;
+
+            continue;
+        }
+
+        if (usec > FRAMES * FRAME_USEC + 2 * TIMEOUT_USEC) {
+            lostAfter = reader.lostSignal(TIMEOUT_USEC);
+            break;
+        }
+
+        if (reader.gotNewFrame()) {
+
+            uint8_t count = 0;
+
+            torn += !whole(reader.frame(), count);
+
+            // Counts wrap at 256; frames are never that far apart here
+            int32_t got = last + (int32_t)(uint8_t)(count - (uint8_t)last);
+
+            if (got <= last) {
+                ++backwards;
+            }
+
+            else if (last >= 0 && got > last + 1) {
+                skipped += got - last - 1;
+            }
+
+            last = got;
+            ++taken;
+        }
+
+        // Once the first frame is in, and until the last is sent
+        if (last >= 0 && usec < FRAMES * FRAME_USEC && reader.lostSignal(TIMEOUT_USEC)) {
+            ++lost;
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    }
+
+    done.store(true);
+    task.join();
+
+    bool ok = torn == 0 && backwards == 0 && stallBehind <= 1 &&
+        lost == 0 && lostAfter && last == (int32_t)FRAMES - 1;
+
+    printf("UartReader, %u frames every %u usec, 1 kHz flight loop:\n", FRAMES, FRAME_USEC);
+    printf("  %u taken, last %d; %u torn, %u out of order, %u skipped for a newer one\n",
+            taken, last, torn, backwards, skipped);
+    printf("  after a %u usec stall: %u frames behind the newest\n", STALL_USEC, stallBehind);
+    printf("  lost signal: %u times while sending, %s after stopping\n", lost, lostAfter ? "true" : "false");
+    printf("  %s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
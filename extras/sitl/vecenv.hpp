@@ -0,0 +1,235 @@
+/*
+   Vectorized multi-vehicle environment for training learned controllers:
+   advances N vehicles in lockstep on BatchDynamics, reading actions from
+   and writing observations to flat row-major buffers that a caller (e.g.
+   Python through vecenv.py) can fill and read in place
+
+   Per vehicle:
+
+     actions       4 values: throttle, roll, pitch, yaw demands, fed through
+                   the quad-X mixer (ACTIONS_DEMANDS), or four raw motor
+                   values in [0,1] (ACTIONS_MOTORS)
+
+     commands      4 values: the throttle, roll, pitch, yaw demands the vehicle
+                   is being asked to follow, set by the caller like receiver
+                   sticks and passed through to the observations
+
+     observations  State::x[12], then the four commands
+
+     dones         1 if the vehicle crashed (tilted past MAX_ANGLE or hit the
+                   ground) or ran out of steps on the last call to step()
+
+   Vehicles that are done are reset to a random attitude before step()
+   returns, so their observations begin the next episode.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "state.hpp"
+#include "actuators/mixers/quadxmw.hpp"
+
+#include "batch_dynamics.hpp"
+
+namespace hf {
+
+    class VecEnv {
+
+        public:
+
+            enum {
+                ACTIONS_DEMANDS,
+                ACTIONS_MOTORS
+            };
+
+            static const uint8_t NACTIONS = 4;
+            static const uint8_t NCOMMANDS = 4;
+            static const uint8_t NOBSERVATIONS = State::SIZE + NCOMMANDS;
+
+            static constexpr float MAX_ANGLE = 1.2f; // radians
+
+        private:
+
+            BatchDynamics _dynamics;
+
+            uint32_t _count = 0;
+            uint8_t _mode = ACTIONS_DEMANDS;
+
+            float _dt = 0;
+            uint16_t _substeps = 0;
+            uint32_t _maxSteps = 0;
+
+            float _initialAltitude = 10;
+            float _maxInitialAngle = 0.3f;
+
+            std::vector<float> _actions;
+            std::vector<float> _commands;
+            std::vector<float> _observations;
+            std::vector<uint8_t> _dones;
+            std::vector<uint32_t> _steps;
+
+            std::mt19937 _rng;
+
+            void resetVehicle(uint32_t v)
+            {
+                std::uniform_real_distribution<float> uniform(-1, +1);
+
+                _dynamics.reset(v);
+                _dynamics.setAttitude(v,
+                        _maxInitialAngle * uniform(_rng),
+                        _maxInitialAngle * uniform(_rng),
+                        (float)M_PI * uniform(_rng));
+                _dynamics.setAirborne(v, _initialAltitude);
+
+                _steps[v] = 0;
+            }
+
+            void applyActions(void)
+            {
+                float * motors[BatchDynamics::NMOTORS] = {};
+                for (uint8_t k=0; k<BatchDynamics::NMOTORS; ++k) {
+                    motors[k] = _dynamics.motors(k);
+                }
+
+                for (uint32_t v=0; v<_count; ++v) {
+
+                    const float * action = &_actions[v * NACTIONS];
+
+                    float values[BatchDynamics::NMOTORS] = {};
+
+                    if (_mode == ACTIONS_DEMANDS) {
+                        float demands[4] = {action[0], action[1], action[2], action[3]};
+                        StaticMixerQuadXMW::mix(demands, values);
+                    }
+                    else {
+                        for (uint8_t k=0; k<BatchDynamics::NMOTORS; ++k) {
+                            values[k] = MotorConstraint::constrainMotor(k, action[k]);
+                        }
+                    }
+
+                    for (uint8_t k=0; k<BatchDynamics::NMOTORS; ++k) {
+                        motors[k][v] = values[k];
+                    }
+                }
+            }
+
+            void observe(void)
+            {
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    const float * x = _dynamics.x(k);
+                    for (uint32_t v=0; v<_count; ++v) {
+                        _observations[v * NOBSERVATIONS + k] = x[v];
+                    }
+                }
+
+                for (uint32_t v=0; v<_count; ++v) {
+                    memcpy(&_observations[v * NOBSERVATIONS + State::SIZE],
+                            &_commands[v * NCOMMANDS], NCOMMANDS * sizeof(float));
+                }
+            }
+
+        public:
+
+            // Each call to step() advances substeps physics updates of dt seconds;
+            // maxSteps = 0 for episodes that end only by crashing
+            VecEnv(uint32_t count,
+                   uint8_t mode=ACTIONS_DEMANDS,
+                   float dt=0.001f,
+                   uint16_t substeps=10,
+                   uint32_t maxSteps=0,
+                   uint32_t seed=0,
+                   const vehicle_params_t & params=vehicle_params_t())
+                : _dynamics(count, params),
+                  _actions(count * NACTIONS),
+                  _commands(count * NCOMMANDS),
+                  _observations(count * NOBSERVATIONS),
+                  _dones(count),
+                  _steps(count),
+                  _rng(seed)
+            {
+                _count = count;
+                _mode = mode;
+                _dt = dt;
+                _substeps = substeps ? substeps : 1;
+                _maxSteps = maxSteps;
+            }
+
+            uint32_t size(void)
+            {
+                return _count;
+            }
+
+            // count x NACTIONS, written by the caller before each step()
+            float * actions(void)
+            {
+                return &_actions[0];
+            }
+
+            // count x NCOMMANDS, written by the caller whenever the commands change
+            float * commands(void)
+            {
+                return &_commands[0];
+            }
+
+            // count x NOBSERVATIONS, valid after reset() and step()
+            const float * observations(void)
+            {
+                return &_observations[0];
+            }
+
+            // count, valid after step()
+            const uint8_t * dones(void)
+            {
+                return &_dones[0];
+            }
+
+            void reset(void)
+            {
+                for (uint32_t v=0; v<_count; ++v) {
+                    resetVehicle(v);
+                    _dones[v] = 0;
+                }
+
+                observe();
+            }
+
+            void step(void)
+            {
+                applyActions();
+
+                for (uint16_t s=0; s<_substeps; ++s) {
+                    _dynamics.update(_dt);
+                }
+
+                const float * z = _dynamics.x(State::Z);
+                const float * phi = _dynamics.x(State::PHI);
+                const float * theta = _dynamics.x(State::THETA);
+
+                for (uint32_t v=0; v<_count; ++v) {
+
+                    _steps[v]++;
+
+                    _dones[v] = z[v] <= 0 ||
+                        fabsf(phi[v]) > MAX_ANGLE || fabsf(theta[v]) > MAX_ANGLE ||
+                        (_maxSteps && _steps[v] >= _maxSteps);
+
+                    if (_dones[v]) {
+                        resetVehicle(v);
+                    }
+                }
+
+                observe();
+            }
+
+    }; // class VecEnv
+
+} // namespace hf
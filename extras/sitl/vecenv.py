@@ -0,0 +1,117 @@
+'''
+Python interface to the vectorized SITL environment (see vecenv.hpp)
+
+The actions, commands, observations, and dones arrays are numpy views of
+the environment's own buffers, so nothing is copied on either side of a
+step: write actions (and commands) in place, call step(), read
+observations and dones in place.
+
+Build the library first:
+
+  g++ -O3 -fno-trapping-math -march=native -std=c++11 -shared -fPIC \\
+      -I../../src -I../../../RoboFirmwareToolkit/src \\
+      -o libvecenv.so vecenv_capi.cpp
+
+Copyright (C) Simon D. Levy 2021
+
+MIT License
+'''
+
+import ctypes
+import os
+import time
+
+import numpy as np
+
+ACTIONS_DEMANDS, ACTIONS_MOTORS = range(2)
+
+
+class VecEnv(object):
+
+    def __init__(self, count, mode=ACTIONS_DEMANDS, dt=0.001, substeps=10,
+                 max_steps=0, seed=0, library=None):
+
+        if library is None:
+            library = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                   'libvecenv.so')
+
+        lib = ctypes.CDLL(library)
+
+        lib.vecenv_create.restype = ctypes.c_void_p
+        lib.vecenv_create.argtypes = (ctypes.c_uint32, ctypes.c_uint8,
+                                      ctypes.c_float, ctypes.c_uint16,
+                                      ctypes.c_uint32, ctypes.c_uint32)
+
+        for name in ('destroy', 'reset', 'step'):
+            getattr(lib, 'vecenv_' + name).argtypes = (ctypes.c_void_p,)
+
+        for name in ('actions', 'commands', 'observations'):
+            fun = getattr(lib, 'vecenv_' + name)
+            fun.restype = ctypes.POINTER(ctypes.c_float)
+            fun.argtypes = (ctypes.c_void_p,)
+
+        lib.vecenv_dones.restype = ctypes.POINTER(ctypes.c_uint8)
+        lib.vecenv_dones.argtypes = (ctypes.c_void_p,)
+
+        self._lib = lib
+        self._env = lib.vecenv_create(count, mode, dt, substeps, max_steps,
+                                      seed)
+
+        def view(name, columns):
+            pointer = getattr(lib, 'vecenv_' + name)(self._env)
+            shape = (count, columns) if columns else (count,)
+            return np.ctypeslib.as_array(pointer, shape=shape)
+
+        self.actions = view('actions', lib.vecenv_nactions())
+        self.commands = view('commands', lib.vecenv_ncommands())
+        self.observations = view('observations', lib.vecenv_nobservations())
+        self.dones = view('dones', 0)
+
+    def __del__(self):
+        if getattr(self, '_env', None):
+            self._lib.vecenv_destroy(self._env)
+            self._env = None
+
+    def reset(self):
+        self._lib.vecenv_reset(self._env)
+        return self.observations
+
+    def step(self, actions=None):
+        '''
+        Advances every vehicle; actions defaults to what is already in
+        self.actions.  Returns the observations and dones arrays.
+        '''
+        if actions is not None and actions is not self.actions:
+            self.actions[:] = actions
+        self._lib.vecenv_step(self._env)
+        return self.observations, self.dones
+
+
+def main():
+
+    # Throughput check: a proportional attitude policy on 4096 vehicles
+    count, steps = 4096, 1000
+
+    env = VecEnv(count)
+    obs = env.reset()
+
+    start = time.time()
+    crashes = 0
+
+    for _ in range(steps):
+        np.multiply(obs[:, 6], -1.0, out=env.actions[:, 1])   # roll
+        np.multiply(obs[:, 8], +1.0, out=env.actions[:, 2])   # pitch
+        env.actions[:, 0] = 0.12                               # throttle
+        env.actions[:, 3] = -0.1 * obs[:, 11]                  # yaw
+        obs, dones = env.step()
+        crashes += int(dones.sum())
+
+    elapsed = time.time() - start
+
+    print('%d vehicles x %d steps in %3.3f sec: %3.1fM steps/minute, %d resets'
+          % (count, steps, elapsed, count * steps / elapsed * 60 / 1e6,
+             crashes))
+
+
+if __name__ == '__main__':
+    main()
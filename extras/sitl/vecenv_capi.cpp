@@ -0,0 +1,76 @@
+/*
+   C interface to VecEnv, for building a shared library that Python (or
+   anything else with a C FFI) can load; see vecenv.py
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#include "vecenv.hpp"
+
+// Needed by rft::Debugger
+void rft::Board::outbuf(char * buf)
+{
+    fputs(buf, stdout);
+}
+
+extern "C" {
+
+    void * vecenv_create(uint32_t count, uint8_t mode, float dt, uint16_t substeps,
+            uint32_t maxSteps, uint32_t seed)
+    {
+        return new hf::VecEnv(count, mode, dt, substeps, maxSteps, seed);
+    }
+
+    void vecenv_destroy(void * env)
+    {
+        delete (hf::VecEnv *)env;
+    }
+
+    uint8_t vecenv_nactions(void)
+    {
+        return hf::VecEnv::NACTIONS;
+    }
+
+    uint8_t vecenv_ncommands(void)
+    {
+        return hf::VecEnv::NCOMMANDS;
+    }
+
+    uint8_t vecenv_nobservations(void)
+    {
+        return hf::VecEnv::NOBSERVATIONS;
+    }
+
+    float * vecenv_actions(void * env)
+    {
+        return ((hf::VecEnv *)env)->actions();
+    }
+
+    float * vecenv_commands(void * env)
+    {
+        return ((hf::VecEnv *)env)->commands();
+    }
+
+    const float * vecenv_observations(void * env)
+    {
+        return ((hf::VecEnv *)env)->observations();
+    }
+
+    const uint8_t * vecenv_dones(void * env)
+    {
+        return ((hf::VecEnv *)env)->dones();
+    }
+
+    void vecenv_reset(void * env)
+    {
+        ((hf::VecEnv *)env)->reset();
+    }
+
+    void vecenv_step(void * env)
+    {
+        ((hf::VecEnv *)env)->step();
+    }
+
+} // extern "C"
@@ -0,0 +1,94 @@
+/*
+   Work-stealing thread pool for running many independent SITL flights:
+   each worker takes jobs from the back of its own queue, and when that
+   runs dry steals from the front of another worker's queue
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace hf {
+
+    class WorkStealingPool {
+
+        private:
+
+            typedef struct {
+
+                std::mutex lock;
+                std::deque<uint32_t> jobs;
+
+            } queue_t;
+
+            std::vector<queue_t> _queues;
+
+            // Own queue from the back, others' from the front
+            bool take(size_t worker, uint32_t & job)
+            {
+                for (size_t k=0; k<_queues.size(); ++k) {
+
+                    queue_t & queue = _queues[(worker + k) % _queues.size()];
+
+                    std::lock_guard<std::mutex> guard(queue.lock);
+
+                    if (!queue.jobs.empty()) {
+                        if (k == 0) {
+                            job = queue.jobs.back();
+                            queue.jobs.pop_back();
+                        }
+                        else {
+                            job = queue.jobs.front();
+                            queue.jobs.pop_front();
+                        }
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+        public:
+
+            WorkStealingPool(size_t nthreads)
+                : _queues(nthreads)
+            {
+            }
+
+            // Runs work(job) for job = 0 .. njobs-1; jobs don't spawn jobs, so
+            // a worker that finds every queue empty is done
+            template <typename Work>
+            void run(uint32_t njobs, Work work)
+            {
+                // Contiguous blocks, so stealing only starts near the end
+                for (uint32_t j=0; j<njobs; ++j) {
+                    _queues[(uint64_t)j * _queues.size() / njobs].jobs.push_back(j);
+                }
+
+                std::vector<std::thread> threads;
+
+                for (size_t w=0; w<_queues.size(); ++w) {
+                    threads.push_back(std::thread([this, w, &work]() {
+                        uint32_t job = 0;
+                        while (take(w, job)) {
+                            work(job);
+                        }
+                    }));
+                }
+
+                for (auto & thread : threads) {
+                    thread.join();
+                }
+            }
+
+    }; // class WorkStealingPool
+
+} // namespace hf
@@ -16,6 +16,10 @@
 #include <RFT_debugger.hpp>
 
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "actuators/motormixer.hpp"
 
 namespace hf {
 
@@ -23,22 +27,17 @@ namespace hf {
 
         friend class Hackflight;
         friend class SerialTask;
+        friend class HackflightBase;
 
         private:
 
-            // Custom mixer data per motor
-            typedef struct motorMixer_t {
-                int8_t throttle; // T
-                int8_t roll; 	 // A
-                int8_t pitch;	 // E
-                int8_t yaw;	     // R
-            } motorMixer_t;
-
             static const uint8_t MAXMOTORS = 20; // arbitrary
             float _motorsPrev[MAXMOTORS] = {};
             float  _motorsDisarmed[MAXMOTORS];
             uint8_t _nmotors;
 
+            uint8_t _profileStage = _profiler.addStage("Mixer");
+
             void safeWriteMotor(uint8_t index, float value)
             {
                 // Avoid sending the motor the same value over and over
@@ -47,6 +46,8 @@ namespace hf {
                 }
 
                 _motorsPrev[index] = value;
+
+                _telemetry.setMotor(index, value);
             }
 
         protected:
@@ -67,6 +68,13 @@ namespace hf {
                 }
             }
 
+            void useDirections(const motorMixer_t * directions)
+            {
+                for (uint8_t i = 0; i < _nmotors; i++) {
+                    motorDirections[i] = directions[i];
+                }
+            }
+
             void writeMotor(uint8_t index, float value)
             {
                 _motors->write(index, value);
@@ -108,6 +116,10 @@ namespace hf {
 
             void run(float * demands)
             {
+                ProfileTimer timer(_profileStage);
+
+                _telemetry.setDemands(demands);
+
                 // Map throttle demand from [-1,+1] to [0,1]
                 demands[DEMANDS_THROTTLE] = (demands[DEMANDS_THROTTLE] + 1) / 2;
 
@@ -142,6 +154,8 @@ namespace hf {
                 for (uint8_t i = 0; i < _nmotors; i++) {
                     safeWriteMotor(i, motorvals[i]);
                 }
+
+                _blackbox.log(motorvals, _nmotors);
             }
 
     }; // class Mixer
@@ -16,6 +16,10 @@
 #include <RFT_debugger.hpp>
 
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "actuators/motormixer.hpp"
 #include "motor_new.hpp"
 
 namespace hf {
@@ -27,19 +31,13 @@ namespace hf {
 
         private:
 
-            // Custom mixer data per motor
-            typedef struct motorMixer_t {
-                int8_t throttle; // T
-                int8_t roll; 	 // A
-                int8_t pitch;	 // E
-                int8_t yaw;	     // R
-            } motorMixer_t;
-
             static const uint8_t MAXMOTORS = 20; // arbitrary
             float _motorsPrev[MAXMOTORS] = {};
             float  _motorsDisarmed[MAXMOTORS];
             uint8_t _nmotors;
 
+            uint8_t _profileStage = _profiler.addStage("NewMixer");
+
             void safeWriteMotor(uint8_t index, float value)
             {
                 // Avoid sending the motor the same value over and over
@@ -48,6 +46,8 @@ namespace hf {
                 }
 
                 _motorsPrev[index] = value;
+
+                _telemetry.setMotor(index, value);
             }
 
         protected:
@@ -74,6 +74,13 @@ namespace hf {
                 }
              }
 
+            void useDirections(const motorMixer_t * directions)
+            {
+                for (uint8_t i = 0; i < _nmotors; i++) {
+                    motorDirections[i] = directions[i];
+                }
+            }
+
             void writeMotor(uint8_t index, float value)
             {
                 _motors[index]->write(value);
@@ -117,6 +124,10 @@ namespace hf {
 
             void run(float * demands)
             {
+                ProfileTimer timer(_profileStage);
+
+                _telemetry.setDemands(demands);
+
                 // Map throttle demand from [-1,+1] to [0,1]
                 demands[DEMANDS_THROTTLE] = (demands[DEMANDS_THROTTLE] + 1) / 2;
 
@@ -151,6 +162,8 @@ namespace hf {
                 for (uint8_t i = 0; i < _nmotors; i++) {
                     safeWriteMotor(i, motorvals[i]);
                 }
+
+                _blackbox.log(motorvals, _nmotors);
             }
 
     }; // class NewMixer
@@ -19,9 +19,22 @@
 #pragma once
 
 #include "actuators/mixer.hpp"
+#include "actuators/static_mixer.hpp"
 
 namespace hf {
 
+    static constexpr motorMixer_t OCTOXAP_DIRECTIONS[8] = {
+        //Th  RR  PF  YR
+        { +1, -1, -1, -1 }, // 1
+        { +1, +1, +1, -1 }, // 2
+        { +1, -1, -1, +1 }, // 3
+        { +1, -1, +1, +1 }, // 4
+        { +1, +1, -1, +1 }, // 5
+        { +1, +1, +1, +1 }, // 6
+        { +1, +1, -1, -1 }, // 7
+        { +1, -1, +1, -1 }  // 8
+    };
+
     class MixerOctoXAP : public Mixer {
 
         public:
@@ -29,16 +42,10 @@ namespace hf {
             MixerOctoXAP(rft::Motor * motors) 
                 : Mixer(motors, 8)
             {
-                //                     Th  RR  PF  YR
-                motorDirections[0] = { +1, -1, -1, -1 }; // 1
-                motorDirections[1] = { +1, +1, +1, -1 }; // 2    
-                motorDirections[2] = { +1, -1, -1, +1 }; // 3 
-                motorDirections[3] = { +1, -1, +1, +1 }; // 4 
-                motorDirections[4] = { +1, +1, -1, +1 }; // 5 
-                motorDirections[5] = { +1, +1, +1, +1 }; // 6 
-                motorDirections[6] = { +1, +1, -1, -1 }; // 7  
-                motorDirections[7] = { +1, -1, +1, -1 }; // 8 
+                useDirections(OCTOXAP_DIRECTIONS);
             }
     };
 
+    typedef StaticMixer<8, OCTOXAP_DIRECTIONS> StaticMixerOctoXAP;
+
 } // namespac6
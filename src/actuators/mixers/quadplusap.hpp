@@ -18,9 +18,18 @@
 #pragma once
 
 #include "actuators/mixer.hpp"
+#include "actuators/static_mixer.hpp"
 
 namespace hf {
 
+    static constexpr motorMixer_t QUADPLUSAP_DIRECTIONS[4] = {
+        //Th  RR  PF  YR
+        { +1,  0, -1, -1 }, // 1 front
+        { +1, -1,  0, +1 }, // 2 right
+        { +1,  0, +1, -1 }, // 3 rear
+        { +1, +1,  0, +1 }  // 4 left
+    };
+
     class MixerQuadPlusAP : public Mixer {
 
         public:
@@ -28,12 +37,10 @@ namespace hf {
             MixerQuadPlusAP(rft::Motor * motors) 
                 : Mixer(motors, 4)
             {
-                //                     Th  RR  PF  YR
-                motorDirections[0] = { +1,  0, -1, -1 };    // 1 front
-                motorDirections[1] = { +1, -1,  0, +1 };    // 2 right
-                motorDirections[2] = { +1,  0, +1, -1 };    // 3 rear
-                motorDirections[3] = { +1, +1,  0, +1 };    // 4 left
+                useDirections(QUADPLUSAP_DIRECTIONS);
             }
     };
 
+    typedef StaticMixer<4, QUADPLUSAP_DIRECTIONS> StaticMixerQuadPlusAP;
+
 } // namespace
@@ -15,9 +15,18 @@
 #pragma once
 
 #include "actuators/mixer.hpp"
+#include "actuators/static_mixer.hpp"
 
 namespace hf {
 
+    static constexpr motorMixer_t QUADXAP_DIRECTIONS[4] = {
+        //Th  RR  PF  YR
+        { +1, -1, -1, +1 }, // 1 right front
+        { +1, +1, +1, +1 }, // 2 left rear
+        { +1, +1, -1, -1 }, // 3 left front
+        { +1, -1, +1, -1 }  // 4 right rear
+    };
+
     class MixerQuadXAP : public Mixer {
 
         public:
@@ -25,12 +34,10 @@ namespace hf {
             MixerQuadXAP(rft::Motor * motors) 
                 : Mixer(motors, 4)
             {
-                //                     Th  RR  PF  YR
-                motorDirections[0] = { +1, -1, -1, +1 };    // 1 right front
-                motorDirections[1] = { +1, +1, +1, +1 };    // 2 left rear
-                motorDirections[2] = { +1, +1, -1, -1 };    // 3 left front
-                motorDirections[3] = { +1, -1, +1, -1 };    // 4 right rear
+                useDirections(QUADXAP_DIRECTIONS);
             }
     };
 
+    typedef StaticMixer<4, QUADXAP_DIRECTIONS> StaticMixerQuadXAP;
+
 } // namespace
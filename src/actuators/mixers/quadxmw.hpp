@@ -15,9 +15,18 @@
 #pragma once
 
 #include "actuators/mixer.hpp"
+#include "actuators/static_mixer.hpp"
 
 namespace hf {
 
+    static constexpr motorMixer_t QUADXMW_DIRECTIONS[4] = {
+        //Th  RR  PF  YR
+        { +1, -1, +1, -1 }, // 1 right rear
+        { +1, -1, -1, +1 }, // 2 right front
+        { +1, +1, +1, +1 }, // 3 left rear
+        { +1, +1, -1, -1 }  // 4 left front
+    };
+
     class MixerQuadXMW : public Mixer {
 
         public:
@@ -25,12 +34,10 @@ namespace hf {
             MixerQuadXMW(rft::Motor * motors) 
                 : Mixer(motors, 4)
             {
-                //                     Th  RR  PF  YR
-                motorDirections[0] = { +1, -1, +1, -1 };    // 1 right rear
-                motorDirections[1] = { +1, -1, -1, +1 };    // 2 right front
-                motorDirections[2] = { +1, +1, +1, +1 };    // 3 left rear
-                motorDirections[3] = { +1, +1, -1, -1 };    // 4 left front
+                useDirections(QUADXMW_DIRECTIONS);
             }
     };
 
+    typedef StaticMixer<4, QUADXMW_DIRECTIONS> StaticMixerQuadXMW;
+
 } // namespace
@@ -9,9 +9,18 @@
 #pragma once
 
 #include "actuators/mixer.hpp"
+#include "actuators/static_mixer.hpp"
 
 namespace hf {
 
+    static constexpr motorMixer_t THRUSTVEC_DIRECTIONS[4] = {
+        //Th  RR  PF  YR
+        { +1,  0,  0, -1 }, // rotor 1
+        { +1,  0,  0, +1 }, // rotor 2
+        {  0, +1,  0,  0 }, // servo 1
+        {  0,  0, +1,  0 }  // servo 2
+    };
+
     class MixerThrustVector : public Mixer {
 
         public:
@@ -19,12 +28,8 @@ namespace hf {
             MixerThrustVector(rft::Motor * motors) 
                 : Mixer(motors, 4)
             {
-                //                     Th   RR   PF  YR
-                motorDirections[0] = { +1,  0,   0, -1 };   // rotor 1
-                motorDirections[1] = { +1,  0,   0, +1 };   // rotor 2
-                motorDirections[2] = {  0, +1,   0,  0 };   // servo 1
-                motorDirections[3] = {  0,  0 , +1,  0 };   // servo 2
-             }
+                useDirections(THRUSTVEC_DIRECTIONS);
+            }
 
         protected:
 
@@ -35,4 +40,18 @@ namespace hf {
 
     };
 
+    // Servos (3, 4) are not constrained to [0,1]
+    class ThrustVectorConstraint {
+
+        public:
+
+            static float constrainMotor(uint8_t index, float value)
+            {
+                return index < 2 ? MotorConstraint::constrainMotor(index, value) : value;
+            }
+
+    }; // class ThrustVectorConstraint
+
+    typedef StaticMixer<4, THRUSTVEC_DIRECTIONS, ThrustVectorConstraint> StaticMixerThrustVector;
+
 } // namespace
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "actuators/mixers_new/quad_new.hpp"
+#include "actuators/mixers/quadxmw.hpp"
 #include "motor_new.hpp"
 
 namespace hf {
@@ -26,11 +27,7 @@ namespace hf {
             NewMixerQuadXMW(NewMotor * motor1, NewMotor * motor2, NewMotor * motor3, NewMotor * motor4) 
                 : NewQuadMixer(motor1, motor2, motor3, motor4)
             {
-                //                     Th  RR  PF  YR
-                motorDirections[0] = { +1, -1, +1, -1 };    // 1 right rear
-                motorDirections[1] = { +1, -1, -1, +1 };    // 2 right front
-                motorDirections[2] = { +1, +1, +1, +1 };    // 3 left rear
-                motorDirections[3] = { +1, +1, -1, -1 };    // 4 left front
+                useDirections(QUADXMW_DIRECTIONS);
             }
 
     }; // class NewMixerQuadXMW
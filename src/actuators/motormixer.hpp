@@ -0,0 +1,23 @@
+/*
+   Per-motor mixer coefficients
+
+   Copyright (c) 2018 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hf {
+
+    // Custom mixer data per motor
+    typedef struct motorMixer_t {
+        int8_t throttle; // T
+        int8_t roll; 	 // A
+        int8_t pitch;	 // E
+        int8_t yaw;	     // R
+    } motorMixer_t;
+
+} // namespace hf
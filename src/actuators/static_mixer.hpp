@@ -0,0 +1,163 @@
+/*
+   Compile-time mixer class
+
+   Like Mixer, but the motor count and directions are template arguments,
+   so arrays are sized exactly, the direction table is folded into the
+   mixing arithmetic, and motor values are constrained without a virtual
+   call.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_motor.hpp>
+#include <RFT_filters.hpp>
+#include <RFT_actuator.hpp>
+
+#include "demands.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "actuators/motormixer.hpp"
+
+namespace hf {
+
+    // Default constraint: all motors in [0,1]
+    class MotorConstraint {
+
+        public:
+
+            static float constrainMotor(uint8_t index, float value)
+            {
+                (void)index;
+                return rft::Filter::constrainMinMax(value, 0, 1);
+            }
+
+    }; // class MotorConstraint
+
+    template <uint8_t N, const motorMixer_t (&TABLE)[N], class Constraint=MotorConstraint>
+    class StaticMixer : public rft::Actuator {
+
+        friend class Hackflight;
+        friend class SerialTask;
+        friend class HackflightBase;
+
+        private:
+
+            float _motorsPrev[N] = {};
+            float _motorsDisarmed[N] = {};
+
+            uint8_t _profileStage = _profiler.addStage("StaticMixer");
+
+            rft::Motor * _motors = NULL;
+
+            void writeMotor(uint8_t index, float value)
+            {
+                _motors->write(index, value);
+            }
+
+            void safeWriteMotor(uint8_t index, float value)
+            {
+                // Avoid sending the motor the same value over and over
+                if (_motorsPrev[index] != value) {
+                    writeMotor(index, value);
+                }
+
+                _motorsPrev[index] = value;
+
+                _telemetry.setMotor(index, value);
+            }
+
+        protected:
+
+            virtual void setMotorDisarmed(uint8_t index, float value) override
+            {
+                _motorsDisarmed[index] = value;
+            }
+
+            virtual void begin(void) override
+            {
+                _motors->begin();
+            }
+
+            // This is how we can spin the motors from the GCS
+            virtual void runDisarmed(void) override
+            {
+                for (uint8_t i = 0; i < N; i++) {
+                    safeWriteMotor(i, _motorsDisarmed[i]);
+                }
+            }
+
+            virtual void cut(void) override
+            {
+                for (uint8_t i = 0; i < N; i++) {
+                    writeMotor(i, 0);
+                }
+            }
+
+        public:
+
+            static const uint8_t NMOTORS = N;
+
+            StaticMixer(rft::Motor * motors)
+            {
+                _motors = motors;
+            }
+
+            // Demands to constrained motor values, without touching the motors;
+            // also used by SITL tools that mix for many vehicles at once
+            static void mix(float * demands, float * motorvals)
+            {
+                // Map throttle demand from [-1,+1] to [0,1]
+                demands[DEMANDS_THROTTLE] = (demands[DEMANDS_THROTTLE] + 1) / 2;
+
+                for (uint8_t i = 0; i < N; i++) {
+
+                    motorvals[i] = 
+                        (demands[DEMANDS_THROTTLE] * TABLE[i].throttle + 
+                         demands[DEMANDS_ROLL]     * TABLE[i].roll +     
+                         demands[DEMANDS_PITCH]    * TABLE[i].pitch +   
+                         demands[DEMANDS_YAW]      * TABLE[i].yaw);      
+                }
+
+                float maxMotor = motorvals[0];
+
+                for (uint8_t i = 1; i < N; i++)
+                    if (motorvals[i] > maxMotor)
+                        maxMotor = motorvals[i];
+
+                for (uint8_t i = 0; i < N; i++) {
+
+                    // This is a way to still have good gyro corrections if at least one motor reaches its max
+                    if (maxMotor > 1) {
+                        motorvals[i] -= maxMotor - 1;
+                    }
+
+                    // Keep motor values in appropriate interval
+                    motorvals[i] = Constraint::constrainMotor(i, motorvals[i]);
+                }
+            }
+
+            virtual void run(float * demands) override
+            {
+                ProfileTimer timer(_profileStage);
+
+                _telemetry.setDemands(demands);
+
+                float motorvals[N];
+
+                mix(demands, motorvals);
+
+                for (uint8_t i = 0; i < N; i++) {
+                    safeWriteMotor(i, motorvals[i]);
+                }
+
+                _blackbox.log(motorvals, N);
+            }
+
+    }; // class StaticMixer
+
+} // namespace hf
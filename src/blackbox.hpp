@@ -0,0 +1,440 @@
+/*
+   Blackbox flight logger
+
+   Every Nth run of the mixer, logs the time, the vehicle state, the
+   receiver channels and demands, the demands coming out of each
+   closed-loop controller, in the order they run, and the motor values.
+   Each Hackflight class hands its controllers over in begin(); a
+   controller records its output with a BlackboxCapture, and one that
+   doesn't (e.g. a passthru) logs zeros.  Each value is stored as
+   the zigzag/varint-coded difference between its IEEE bit pattern and the
+   one in the previous record, so the log is lossless and slowly-varying
+   values take a byte or two.  Records go into a fixed ring buffer that
+   Hackflight::update() drains a little at a time into a pluggable sink
+   (serial port, flash file, or a host file in SITL).  If the sink can't
+   keep up, records are dropped and the next one is a keyframe, from which
+   a reader can resynchronize.  The mixer logging and the sink draining
+   may run on different cores: the ring is single-producer,
+   single-consumer.
+
+   Record layout:
+
+     KEYFRAME, ncontrollers, nmotors, varint fields  (differences from zero)
+     DELTA,    varint fields                         (differences from previous)
+
+   Fields: time (usec), State::x[12], receiver channels[6], receiver
+   demands[4], demands[4] after each controller, motors[nmotors]
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+#include <RFT_board.hpp>
+#include <RFT_closedloop.hpp>
+
+#include "state.hpp"
+#include "receiver.hpp"
+#include "profiler.hpp"
+
+namespace hf {
+
+    // Where the log goes; write() should not block for long
+    class BlackboxSink {
+
+        public:
+
+            virtual void write(const uint8_t * data, uint16_t size) = 0;
+
+    }; // class BlackboxSink
+
+#if defined(ARDUINO)
+
+    // Serial ports and flash/SD files are all Arduino Print objects
+    class BlackboxPrintSink : public BlackboxSink {
+
+        private:
+
+            Print & _out;
+
+        public:
+
+            BlackboxPrintSink(Print & out)
+                : _out(out)
+            {
+            }
+
+            virtual void write(const uint8_t * data, uint16_t size) override
+            {
+                _out.write(data, size);
+            }
+
+    }; // class BlackboxPrintSink
+
+#endif
+
+    // Bytes in the ring: added to by the mixer, taken from by the sink, which
+    // may be on another core.  AVR has no <atomic>, but it has one core, and
+    // the two run in the same loop, so there a plain count does.
+    class BlackboxCount {
+
+        private:
+
+#if defined(__AVR__)
+            uint16_t _count = 0;
+#else
+            std::atomic<uint16_t> _count = {0};
+#endif
+
+        public:
+
+#if defined(__AVR__)
+            uint16_t get(void) { return _count; }
+
+            void set(uint16_t count) { _count = count; }
+
+            void add(uint16_t n) { _count += n; }
+
+            void subtract(uint16_t n) { _count -= n; }
+#else
+            // Acquire, so that the bytes counted are there to read
+            uint16_t get(void) { return _count.load(std::memory_order_acquire); }
+
+            // Release, so that bytes written are there before they're counted
+            void set(uint16_t count) { _count.store(count, std::memory_order_release); }
+
+            void add(uint16_t n) { _count.fetch_add(n, std::memory_order_release); }
+
+            void subtract(uint16_t n) { _count.fetch_sub(n, std::memory_order_release); }
+#endif
+
+    }; // class BlackboxCount
+
+    class Blackbox {
+
+        friend class BlackboxCapture;
+
+        public:
+
+            static const uint8_t KEYFRAME = 0xB0;
+            static const uint8_t DELTA    = 0xB1;
+
+            static const uint8_t MAXCONTROLLERS = 8;
+            static const uint8_t MAXMOTORS = 8;
+
+            static const uint8_t NO_SLOT = 0xFF;
+
+            // Keyframe at least this often, so a reader can start anywhere
+            static const uint8_t KEYFRAME_INTERVAL = 64;
+
+            static const uint8_t MAXFIELDS = 1 + State::SIZE + 6 + 4 + 4*MAXCONTROLLERS + MAXMOTORS;
+
+            static uint8_t fieldCount(uint8_t ncontrollers, uint8_t nmotors)
+            {
+                return 1 + State::SIZE + 6 + 4 + 4*ncontrollers + nmotors;
+            }
+
+        private:
+
+            static const uint16_t RINGSIZE = 4096;
+
+            // Most we hand the sink per call to flush()
+            static const uint16_t FLUSH_BYTES = 64;
+
+            // Worst case: three header bytes, five bytes per varint
+            static const uint16_t MAXRECORD = 3 + 5*MAXFIELDS;
+
+            uint8_t _ring[RINGSIZE] = {};
+            uint16_t _head = 0;
+            uint16_t _tail = 0;
+            BlackboxCount _used;
+
+            BlackboxSink * _sink = NULL;
+
+            rft::Board * _board = NULL;
+            State * _state = NULL;
+            Receiver * _receiver = NULL;
+
+            uint16_t _divisor = 1;
+            uint16_t _runs = 0;
+
+            // The vehicle's controllers, in the order they run
+            const rft::ClosedLoopController * _controllers[MAXCONTROLLERS] = {};
+            uint8_t _ncontrollers = 0;
+            float _controllerDemands[MAXCONTROLLERS][4] = {};
+
+            uint32_t _prev[MAXFIELDS] = {};
+            uint8_t _sinceKeyframe = KEYFRAME_INTERVAL;
+            uint8_t _nmotors = 0;
+            uint8_t _nlogged = 0; // controllers in the last keyframe
+
+            uint32_t _records = 0;
+            uint32_t _dropped = 0;
+
+            uint8_t _profileStage = _profiler.addStage("Blackbox");
+
+            static uint32_t bits(float value)
+            {
+                uint32_t u = 0;
+                memcpy(&u, &value, 4);
+                return u;
+            }
+
+            static uint8_t putVarint(uint8_t * buf, uint32_t value)
+            {
+                uint8_t n = 0;
+
+                while (value >= 0x80) {
+                    buf[n++] = (uint8_t)(value | 0x80);
+                    value >>= 7;
+                }
+
+                buf[n++] = (uint8_t)value;
+
+                return n;
+            }
+
+            void enqueue(const uint8_t * data, uint16_t size)
+            {
+                for (uint16_t k=0; k<size; ++k) {
+                    _ring[_head] = data[k];
+                    _head = (_head + 1) % RINGSIZE;
+                }
+
+                _used.add(size);
+            }
+
+            // NO_SLOT for a controller not in the table
+            uint8_t slot(const rft::ClosedLoopController * controller)
+            {
+                for (uint8_t k=0; k<_ncontrollers; ++k) {
+                    if (_controllers[k] == controller) {
+                        return k;
+                    }
+                }
+
+                return NO_SLOT;
+            }
+
+        public:
+
+            // Called by Hackflight::begin(): stopped and empty, with no
+            // controllers until addController()
+            void begin(rft::Board * board, State * state, Receiver * receiver)
+            {
+                _board = board;
+                _state = state;
+                _receiver = receiver;
+
+                _ncontrollers = 0;
+                memset(_controllerDemands, 0, sizeof(_controllerDemands));
+
+                _sink = NULL;
+                _divisor = 1;
+                _runs = 0;
+
+                _head = 0;
+                _tail = 0;
+                _used.set(0);
+
+                memset(_prev, 0, sizeof(_prev));
+                _sinceKeyframe = KEYFRAME_INTERVAL;
+                _nmotors = 0;
+                _nlogged = 0;
+
+                _records = 0;
+                _dropped = 0;
+            }
+
+            // Starts logging every divisor-th mixer run to a sink
+            void start(BlackboxSink * sink, uint16_t divisor=1)
+            {
+                _sink = sink;
+                _divisor = divisor ? divisor : 1;
+                _runs = 0;
+                _sinceKeyframe = KEYFRAME_INTERVAL;
+            }
+
+            void stop(void)
+            {
+                _sink = NULL;
+            }
+
+            // Called by Hackflight::begin() for each closed-loop controller,
+            // in the order they run; returns false when the table is full
+            bool addController(const rft::ClosedLoopController * controller)
+            {
+                if (_ncontrollers == MAXCONTROLLERS) {
+                    return false;
+                }
+
+                _controllers[_ncontrollers++] = controller;
+
+                return true;
+            }
+
+            // Called by the mixer with its final motor values
+            void log(const float * motors, uint8_t nmotors)
+            {
+                if (!_sink || !_state) {
+                    return;
+                }
+
+                if (++_runs < _divisor) {
+                    return;
+                }
+
+                _runs = 0;
+
+                ProfileTimer timer(_profileStage);
+
+                nmotors = nmotors < MAXMOTORS ? nmotors : MAXMOTORS;
+
+                uint32_t fields[MAXFIELDS] = {};
+                uint8_t nfields = 0;
+
+                fields[nfields++] = (uint32_t)(_board->getTime() * 1e6);
+
+                _state->updateEuler();
+
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    fields[nfields++] = bits(_state->x[k]);
+                }
+
+                for (uint8_t k=0; k<6; ++k) {
+                    fields[nfields++] = bits(_receiver->getRawval(k));
+                }
+
+                for (uint8_t k=0; k<4; ++k) {
+                    fields[nfields++] = bits(_receiver->_demands[k]);
+                }
+
+                for (uint8_t j=0; j<_ncontrollers; ++j) {
+                    for (uint8_t k=0; k<4; ++k) {
+                        fields[nfields++] = bits(_controllerDemands[j][k]);
+                    }
+                }
+
+                for (uint8_t k=0; k<nmotors; ++k) {
+                    fields[nfields++] = bits(motors[k]);
+                }
+
+                bool keyframe = _sinceKeyframe >= KEYFRAME_INTERVAL || nmotors != _nmotors || _ncontrollers != _nlogged;
+
+                uint8_t record[MAXRECORD];
+                uint16_t size = 0;
+
+                if (keyframe) {
+                    record[size++] = KEYFRAME;
+                    record[size++] = _ncontrollers;
+                    record[size++] = nmotors;
+                    memset(_prev, 0, sizeof(_prev));
+                }
+                else {
+                    record[size++] = DELTA;
+                }
+
+                for (uint8_t k=0; k<nfields; ++k) {
+                    int32_t delta = (int32_t)(fields[k] - _prev[k]);
+                    size += putVarint(&record[size], ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+                }
+
+                if (size > RINGSIZE - _used.get()) {
+                    _dropped++;
+                    _sinceKeyframe = KEYFRAME_INTERVAL;
+                    return;
+                }
+
+                enqueue(record, size);
+
+                memcpy(_prev, fields, sizeof(_prev));
+                _nmotors = nmotors;
+                _nlogged = _ncontrollers;
+                _sinceKeyframe = keyframe ? 1 : _sinceKeyframe + 1;
+                _records++;
+            }
+
+            // Hands the sink at most FLUSH_BYTES; called once per pass through the loop
+            void flush(void)
+            {
+                uint16_t used = _used.get();
+
+                if (!_sink || !used) {
+                    return;
+                }
+
+                uint16_t size = used < FLUSH_BYTES ? used : FLUSH_BYTES;
+
+                // Stop at the end of the ring; the rest goes next time
+                if (_tail + size > RINGSIZE) {
+                    size = RINGSIZE - _tail;
+                }
+
+                _sink->write(&_ring[_tail], size);
+
+                _tail = (_tail + size) % RINGSIZE;
+                _used.subtract(size);
+            }
+
+            // Bytes waiting for the sink
+            uint16_t pending(void)
+            {
+                return _used.get();
+            }
+
+            uint32_t recordCount(void)
+            {
+                return _records;
+            }
+
+            uint32_t droppedCount(void)
+            {
+                return _dropped;
+            }
+
+    }; // class Blackbox
+
+#if defined(ARDUINO)
+    static Blackbox _blackbox;
+#else
+    static thread_local Blackbox _blackbox;
+#endif
+
+    // Records a controller's output demands when the enclosing scope exits
+    class BlackboxCapture {
+
+        private:
+
+            uint8_t _slot = Blackbox::NO_SLOT;
+
+            const float * _demands = NULL;
+
+        public:
+
+            BlackboxCapture(const rft::ClosedLoopController * controller, const float * demands)
+            {
+                if (_blackbox._sink) {
+                    _slot = _blackbox.slot(controller);
+                    _demands = demands;
+                }
+            }
+
+            ~BlackboxCapture(void)
+            {
+                if (_slot != Blackbox::NO_SLOT) {
+                    memcpy(_blackbox._controllerDemands[_slot], _demands, 4*sizeof(float));
+                }
+            }
+
+    }; // class BlackboxCapture
+
+} // namespace hf
@@ -0,0 +1,374 @@
+/*
+   Hackflight core algorithm split across two cores
+
+   Like StaticHackflight, but only the receiver, sensors, closed-loop
+   controllers, and mixer run in update(), on the flight core.  The serial
+   task, telemetry, and the blackbox sink run in updateComms(), on the
+   other core, so GCS traffic can't delay the flight loop.
+
+   The two sides share nothing but these:
+
+     flight => comms  a snapshot of the state, receiver channels, demands,
+                      and motor values, published through a Seqlock at the
+                      end of each flight pass
+
+     comms => flight  motor values set from the GCS while disarmed, through
+                      an SpscRing that the flight pass drains
+
+     blackbox         records are encoded by the mixer on the flight core,
+                      and the single-producer ring is drained on the comms
+                      core
+
+   The comms side sees the vehicle through a copy of the state and a
+   SnapshotReceiver holding the channels, and drives the motors through a
+   QueuedActuator.  Telemetry's loop-timing topic therefore times the comms
+   loop; the flight loop is the profiler's DualCoreHackflight.flight stage.
+   Profiler statistics sent to the GCS are the flight core's, read while it
+   updates them, so a report may mix two passes.
+
+   On the host, the profiler, telemetry, and blackbox are per thread.  So
+   begin() sets up the profiler and blackbox on the flight thread, and
+   beginComms() sets up telemetry on the comms thread, handing the serial
+   task the flight thread's profiler.
+
+   On an ESP32, begin() starts the comms task on the core other than its
+   caller's.  Elsewhere (e.g. SITL) call beginComms() and updateComms() from
+   a thread of your own.
+
+   Example:
+
+     hf::SensorList<hf::UsfsMaxQuaternion, hf::UsfsMaxGyrometer> sensors(quaternion, gyrometer);
+
+     hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllers(levelPid, ratePid, yawPid);
+
+     hf::DualCoreHackflight<DSMX_ESP32_Serial1, StaticMixerQuadXMW,
+         decltype(sensors), decltype(controllers)> h(&board, receiver, mixer, sensors, controllers);
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_board.hpp>
+#include <RFT_actuator.hpp>
+#include <RoboFirmwareToolkit.hpp>
+
+#include "static_hackflight.hpp"
+#include "seqlock.hpp"
+#include "spscring.hpp"
+
+namespace hf {
+
+    // The comms side's receiver: channels copied from the flight core
+    class SnapshotReceiver : public Receiver {
+
+        private:
+
+            // Channels are stored in order
+            static const uint8_t * channelMap(void)
+            {
+                static const uint8_t map[6] = {0, 1, 2, 3, 4, 5};
+                return map;
+            }
+
+        protected:
+
+            virtual bool gotNewFrame(void) override
+            {
+                return false;
+            }
+
+        public:
+
+            SnapshotReceiver(void)
+                : Receiver(channelMap())
+            {
+            }
+
+            void set(const float * values)
+            {
+                for (uint8_t k=0; k<6; ++k) {
+                    rawvals[k] = values[k];
+                }
+            }
+
+    }; // class SnapshotReceiver
+
+    // The comms side's actuator: motor values set from the GCS are queued
+    // for the flight core, which owns the mixer
+    class QueuedActuator : public rft::Actuator {
+
+        template <typename, typename, typename, typename> friend class DualCoreHackflight;
+
+        private:
+
+            typedef struct {
+
+                uint8_t index;
+                float value;
+
+            } command_t;
+
+            SpscRing<command_t, 16> _commands;
+
+            uint8_t _type = 0;
+
+        protected:
+
+            virtual void setMotorDisarmed(uint8_t index, float value) override
+            {
+                command_t command = {index, value};
+
+                _commands.push(command);
+            }
+
+            // The flight core runs the motors while disarmed
+            virtual void runDisarmed(void) override
+            {
+            }
+
+        public:
+
+            virtual void run(float * demands) override
+            {
+                (void)demands;
+            }
+
+            virtual uint8_t getType(void) override
+            {
+                return _type;
+            }
+
+    }; // class QueuedActuator
+
+    template <typename Rx, typename Mix, typename Sensors, typename Controllers>
+    class DualCoreHackflight : public HackflightBase {
+
+        private:
+
+            // Same rate as RFT's closed-loop task
+            static constexpr float CLOSED_LOOP_FREQ = 300;
+
+            typedef struct {
+
+                State state;
+                float rawvals[6];
+                float demands[4];
+                float motors[Telemetry::MAXMOTORS];
+
+            } snapshot_t;
+
+            Rx & _rx;
+
+            Mix & _mixer;
+
+            Sensors _sensors;
+
+            Controllers _controllers;
+
+            State _state;
+
+            float _closedLoopTime = 0;
+
+            // Mixer inputs on the last closed-loop update
+            float _demands[4] = {};
+
+            Seqlock<snapshot_t> _snapshot;
+
+            // Touched only on the comms core, apart from the commands
+            SerialTask _serialTask;
+            State _commsState;
+            SnapshotReceiver _commsReceiver;
+            QueuedActuator _commsActuator;
+
+            // The flight core's logger; on the host, each thread has its own
+            Blackbox * _blackboxLog = NULL;
+
+            // The flight core's, for the serial task to report
+            Profiler * _flightProfiler = NULL;
+
+            uint8_t _flightStage = _profiler.addStage("DualCoreHackflight.flight");
+
+            void runClosedLoop(void)
+            {
+                float time = _board->getTime();
+
+                if (time - _closedLoopTime <= 1 / CLOSED_LOOP_FREQ) {
+                    return;
+                }
+
+                _closedLoopTime = time;
+
+                getDemands(_rx, _demands);
+
+                _controllers.modifyDemands(&_state, _demands, getModeIndex(_rx));
+
+                if (_state.armed) {
+                    _mixer.Mix::run(_demands);
+                }
+                else {
+                    runDisarmed(_mixer);
+                }
+            }
+
+            void runCommands(void)
+            {
+                QueuedActuator::command_t command = {};
+
+                while (_commsActuator._commands.pop(command)) {
+                    setMotorDisarmed(_mixer, command.index, command.value);
+                }
+            }
+
+            void publish(void)
+            {
+                uint8_t nmotors = 0;
+                const float * motors = getMotors(_mixer, nmotors);
+
+                snapshot_t snapshot = {};
+
+                snapshot.state = _state;
+
+                for (uint8_t k=0; k<6; ++k) {
+                    snapshot.rawvals[k] = getRawval(_rx, k);
+                }
+
+                memcpy(snapshot.demands, _demands, sizeof(_demands));
+
+                for (uint8_t k=0; k<Telemetry::MAXMOTORS && k<nmotors; ++k) {
+                    snapshot.motors[k] = motors[k];
+                }
+
+                _snapshot.write(snapshot);
+            }
+
+#if defined(ESP32)
+            static void commsTask(void * params)
+            {
+                DualCoreHackflight * hackflight = (DualCoreHackflight *)params;
+
+                hackflight->beginComms();
+
+                while (true) {
+
+                    hackflight->updateComms();
+
+                    // Let the idle task on this core run
+                    delay(1);
+                }
+            }
+#endif
+
+        protected:
+
+            virtual bool safeStateForArming(void) override
+            {
+                return safeToArm(_state);
+            }
+
+        public:
+
+            DualCoreHackflight(rft::Board * board, Rx & rx, Mix & mixer, Sensors & sensors, Controllers & controllers)
+                : HackflightBase(&_state, board, &rx, &mixer),
+                  _rx(rx),
+                  _mixer(mixer),
+                  _sensors(sensors),
+                  _controllers(controllers)
+            {
+            }
+
+            // On the flight core
+            void begin(bool armed=false)
+            {
+                _sensors.begin();
+
+                // The serial task and telemetry are begun in beginComms()
+                beginRuntime(_state, _rx, armed);
+
+                _closedLoopTime = 0;
+
+                for (uint8_t k=0; k<4; ++k) {
+                    _demands[k] = 0;
+                }
+
+                _commsActuator._type = _mixer.getType();
+
+                _flightProfiler = &_profiler;
+
+                _controllers.addToBlackbox();
+                _blackboxLog = &_blackbox;
+
+                publish();
+
+#if defined(ESP32)
+                TaskHandle_t task;
+                xTaskCreatePinnedToCore(commsTask, "CommsTask", 10000, this, 1, &task, 1 - xPortGetCoreID());
+#endif
+            }
+
+            void update(void)
+            {
+                ProfileTimer timer(_flightStage);
+
+                // Arming, failsafe, and receiver frames
+                checkOpenLoopController();
+
+                // Controllers and mixer at fixed rate
+                runClosedLoop();
+
+                // Sensors
+                _sensors.update(&_state, _board->getTime());
+
+                // Motor values from the GCS
+                runCommands();
+
+                // State, channels, demands, and motors for the comms core
+                publish();
+            }
+
+            // On the comms core, after begin()
+            void beginComms(void)
+            {
+                memset(&_commsState, 0, sizeof(State));
+
+                _telemetry.begin();
+
+                // Motors and demands reach telemetry through the snapshots
+                _telemetry.useSnapshots();
+
+                beginSerialTask(_serialTask, _board, &_commsState, &_commsReceiver, &_commsActuator,
+                        NULL, _flightProfiler);
+            }
+
+            void updateComms(void)
+            {
+                snapshot_t snapshot;
+
+                _snapshot.read(snapshot);
+
+                _commsState = snapshot.state;
+
+                _commsReceiver.set(snapshot.rawvals);
+
+                // Telemetry samples
+                _telemetry.setSnapshot(snapshot.demands, snapshot.motors);
+                _telemetry.sample(_board->getTime(), &_commsState, &_commsReceiver);
+
+                // Update serial comms task
+                _serialTask.update();
+
+                // Blackbox log to its sink
+                _blackboxLog->flush();
+            }
+
+            // Flight passes published so far
+            uint32_t snapshotCount(void)
+            {
+                return _snapshot.count();
+            }
+
+    }; // class DualCoreHackflight
+
+} // namespace hf
@@ -0,0 +1,115 @@
+/*
+   Quaternion-to-Euler conversion with a choice of atan2/asin kernels
+
+   Build with HF_EULER_MATH defined as one of:
+
+     HF_EULER_LIBM     atan2f() and asinf()
+     HF_EULER_FAST     Abramowitz & Stegun 4.4.49 ninth-order polynomial for
+                       atan on [0,1]; max error 1.2e-5 rad in atan2 and asin
+     HF_EULER_FASTEST  Rajan et al. (2006) quadratic for atan on [0,1]; max
+                       error 3.8e-3 rad in atan2 and asin
+
+   The default is HF_EULER_LIBM where there's a hardware FPU and
+   HF_EULER_FAST on soft-float targets (AVR, Cortex-M0), where the libm
+   calls are most of the sensor path.  The polynomial kernels take one
+   division for atan2, plus a sqrtf for asin, which is computed as
+   atan2(x, sqrt(1 - x^2)).  The error bounds above are from the
+   exhaustive sweeps in extras/sitl/eulerbench.cpp.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#define HF_EULER_LIBM    0
+#define HF_EULER_FAST    1
+#define HF_EULER_FASTEST 2
+
+#if !defined(HF_EULER_MATH)
+#if defined(__AVR__) || (defined(__arm__) && !defined(__ARM_FP))
+#define HF_EULER_MATH HF_EULER_FAST
+#else
+#define HF_EULER_MATH HF_EULER_LIBM
+#endif
+#endif
+
+namespace hf {
+
+    class EulerMath {
+
+        private:
+
+            // atan(z) for z in [0,1]
+            template <uint8_t METHOD>
+            static float atanUnit(float z)
+            {
+                if (METHOD == HF_EULER_FASTEST) {
+                    return z * ((float)M_PI/4 + 0.273f * (1 - z));
+                }
+
+                float z2 = z * z;
+
+                return z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+            }
+
+        public:
+
+            template <uint8_t METHOD=HF_EULER_MATH>
+            static float atan2(float y, float x)
+            {
+                if (METHOD == HF_EULER_LIBM) {
+                    return atan2f(y, x);
+                }
+
+                float ax = fabsf(x);
+                float ay = fabsf(y);
+
+                float big = ax > ay ? ax : ay;
+                float small = ax > ay ? ay : ax;
+
+                if (big == 0) {
+                    return 0;
+                }
+
+                // Reduce to the first octant, then reflect back out
+                float a = atanUnit<METHOD>(small / big);
+
+                a = ay > ax ? (float)M_PI/2 - a : a;
+                a = x < 0 ? (float)M_PI - a : a;
+
+                return y < 0 ? -a : a;
+            }
+
+            template <uint8_t METHOD=HF_EULER_MATH>
+            static float asin(float x)
+            {
+                if (METHOD == HF_EULER_LIBM) {
+                    return asinf(x);
+                }
+
+                return atan2<METHOD>(x, sqrtf(1 - x*x));
+            }
+
+            // Roll (right down), pitch (nose up), heading in [-pi,+pi] from
+            // quaternion w, x, y, z
+            template <uint8_t METHOD=HF_EULER_MATH>
+            static void fromQuaternion(const float * q, float & phi, float & theta, float & psi)
+            {
+                float qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+
+                float sinTheta = 2*(qw*qy - qx*qz);
+                sinTheta = sinTheta > 1 ? 1 : (sinTheta < -1 ? -1 : sinTheta);
+
+                phi = atan2<METHOD>(2*(qw*qx + qy*qz), qw*qw - qx*qx - qy*qy + qz*qz);
+                theta = asin<METHOD>(sinTheta);
+                psi = atan2<METHOD>(2*(qx*qy + qw*qz), qw*qw + qx*qx - qy*qy - qz*qz);
+            }
+
+    }; // class EulerMath
+
+} // namespace hf
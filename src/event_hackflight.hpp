@@ -0,0 +1,201 @@
+/*
+   Hackflight core algorithm driven by gyro samples
+
+   Like StaticHackflight, but instead of running all the closed-loop
+   controllers at a fixed rate, each new gyro sample runs the inner (rate)
+   controllers and the mixer at once.  Everything else runs in two
+   lower-priority rate groups, at most one per pass through update():
+
+     attitude    receiver and arming, the other sensors (quaternion), and
+                 the outer controllers (LevelPid), at ATTITUDE_FREQ; the
+                 inner controllers pick up their demands on the next sample
+
+     background  telemetry, serial task, blackbox, when there's nothing
+                 else to do
+
+   So a gyro sample waits for at most one group's pass before it reaches
+   the motors.  The profiler's EventHackflight.gyroToMotor stage times each
+   sample from the gyro read through the motor writes; its maximum, plus
+   the larger of the other two stages' maxima, bounds the latency from
+   gyro data-ready to the motors.
+
+   Example:
+
+     hf::SensorList<hf::UsfsMaxGyrometer> gyro(gyrometer);
+     hf::SensorList<hf::UsfsMaxQuaternion> sensors(quaternion);
+
+     hf::ControllerList<hf::LevelPid> outer(levelPid);
+     hf::ControllerList<hf::RatePid, hf::YawPid> inner(ratePid, yawPid);
+
+     hf::EventHackflight<DSMX_ESP32_Serial1, StaticMixerQuadXMW, decltype(gyro), decltype(sensors),
+         decltype(outer), decltype(inner)> h(&board, receiver, mixer, gyro, sensors, outer, inner);
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_board.hpp>
+#include <RoboFirmwareToolkit.hpp>
+
+#include "static_hackflight.hpp"
+
+namespace hf {
+
+    template <typename Rx, typename Mix, typename Gyro, typename Sensors, typename Outer, typename Inner>
+    class EventHackflight : public HackflightBase {
+
+        private:
+
+            // Same rate as RFT's closed-loop task
+            static constexpr float ATTITUDE_FREQ = 300;
+
+            Rx & _rx;
+
+            Mix & _mixer;
+
+            Gyro _gyro;
+
+            Sensors _sensors;
+
+            Outer _outer;
+
+            Inner _inner;
+
+            SerialTask _serialTask;
+
+            State _state;
+
+            // Published after each pass that changes it
+            StateSnapshot _stateSnapshot;
+
+            // Outer controllers' demands, held for the inner controllers
+            float _demands[4] = {};
+
+            float _attitudeTime = 0;
+
+            uint8_t _gyroStage = _profiler.addStage("EventHackflight.gyroToMotor");
+            uint8_t _attitudeStage = _profiler.addStage("EventHackflight.attitude");
+            uint8_t _backgroundStage = _profiler.addStage("EventHackflight.background");
+
+            bool runGyro(float time)
+            {
+                ProfileTimer timer(_gyroStage);
+
+                if (!_gyro.update(&_state, time)) {
+                    timer.cancel();
+                    return false;
+                }
+
+                float demands[4] = {_demands[0], _demands[1], _demands[2], _demands[3]};
+
+                _inner.modifyDemands(&_state, demands, getModeIndex(_rx));
+
+                if (_state.armed) {
+                    _mixer.Mix::run(demands);
+                }
+                else {
+                    runDisarmed(_mixer);
+                }
+
+                return true;
+            }
+
+            bool runAttitude(float time)
+            {
+                if (time - _attitudeTime <= 1 / ATTITUDE_FREQ) {
+                    return false;
+                }
+
+                _attitudeTime = time;
+
+                ProfileTimer timer(_attitudeStage);
+
+                // Arming, failsafe, and receiver frames
+                checkOpenLoopController();
+
+                _sensors.update(&_state, time);
+
+                getDemands(_rx, _demands);
+
+                _outer.modifyDemands(&_state, _demands, getModeIndex(_rx));
+
+                return true;
+            }
+
+            void runBackground(float time)
+            {
+                ProfileTimer timer(_backgroundStage);
+
+                _telemetry.sample(time, &_state, &_rx);
+
+                _serialTask.update();
+
+                _blackbox.flush();
+            }
+
+        protected:
+
+            virtual bool safeStateForArming(void) override
+            {
+                return safeToArm(_state);
+            }
+
+        public:
+
+            EventHackflight(rft::Board * board, Rx & rx, Mix & mixer, Gyro & gyro, Sensors & sensors,
+                    Outer & outer, Inner & inner)
+                : HackflightBase(&_state, board, &rx, &mixer),
+                  _rx(rx),
+                  _mixer(mixer),
+                  _gyro(gyro),
+                  _sensors(sensors),
+                  _outer(outer),
+                  _inner(inner)
+            {
+            }
+
+            void begin(bool armed=false)
+            {
+                _gyro.begin();
+                _sensors.begin();
+
+                beginRuntime(_state, _rx, armed, &_serialTask, &_stateSnapshot);
+
+                _attitudeTime = 0;
+
+                for (uint8_t k=0; k<4; ++k) {
+                    _demands[k] = 0;
+                }
+
+                _outer.addToBlackbox();
+                _inner.addToBlackbox();
+            }
+
+            // One rate group per call, the gyro first
+            void update(void)
+            {
+                float time = _board->getTime();
+
+                if (runGyro(time) || runAttitude(time)) {
+
+                    // A coherent copy of the state for other readers, after the motors
+                    _stateSnapshot.write(_state);
+
+                    return;
+                }
+
+                runBackground(time);
+            }
+
+            // State as of the last loop, for readers on other threads, cores, or interrupts
+            const StateSnapshot & stateSnapshot(void)
+            {
+                return _stateSnapshot;
+            }
+
+    }; // class EventHackflight
+
+} // namespace hf
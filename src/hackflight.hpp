@@ -13,6 +13,10 @@
 #include "receiver.hpp"
 #include "state.hpp"
 #include "serialtask.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "statesnapshot.hpp"
 
 #include "actuators/mixer.hpp"
 
@@ -36,6 +40,17 @@ namespace hf {
             // Vehicle state
             State _state;
 
+            // Published once per loop
+            StateSnapshot _stateSnapshot;
+
+            // Closed-loop controllers in the order they run, for the blackbox
+            rft::ClosedLoopController * _controllers[Blackbox::MAXCONTROLLERS] = {};
+            uint8_t _ncontrollers = 0;
+
+            // Loop profiling
+            uint8_t _loopStage = _profiler.addStage("Hackflight.update");
+            uint8_t _serialStage = _profiler.addStage("SerialTask");
+
         protected:
 
             virtual bool safeStateForArming(void) override
@@ -59,19 +74,78 @@ namespace hf {
 
                 RFT::begin(armed);
 
+                // Receiver times its frames by our clock
+                _receiver->_clock = _board;
+
                 // Initialize serial timer task
-                _serialTask.begin(_board, &_state, _receiver, _actuator);
+                _serialTask.begin(_board, &_state, _receiver, _actuator, &_stateSnapshot);
+
+                // Nothing from an earlier flight on this thread carries over
+                _profiler.begin();
+                _telemetry.begin();
+
+                // Blackbox logs our state, receiver, and controllers once started
+                _blackbox.begin(_board, &_state, _receiver);
+                for (uint8_t k=0; k<_ncontrollers; ++k) {
+                    _blackbox.addController(_controllers[k]);
+                }
 
             } // init
 
             void update(void)
             {
+                ProfileTimer timer(_loopStage);
+
                 RFT::update();
 
+                // A coherent copy of the state for other readers
+                _stateSnapshot.write(_state);
+
+                // Buffer samples for any telemetry the GCS has subscribed to
+                _telemetry.sample(_board->getTime(), &_state, _receiver);
+
+                // Hand the next chunk of the blackbox log to its sink
+                _blackbox.flush();
+
                 // Update serial comms task
+                ProfileTimer serialTimer(_serialStage);
                 _serialTask.update();
             }
 
+            // Controllers run in the order added, and are logged in that order.
+            // Returns false if the blackbox has no room to log this one; it
+            // runs all the same.
+            bool addClosedLoopController(rft::ClosedLoopController * controller, uint8_t modeIndex=0)
+            {
+                RFT::addClosedLoopController(controller, modeIndex);
+
+                if (_ncontrollers == Blackbox::MAXCONTROLLERS) {
+                    return false;
+                }
+
+                _controllers[_ncontrollers++] = controller;
+
+                return true;
+            }
+
+            // Starts collecting per-stage timing, reported by SerialTask
+            void enableProfiling(void)
+            {
+                _profiler.enable();
+            }
+
+            // Starts logging every divisor-th closed-loop update to a sink
+            void startBlackbox(BlackboxSink * sink, uint16_t divisor=1)
+            {
+                _blackbox.start(sink, divisor);
+            }
+
+            // State as of the last loop, for readers on other threads, cores, or interrupts
+            const StateSnapshot & stateSnapshot(void)
+            {
+                return _stateSnapshot;
+            }
+
     }; // class Hackflight
 
 } // namespace
@@ -0,0 +1,133 @@
+/*
+   Base class for the Hackflight variants (StaticHackflight,
+   EventHackflight, ScheduledHackflight, DualCoreHackflight)
+
+   The receiver, mixers, serial task, and state keep their flight-loop
+   methods out of their public interface.  Rather than each of them
+   befriending every variant, they befriend this class, which passes on
+   just the calls the variants make.  It also holds the steps that begin()
+   shares across the variants.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include <RFT_board.hpp>
+#include <RFT_actuator.hpp>
+#include <RoboFirmwareToolkit.hpp>
+
+#include "receiver.hpp"
+#include "state.hpp"
+#include "serialtask.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "statesnapshot.hpp"
+
+namespace hf {
+
+    class HackflightBase : public rft::RFT {
+
+        protected:
+
+            HackflightBase(State * state, rft::Board * board, Receiver * receiver, rft::Actuator * actuator)
+                : rft::RFT(state, board, receiver, actuator)
+            {
+            }
+
+            // Zeroes the state, begins RFT, and starts this thread's profiler and
+            // blackbox afresh, so nothing from an earlier flight carries over.
+            // With a serial task, begins it and telemetry, which it reports;
+            // DualCoreHackflight passes none and begins those on the comms core.
+            // Sensors and controllers are the caller's.
+            void beginRuntime(State & state, Receiver & receiver, bool armed,
+                    SerialTask * serialTask=NULL, const StateSnapshot * stateSnapshot=NULL)
+            {
+                memset(&state, 0, sizeof(State));
+
+                RFT::begin(armed);
+
+                // Receiver times its frames by our clock
+                useClock(receiver, _board);
+
+                if (serialTask) {
+                    beginSerialTask(*serialTask, _board, &state, &receiver, _actuator, stateSnapshot);
+                    _telemetry.begin();
+                }
+
+                _profiler.begin();
+
+                _blackbox.begin(_board, &state, &receiver);
+            }
+
+            // Receiver -----------------------------------------------------
+
+            static void getDemands(Receiver & receiver, float * demands)
+            {
+                receiver.Receiver::getDemands(demands);
+            }
+
+            static float getRawval(Receiver & receiver, uint8_t channel)
+            {
+                return receiver.getRawval(channel);
+            }
+
+            // From the AUX2 switch
+            static uint8_t getModeIndex(Receiver & receiver)
+            {
+                return receiver.getModeIndex();
+            }
+
+            // Times frames for smoothing
+            static void useClock(Receiver & receiver, rft::Board * clock)
+            {
+                receiver._clock = clock;
+            }
+
+            // Mixer; Mix is Mixer or a StaticMixer ---------------------------
+
+            template <typename Mix>
+            static void runDisarmed(Mix & mixer)
+            {
+                mixer.Mix::runDisarmed();
+            }
+
+            template <typename Mix>
+            static void setMotorDisarmed(Mix & mixer, uint8_t index, float value)
+            {
+                mixer.Mix::setMotorDisarmed(index, value);
+            }
+
+            // Values last written to the motors; count is the mixer's capacity
+            template <typename Mix>
+            static const float * getMotors(const Mix & mixer, uint8_t & count)
+            {
+                count = sizeof(mixer._motorsPrev) / sizeof(float);
+
+                return mixer._motorsPrev;
+            }
+
+            // Serial task ----------------------------------------------------
+
+            static void beginSerialTask(SerialTask & task, rft::Board * board, State * state,
+                    rft::OpenLoopController * olc, rft::Actuator * actuator,
+                    const StateSnapshot * stateSnapshot=NULL, Profiler * loopProfiler=&_profiler)
+            {
+                task.begin(board, state, olc, actuator, stateSnapshot, loopProfiler);
+            }
+
+            // State ----------------------------------------------------------
+
+            static bool safeToArm(State & state)
+            {
+                return state.safeToArm();
+            }
+
+    }; // class HackflightBase
+
+} // namespace hf
@@ -0,0 +1,258 @@
+/*
+   MSP message structs and dispatcher
+
+   Generated by extras/parser/mspgen.py from messages.json; do not edit
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace hf {
+
+    namespace msp {
+
+#pragma pack(push, 1)
+
+        // 16 channels in http://www.multiwii.com/wiki/index.php?title=Multiwii_Serial_Protocol
+        struct RC_NORMAL {
+
+            static const uint8_t ID = 121;
+
+            float c1;
+            float c2;
+            float c3;
+            float c4;
+            float c5;
+            float c6;
+
+        }; // struct RC_NORMAL
+
+        static_assert(sizeof(RC_NORMAL) == 24, "RC_NORMAL must match messages.json");
+
+        struct ATTITUDE_RADIANS {
+
+            static const uint8_t ID = 122;
+
+            float roll;
+            float pitch;
+            float yaw;
+
+        }; // struct ATTITUDE_RADIANS
+
+        static_assert(sizeof(ATTITUDE_RADIANS) == 12, "ATTITUDE_RADIANS must match messages.json");
+
+        struct ACTUATOR_TYPE {
+
+            static const uint8_t ID = 123;
+
+            uint8_t mtype;
+
+        }; // struct ACTUATOR_TYPE
+
+        static_assert(sizeof(ACTUATOR_TYPE) == 1, "ACTUATOR_TYPE must match messages.json");
+
+        // Loop-profiler statistics for the stage chosen by SET_PROFILE_STAGE; times in microseconds
+        struct PROFILE_STATS {
+
+            static const uint8_t ID = 124;
+
+            float stage;
+            float nstages;
+            float count;
+            float minusec;
+            float meanusec;
+            float maxusec;
+
+        }; // struct PROFILE_STATS
+
+        static_assert(sizeof(PROFILE_STATS) == 24, "PROFILE_STATS must match messages.json");
+
+        // Bucket 0 is < 1 usec; bucket k is [2^(k-1), 2^k) usec
+        struct PROFILE_HISTOGRAM {
+
+            static const uint8_t ID = 125;
+
+            float b0;
+            float b1;
+            float b2;
+            float b3;
+            float b4;
+            float b5;
+            float b6;
+            float b7;
+            float b8;
+            float b9;
+            float b10;
+            float b11;
+            float b12;
+            float b13;
+            float b14;
+            float b15;
+
+        }; // struct PROFILE_HISTOGRAM
+
+        static_assert(sizeof(PROFILE_HISTOGRAM) == 64, "PROFILE_HISTOGRAM must match messages.json");
+
+        // Streamed after SET_TELEMETRY: sequence, dropped, then per topic: topic, count, samples (see src/telemetry.hpp)
+        struct TELEMETRY {
+
+            static const uint8_t ID = 126;
+
+        }; // struct TELEMETRY
+
+        // We send floating-point values in [0,1], rather than PWM
+        struct SET_MOTOR_NORMAL {
+
+            static const uint8_t ID = 215;
+
+            float m1;
+            float m2;
+            float m3;
+            float m4;
+
+        }; // struct SET_MOTOR_NORMAL
+
+        static_assert(sizeof(SET_MOTOR_NORMAL) == 16, "SET_MOTOR_NORMAL must match messages.json");
+
+        // Selects the profiler stage to report; an out-of-range stage resets the statistics
+        struct SET_PROFILE_STAGE {
+
+            static const uint8_t ID = 216;
+
+            uint8_t stage;
+
+        }; // struct SET_PROFILE_STAGE
+
+        static_assert(sizeof(SET_PROFILE_STAGE) == 1, "SET_PROFILE_STAGE must match messages.json");
+
+        // Streams a topic (0 attitude, 1 gyro, 2 RC, 3 demands, 4 motors, 5 loop timing) at 1000/divisor Hz in batched TELEMETRY frames (ID 126; layout in src/telemetry.hpp); divisor 0 stops the topic, an out-of-range topic stops them all
+        struct SET_TELEMETRY {
+
+            static const uint8_t ID = 217;
+
+            uint8_t topic;
+            uint8_t divisor;
+
+        }; // struct SET_TELEMETRY
+
+        static_assert(sizeof(SET_TELEMETRY) == 2, "SET_TELEMETRY must match messages.json");
+
+#pragma pack(pop)
+
+        /**
+          * Calls the handler for a message, given its payload.  For requests
+          * (ID < 200) the handler fills in the reply, which goes out through
+          * Task::sendMessage(); for commands the payload is decoded in one
+          * copy and passed to the handler.  Returns false for unknown IDs.
+          */
+        template <class Task>
+        class Dispatcher {
+
+            private:
+
+                typedef void (*thunk_t)(Task * task, const uint8_t * payload);
+
+                typedef struct {
+
+                    uint8_t id;
+                    thunk_t thunk;
+
+                } entry_t;
+
+                static void on_RC_NORMAL(Task * task, const uint8_t * payload)
+                {
+                    RC_NORMAL message = {};
+                    (void)payload;
+                    task->handle_RC_NORMAL_Request(message);
+                    task->sendMessage(message);
+                }
+
+                static void on_ATTITUDE_RADIANS(Task * task, const uint8_t * payload)
+                {
+                    ATTITUDE_RADIANS message = {};
+                    (void)payload;
+                    task->handle_ATTITUDE_RADIANS_Request(message);
+                    task->sendMessage(message);
+                }
+
+                static void on_ACTUATOR_TYPE(Task * task, const uint8_t * payload)
+                {
+                    ACTUATOR_TYPE message = {};
+                    (void)payload;
+                    task->handle_ACTUATOR_TYPE_Request(message);
+                    task->sendMessage(message);
+                }
+
+                static void on_PROFILE_STATS(Task * task, const uint8_t * payload)
+                {
+                    PROFILE_STATS message = {};
+                    (void)payload;
+                    task->handle_PROFILE_STATS_Request(message);
+                    task->sendMessage(message);
+                }
+
+                static void on_PROFILE_HISTOGRAM(Task * task, const uint8_t * payload)
+                {
+                    PROFILE_HISTOGRAM message = {};
+                    (void)payload;
+                    task->handle_PROFILE_HISTOGRAM_Request(message);
+                    task->sendMessage(message);
+                }
+
+                static void on_SET_MOTOR_NORMAL(Task * task, const uint8_t * payload)
+                {
+                    SET_MOTOR_NORMAL message = {};
+                    memcpy(&message, payload, sizeof(message));
+                    task->handle_SET_MOTOR_NORMAL(message);
+                }
+
+                static void on_SET_PROFILE_STAGE(Task * task, const uint8_t * payload)
+                {
+                    SET_PROFILE_STAGE message = {};
+                    memcpy(&message, payload, sizeof(message));
+                    task->handle_SET_PROFILE_STAGE(message);
+                }
+
+                static void on_SET_TELEMETRY(Task * task, const uint8_t * payload)
+                {
+                    SET_TELEMETRY message = {};
+                    memcpy(&message, payload, sizeof(message));
+                    task->handle_SET_TELEMETRY(message);
+                }
+
+            public:
+
+                static bool dispatch(Task * task, uint8_t id, const uint8_t * payload)
+                {
+                    static const entry_t TABLE[] = {
+                        {RC_NORMAL::ID, on_RC_NORMAL},
+                        {ATTITUDE_RADIANS::ID, on_ATTITUDE_RADIANS},
+                        {ACTUATOR_TYPE::ID, on_ACTUATOR_TYPE},
+                        {PROFILE_STATS::ID, on_PROFILE_STATS},
+                        {PROFILE_HISTOGRAM::ID, on_PROFILE_HISTOGRAM},
+                        {SET_MOTOR_NORMAL::ID, on_SET_MOTOR_NORMAL},
+                        {SET_PROFILE_STAGE::ID, on_SET_PROFILE_STAGE},
+                        {SET_TELEMETRY::ID, on_SET_TELEMETRY},
+                    };
+
+                    static const uint8_t COUNT = sizeof(TABLE) / sizeof(entry_t);
+
+                    for (uint8_t k=0; k<COUNT; ++k) {
+                        if (TABLE[k].id == id) {
+                            TABLE[k].thunk(task, payload);
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+        }; // class Dispatcher
+
+    } // namespace msp
+
+} // namespace hf
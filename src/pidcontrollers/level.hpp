@@ -10,6 +10,8 @@
 
 #include "state.hpp"
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
 
 #include <rft_closedloops/pidcontroller.hpp>
 
@@ -47,6 +49,8 @@ namespace hf {
             _AnglePid _rollPid;
             _AnglePid _pitchPid;
 
+            uint8_t _profileStage = _profiler.addStage("LevelPid");
+
         public:
 
             LevelPid(float rollLevelP, float pitchLevelP)
@@ -62,8 +66,15 @@ namespace hf {
 
             void modifyDemands(rft::State * state, float * demands)
             {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
                 State * hfstate = (State *)state;
 
+                // The quaternion sensors leave the Euler angles to us
+                hfstate->updateEuler();
+
                 // Roll angle and roll demand are both positive for starboard right down
                 demands[DEMANDS_ROLL]  = _rollPid.compute(demands[DEMANDS_ROLL], hfstate->x[State::PHI]);
 
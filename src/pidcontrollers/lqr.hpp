@@ -0,0 +1,87 @@
+/*
+   Linear-quadratic regulator (LQR) closed-loop controller
+
+   Replaces the Level/Rate/Yaw PID chain with one full-state feedback law:
+
+     demands = [throttle, 0, 0, 0] - K (x - reference)
+
+   where x is the 12-element State::x, and the reference is the roll and
+   pitch angles and yaw rate that the stick demands ask for, scaled as
+   LevelPid and YawPid scale them.  The gain matrix K comes from
+   extras/sitl/lqrgains.cpp, which solves the discrete Riccati equation for
+   the SITL vehicle model.  All but five of its gains are zero, so
+   pidcontrollers/lqr_gains.hpp keeps only those: roll from PHI and DPHI,
+   pitch from THETA and DTHETA, and yaw from DPSI.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+#include "state.hpp"
+#include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
+
+#include "pidcontrollers/lqr_gains.hpp"
+
+#include <rft_closedloops/pidcontroller.hpp>
+
+namespace hf {
+
+    class LqrController : public rft::PidController {
+
+        private:
+
+            // Maximum roll/pitch demand is +/-0.5, for +/-45 degrees, as in LevelPid
+            static constexpr float DEMAND_TO_ANGLE = 2 * 45 * (float)M_PI / 180;
+
+            uint8_t _profileStage = _profiler.addStage("LqrController");
+
+        public:
+
+            // State minus the reference that the stick demands ask for
+            static void getError(State * state, const float * demands, float * error)
+            {
+                // PHI, THETA, PSI lag the quaternion when a sensor set only that
+                state->updateEuler();
+
+                for (uint8_t k=0; k<State::SIZE; ++k) {
+                    error[k] = state->x[k];
+                }
+
+                // Pitch demand is positive for stick forward, but pitch angle is positive for nose up
+                error[State::PHI] -= demands[DEMANDS_ROLL] * DEMAND_TO_ANGLE;
+                error[State::THETA] += demands[DEMANDS_PITCH] * DEMAND_TO_ANGLE;
+                error[State::DPSI] -= demands[DEMANDS_YAW];
+            }
+
+            // Throttle passes through; roll, pitch, yaw are pure feedback, each
+            // from its own axis
+            static void control(const float * error, float * demands)
+            {
+                demands[DEMANDS_ROLL] = -(lqr::ROLL[0] * error[State::PHI] + lqr::ROLL[1] * error[State::DPHI]);
+                demands[DEMANDS_PITCH] = -(lqr::PITCH[0] * error[State::THETA] + lqr::PITCH[1] * error[State::DTHETA]);
+                demands[DEMANDS_YAW] = -lqr::YAW * error[State::DPSI];
+            }
+
+            virtual void modifyDemands(rft::State * state, float * demands) override
+            {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
+                float error[State::SIZE] = {};
+                getError((State *)state, demands, error);
+
+                control(error, demands);
+            }
+
+    };  // class LqrController
+
+} // namespace hf
@@ -0,0 +1,30 @@
+/*
+   LqrController gains: generated by extras/sitl/lqrgains.cpp; do not edit
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+namespace hf {
+
+    namespace lqr {
+
+        // The rows of K for roll, pitch, yaw, without the gains that are zero:
+        // those on other axes, on unweighted states, and for throttle
+        // Q: angle 1, rate 0.1, yaw rate 100; R: throttle 1, roll/pitch 100, yaw 100
+
+        // On PHI, DPHI
+        static constexpr float ROLL[2] = {0.0989529908, 0.050775096};
+
+        // On THETA, DTHETA
+        static constexpr float PITCH[2] = {-0.0989529908, -0.050775096};
+
+        // On DPSI
+        static constexpr float YAW = 0.98646701;
+
+    } // namespace lqr
+
+} // namespace hf
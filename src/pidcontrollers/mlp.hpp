@@ -0,0 +1,165 @@
+/*
+   Closed-loop controller running a small multi-layer perceptron (MLP)
+   policy in fixed point
+
+   The policy maps the attitude and angular velocity from the state, and
+   the incoming roll, pitch, and yaw demands, to new roll, pitch, and yaw
+   demands, in place of the Level/Rate/Yaw PID chain.  Weights are int8
+   and activations int16 with int32 accumulators, so each neuron costs
+   integer multiply-adds plus one multiply and shift to rescale its
+   output.  The weights come from pidcontrollers/mlp_weights.hpp, which
+   extras/sitl/mlptrain.cpp generates along with the float weights they
+   were quantized from, for checking this kernel on the host.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "state.hpp"
+#include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
+
+#include "pidcontrollers/mlp_weights.hpp"
+
+#include <rft_closedloops/pidcontroller.hpp>
+
+namespace hf {
+
+    class MlpController : public rft::PidController {
+
+        private:
+
+            uint8_t _profileStage = _profiler.addStage("MlpController");
+
+            static int16_t saturate(int32_t value)
+            {
+                return value > 32767 ? 32767 : (value < -32767 ? -32767 : value);
+            }
+
+            // Fully-connected layer with ReLU, rescaled to the next layer's int16 range
+            template <uint8_t NIN, uint8_t NOUT>
+            static void hidden(const int8_t (&weights)[NOUT][NIN], const int32_t (&biases)[NOUT],
+                    int32_t multiplier, uint8_t shift, const int16_t * in, int16_t * out)
+            {
+                for (uint8_t j=0; j<NOUT; ++j) {
+
+                    int32_t acc = biases[j];
+
+                    for (uint8_t k=0; k<NIN; ++k) {
+                        acc += weights[j][k] * in[k];
+                    }
+
+                    out[j] = acc > 0 ? saturate((int32_t)(((int64_t)acc * multiplier) >> shift)) : 0;
+                }
+            }
+
+        public:
+
+            static const uint8_t NINPUTS = mlp::NINPUTS;
+            static const uint8_t NOUTPUTS = mlp::NOUTPUTS;
+
+            // Attitude, angular velocity, and roll/pitch/yaw demands, in the units the policy was trained on
+            static void getInputs(State * state, const float * demands, float * inputs)
+            {
+                // Roll and pitch from the latest quaternion
+                state->updateEuler();
+
+                inputs[0] = state->x[State::PHI];
+                inputs[1] = state->x[State::THETA];
+                inputs[2] = state->x[State::DPHI];
+                inputs[3] = state->x[State::DTHETA];
+                inputs[4] = state->x[State::DPSI];
+                inputs[5] = demands[DEMANDS_ROLL];
+                inputs[6] = demands[DEMANDS_PITCH];
+                inputs[7] = demands[DEMANDS_YAW];
+            }
+
+            // Fixed-point inference: inputs from getInputs(), outputs roll, pitch, yaw demands
+            static void infer(const float * inputs, float * outputs)
+            {
+                int16_t x[mlp::NINPUTS];
+
+                for (uint8_t k=0; k<mlp::NINPUTS; ++k) {
+                    float scaled = inputs[k] * mlp::INPUT_SCALE[k];
+                    x[k] = saturate((int32_t)(scaled + (scaled < 0 ? -0.5f : +0.5f)));
+                }
+
+                int16_t h1[mlp::NHIDDEN];
+                hidden(mlp::WEIGHTS1, mlp::BIASES1, mlp::MULTIPLIER1, mlp::SHIFT1, x, h1);
+
+                int16_t h2[mlp::NHIDDEN];
+                hidden(mlp::WEIGHTS2, mlp::BIASES2, mlp::MULTIPLIER2, mlp::SHIFT2, h1, h2);
+
+                for (uint8_t j=0; j<mlp::NOUTPUTS; ++j) {
+
+                    int32_t acc = mlp::BIASES3[j];
+
+                    for (uint8_t k=0; k<mlp::NHIDDEN; ++k) {
+                        acc += mlp::WEIGHTS3[j][k] * h2[k];
+                    }
+
+                    outputs[j] = acc * mlp::OUTPUT_SCALE[j];
+                }
+            }
+
+#if !defined(ARDUINO)
+
+            // Reference inference with the float weights the fixed-point ones were quantized from
+            static void inferFloat(const float * inputs, float * outputs)
+            {
+                float h1[mlp::NHIDDEN] = {};
+                float h2[mlp::NHIDDEN] = {};
+
+                for (uint8_t j=0; j<mlp::NHIDDEN; ++j) {
+                    float acc = mlp::BIASES1_FLOAT[j];
+                    for (uint8_t k=0; k<mlp::NINPUTS; ++k) {
+                        acc += mlp::WEIGHTS1_FLOAT[j][k] * inputs[k];
+                    }
+                    h1[j] = acc > 0 ? acc : 0;
+                }
+
+                for (uint8_t j=0; j<mlp::NHIDDEN; ++j) {
+                    float acc = mlp::BIASES2_FLOAT[j];
+                    for (uint8_t k=0; k<mlp::NHIDDEN; ++k) {
+                        acc += mlp::WEIGHTS2_FLOAT[j][k] * h1[k];
+                    }
+                    h2[j] = acc > 0 ? acc : 0;
+                }
+
+                for (uint8_t j=0; j<mlp::NOUTPUTS; ++j) {
+                    float acc = mlp::BIASES3_FLOAT[j];
+                    for (uint8_t k=0; k<mlp::NHIDDEN; ++k) {
+                        acc += mlp::WEIGHTS3_FLOAT[j][k] * h2[k];
+                    }
+                    outputs[j] = acc;
+                }
+            }
+
+#endif
+
+            virtual void modifyDemands(rft::State * state, float * demands) override
+            {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
+                float inputs[mlp::NINPUTS] = {};
+                getInputs((State *)state, demands, inputs);
+
+                float outputs[mlp::NOUTPUTS] = {};
+                infer(inputs, outputs);
+
+                demands[DEMANDS_ROLL] = outputs[0];
+                demands[DEMANDS_PITCH] = outputs[1];
+                demands[DEMANDS_YAW] = outputs[2];
+            }
+
+    };  // class MlpController
+
+} // namespace hf
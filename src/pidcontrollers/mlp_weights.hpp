@@ -0,0 +1,167 @@
+/*
+   MlpController weights: generated by extras/sitl/mlptrain.cpp; do not edit
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hf {
+
+    namespace mlp {
+
+        static const uint8_t NINPUTS = 8;
+        static const uint8_t NHIDDEN = 8;
+        static const uint8_t NOUTPUTS = 3;
+
+        // Input to int16
+        static constexpr float INPUT_SCALE[NINPUTS] = {
+            1423.76978,
+            1232.26013,
+            7104.57275,
+            10430.0596,
+            4918.16846,
+            2697.25049,
+            2370.43384,
+            4942.98438,
+        };
+
+        // Hidden layer 1: int16 = relu(WEIGHTS1 x + BIASES1) * MULTIPLIER1 >> SHIFT1
+        static constexpr int8_t WEIGHTS1[NHIDDEN][NINPUTS] = {
+            { 127,  -32,  127,  -19,   42, -110,  -27,  -42},
+            { -13,  110,  -25,  125,    8,   -1,  127,   26},
+            {  57, -127,  101, -127,    5,  -74,  -73,  -28},
+            {  33,  -16,   99,   15,   -8, -127,   81,  -12},
+            {  18,   16,   18,    9, -127,  -15,   14,  127},
+            { -24,   -6,  -22,   -7,  111,   17,   -5, -111},
+            { -69,  -77,  -67,  -45,  -49,   60,  -66,   49},
+            { -21,   16, -119,   18,  -28,   67,  -62,   47},
+        };
+
+        static constexpr int32_t BIASES1[NHIDDEN] = {
+            37829,
+            -289832,
+            -267189,
+            -309727,
+            120170,
+            -24422,
+            60989,
+            -385004,
+        };
+
+        static const int32_t MULTIPLIER1 = 1312620672;
+        static const uint8_t SHIFT1 = 38;
+
+        // Hidden layer 2
+        static constexpr int8_t WEIGHTS2[NHIDDEN][NHIDDEN] = {
+            {  19,   36,  -30,   55,  -31,   12,  -88,  -24},
+            {  -1,  -18,   -4,   -6,  -14,    0,   -3,    1},
+            {  14,    6,   -5,   -8,  -11,   72,    7,  -41},
+            { -54,   34, -127,   20,   -2,   22,  -32,   66},
+            {   1,   22,  -27,  -11,   61,  -10,  -14,  -19},
+            {   9,  -17,   39,   72,    1,   -5,   15,  -66},
+            {  -5,   -2,   41,  -39,  -35,    4,   24,   52},
+            { -10,  -20,   14,   -4,   34,  -18,   30,   27},
+        };
+
+        static constexpr int32_t BIASES2[NHIDDEN] = {
+            -57246,
+            -3218,
+            492,
+            25438,
+            -25660,
+            -43133,
+            -43334,
+            -21693,
+        };
+
+        static const int32_t MULTIPLIER2 = 1629141760;
+        static const uint8_t SHIFT2 = 37;
+
+        // Output layer: demand = (WEIGHTS3 h + BIASES3) * OUTPUT_SCALE
+        static constexpr int8_t WEIGHTS3[NOUTPUTS][NHIDDEN] = {
+            { -41,   56,   -8,   63,  -58, -127,   91,   72},
+            { 127,   -8,  -12,   88,   82,  -12, -111,  -93},
+            { -27,   12, -127,   -7,   76,   28,  -47,   98},
+        };
+
+        static constexpr int32_t BIASES3[NOUTPUTS] = {
+            -4451,
+            -5565,
+            -10183,
+        };
+
+        static constexpr float OUTPUT_SCALE[NOUTPUTS] = {
+            1.55640294e-06,
+            1.12110376e-06,
+            6.72003171e-06,
+        };
+
+#if !defined(ARDUINO)
+
+        // Float weights, for checking the fixed-point ones on the host
+        static constexpr float WEIGHTS1_FLOAT[NHIDDEN][NINPUTS] = {
+            {1.69948936, -0.367647618, 8.48040581, -1.81973636, 1.93373799, -2.79533529, -0.60150528, -1.94458401},
+            {-0.175483927, 1.27677441, -1.66731071, 12.2470322, 0.359829038, -0.0365764163, 2.82947946, 1.21246147},
+            {0.760083675, -1.47089303, 6.75099039, -12.4498892, 0.244974509, -1.86983013, -1.62480903, -1.32308638},
+            {0.438185751, -0.190148756, 6.63399792, 1.4808538, -0.370697737, -3.21958542, 1.80532372, -0.569669664},
+            {0.241087049, 0.182056531, 1.18761528, 0.907696724, -5.8705945, -0.388524771, 0.304040104, 5.9002161},
+            {-0.317135274, -0.0659555197, -1.49625003, -0.708714843, 5.11411619, 0.43408829, -0.115363337, -5.14209366},
+            {-0.919145644, -0.896800697, -4.49565172, -4.40426254, -2.2810483, 1.51282477, -1.46658409, 2.27379084},
+            {-0.282368273, 0.183595017, -7.93221664, 1.7929157, -1.28821194, 1.7005055, -1.39147866, 2.20411706},
+        };
+
+        static constexpr float BIASES1_FLOAT[NHIDDEN] = {
+            0.355545044,
+            -2.72408581,
+            -2.51127315,
+            -2.91108036,
+            1.12945783,
+            -0.229541883,
+            0.573222756,
+            -3.61859298,
+        };
+
+        static constexpr float WEIGHTS2_FLOAT[NHIDDEN][NHIDDEN] = {
+            {0.420490175, 0.796987891, -0.666281462, 1.21937418, -0.676852643, 0.260665745, -1.94030035, -0.542740762},
+            {-0.0289515387, -0.398392409, -0.0791232586, -0.123330258, -0.310963929, 0.00292044156, -0.0658332556, 0.0316952765},
+            {0.309716433, 0.141720802, -0.104372211, -0.174506962, -0.247380912, 1.59672773, 0.154307842, -0.91354996},
+            {-1.20001316, 0.754837811, -2.81474161, 0.451221704, -0.0474275611, 0.496193916, -0.706435263, 1.45555079},
+            {0.0248381365, 0.497979432, -0.591773748, -0.241336823, 1.35244274, -0.228266135, -0.314571559, -0.421982139},
+            {0.205238208, -0.371928006, 0.862311721, 1.59568322, 0.0126917474, -0.106022388, 0.324581325, -1.46606851},
+            {-0.113417603, -0.0450857729, 0.913404346, -0.869111717, -0.783505678, 0.0949659497, 0.524479806, 1.14550936},
+            {-0.21564734, -0.447243065, 0.308534265, -0.0876878724, 0.759959757, -0.406289876, 0.657255113, 0.599131465},
+        };
+
+        static constexpr float BIASES2_FLOAT[NHIDDEN] = {
+            -2.49721861,
+            -0.14035587,
+            0.0214614403,
+            1.10968339,
+            -1.11933708,
+            -1.88155437,
+            -1.89035392,
+            -0.946320355,
+        };
+
+        static constexpr float WEIGHTS3_FLOAT[NOUTPUTS][NHIDDEN] = {
+            {-0.017191492, 0.0236626174, -0.00328194629, 0.0267826747, -0.0243929345, -0.0537111461, 0.0386158079, 0.0302539747},
+            {0.0386890583, -0.00252277474, -0.00355726504, 0.0266790558, 0.0251222532, -0.00352370273, -0.0337601565, -0.0282971933},
+            {-0.0496005081, 0.021243073, -0.231906921, -0.0131062837, 0.139014825, 0.0511614084, -0.0850801095, 0.17895411},
+        };
+
+        static constexpr float BIASES3_FLOAT[NOUTPUTS] = {
+            -0.00692790328,
+            -0.00623890059,
+            -0.0684328526,
+        };
+
+#endif
+
+    } // namespace mlp
+
+} // namespace hf
@@ -0,0 +1,119 @@
+/*
+   Level-mode controller working from the attitude quaternion
+
+   Like LevelPid, turns roll and pitch stick demands into angular-velocity
+   demands for RatePid, but measures the attitude error geometrically
+   instead of by subtracting Euler angles.  The error is the shortest
+   rotation taking the measured "up" direction in body axes (the last row
+   of the rotation matrix, products of quaternion components) to the
+   demanded one, as a quaternion; twice its body X and Y components are
+   the roll and pitch errors.  These agree with LevelPid's near level and,
+   having magnitude 2 sin(tilt/2), keep growing all the way to inverted.
+   There is no trigonometry in the loop and no singularity at +/-90
+   degrees pitch.
+
+   Needs a quaternion in the state: use UsfsQuaternion or UsfsMaxQuaternion
+   with eulerAngles false, so the sensors skip the Euler conversion.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "state.hpp"
+#include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
+
+#include <rft_closedloops/pidcontroller.hpp>
+
+namespace hf {
+
+    class QuaternionLevelPid : public rft::PidController {
+
+        private:
+
+            // Maximum roll/pitch demand is +/-0.5; scaled as in LevelPid, the
+            // demanded tilt's tangent is the angle LevelPid would demand
+            static constexpr float DEMAND_TO_ANGLE = 2 * 45 * (float)M_PI / 180;
+
+            float _rollP = 0;
+            float _pitchP = 0;
+
+            uint8_t _profileStage = _profiler.addStage("QuaternionLevelPid");
+
+        public:
+
+            QuaternionLevelPid(float rollLevelP, float pitchLevelP)
+            {
+                _rollP = rollLevelP;
+                _pitchP = pitchLevelP;
+            }
+
+            QuaternionLevelPid(float rollPitchLevelP)
+                : QuaternionLevelPid(rollPitchLevelP, rollPitchLevelP)
+            {
+            }
+
+            // Tilt error about the body roll and pitch axes, positive where
+            // LevelPid's angle errors are
+            static void tiltError(const float * q, float rollDemand, float pitchDemand,
+                    float & rollError, float & pitchError)
+            {
+                float qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+
+                // Up in body axes: (-sin theta, sin phi cos theta, cos phi cos theta)
+                float ux = 2*(qx*qz - qw*qy);
+                float uy = 2*(qy*qz + qw*qx);
+                float uz = qw*qw - qx*qx - qy*qy + qz*qz;
+
+                // Demanded up; pitch demand is positive for stick forward, i.e. nose down
+                float dx = pitchDemand * DEMAND_TO_ANGLE;
+                float dy = rollDemand * DEMAND_TO_ANGLE;
+                float dz = 1 / sqrtf(dx*dx + dy*dy + 1);
+                dx *= dz;
+                dy *= dz;
+
+                // Halfway between up and demanded up
+                float hx = ux + dx;
+                float hy = uy + dy;
+                float hz = uz + dz;
+                float h2 = hx*hx + hy*hy + hz*hz;
+
+                // Inverted: any axis will do, so roll out
+                if (h2 < 1e-8f) {
+                    rollError = 2;
+                    pitchError = 0;
+                    return;
+                }
+
+                // Error quaternion (up . h, up x h) / |h|, with up x h = up x
+                // demanded up; its w is never negative.  Computed from the
+                // halfway vector, it stays accurate close to inverted.
+                float scale = 2 / sqrtf(h2);
+
+                // Twice the error's X and Y, X negated for LevelPid's roll sign
+                rollError = scale * (uz*dy - uy*dz);
+                pitchError = scale * (uz*dx - ux*dz);
+            }
+
+            virtual void modifyDemands(rft::State * state, float * demands) override
+            {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
+                float rollError = 0, pitchError = 0;
+                tiltError(((State *)state)->q, demands[DEMANDS_ROLL], demands[DEMANDS_PITCH], rollError, pitchError);
+
+                demands[DEMANDS_ROLL] = _rollP * rollError;
+                demands[DEMANDS_PITCH] = _pitchP * pitchError;
+            }
+
+    };  // class QuaternionLevelPid
+
+} // namespace hf
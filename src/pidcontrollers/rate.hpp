@@ -11,10 +11,12 @@
 #include "receiver.hpp"
 #include "state.hpp"
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
 
 #include "pidcontrollers/angvel.hpp"
 
-#include <RFT_Debugger.hpp>
+#include <RFT_debugger.hpp>
 
 namespace hf {
 
@@ -26,6 +28,12 @@ namespace hf {
             AngularVelocityPid _rollPid;
             AngularVelocityPid _pitchPid;
 
+            // Stick feedforward, when the receiver is smoothing
+            const Receiver * _receiver = NULL;
+            float _Kf = 0;
+
+            uint8_t _profileStage = _profiler.addStage("RatePid");
+
         public:
 
             RatePid(const float Kp, const float Ki, const float Kd) 
@@ -34,8 +42,20 @@ namespace hf {
                 _pitchPid.begin(Kp, Ki, Kd);
             }
 
+            // Adds Kf times the roll and pitch stick rates of change to the output;
+            // needs Receiver::setSmoothing(true)
+            void setFeedforward(const Receiver * receiver, const float Kf)
+            {
+                _receiver = receiver;
+                _Kf = Kf;
+            }
+
             virtual void modifyDemands(rft::State * state, float * demands) override
             {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
                 State * hfstate = (State *)state;
 
                 // Roll angle and roll demand are both positive for starboard right down
@@ -44,6 +64,13 @@ namespace hf {
                 // Pitch demand is postive for stick forward, but pitch angle is positive for nose up.
                 // So we negate pitch angle to compute demand
                 demands[DEMANDS_PITCH] = _pitchPid.compute(demands[DEMANDS_PITCH], -hfstate->x[State::DTHETA]);
+
+                if (_receiver) {
+                    float feedforward[4] = {};
+                    _receiver->getFeedforward(feedforward);
+                    demands[DEMANDS_ROLL] += _Kf * feedforward[DEMANDS_ROLL];
+                    demands[DEMANDS_PITCH] += _Kf * feedforward[DEMANDS_PITCH];
+                }
             }
 
             /* XXX should be replaced by resetOnInactivity()
@@ -13,6 +13,8 @@
 #include "receiver.hpp"
 #include "state.hpp"
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "blackbox.hpp"
 #include "pidcontrollers/angvel.hpp"
 
 namespace hf {
@@ -27,6 +29,8 @@ namespace hf {
             // Rate mode uses a rate controller for roll, pitch
             AngularVelocityPid _yawPid;
 
+            uint8_t _profileStage = _profiler.addStage("YawPid");
+
         public:
 
             YawPid(const float Kp_yaw, const float Ki_yaw) 
@@ -36,6 +40,10 @@ namespace hf {
 
             void modifyDemands(rft::State * state, float * demands)
             {
+                BlackboxCapture capture(this, demands);
+
+                ProfileTimer timer(_profileStage);
+
                 State * hfstate = (State *)state;
 
                 demands[DEMANDS_YAW] = _yawPid.compute(demands[DEMANDS_YAW], hfstate->x[State::DPSI]);
@@ -0,0 +1,234 @@
+/*
+   Per-stage loop profiler
+
+   Each instrumented stage (receiver, sensor, PID controller, mixer,
+   serial task) gets a slot in a fixed-size table, holding min/mean/max
+   time and a histogram with logarithmic (power-of-two microsecond) buckets.
+   Profiling is off until Hackflight::enableProfiling() is called, so an
+   idle stage costs one branch.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(ARDUINO)
+#include <chrono>
+#endif
+
+namespace hf {
+
+    class Profiler {
+
+        friend class ProfileTimer;
+
+        public:
+
+            static const uint8_t MAXSTAGES = 16;
+
+            // Bucket 0 is < 1 usec; bucket k is [2^(k-1), 2^k) usec; last bucket is everything above
+            static const uint8_t NBUCKETS = 16;
+
+            static const uint8_t NO_STAGE = 0xFF;
+
+            typedef struct {
+
+                const char * name;
+                uint32_t count;
+                uint32_t minTicks;
+                uint32_t maxTicks;
+                uint64_t sumTicks;
+                uint32_t buckets[NBUCKETS];
+
+            } stage_t;
+
+        private:
+
+            stage_t _stages[MAXSTAGES] = {};
+
+            uint8_t _nstages = 0;
+
+            bool _enabled = false;
+
+            void record(uint8_t index, uint32_t ticks)
+            {
+                stage_t * stage = &_stages[index];
+
+                stage->count++;
+                stage->sumTicks += ticks;
+
+                if (ticks < stage->minTicks) {
+                    stage->minTicks = ticks;
+                }
+
+                if (ticks > stage->maxTicks) {
+                    stage->maxTicks = ticks;
+                }
+
+                uint32_t usec = (uint32_t)(ticks * usecPerTick());
+
+                uint8_t bucket = usec ? 32 - __builtin_clz(usec) : 0;
+
+                stage->buckets[bucket < NBUCKETS ? bucket : NBUCKETS-1]++;
+            }
+
+        public:
+
+            // Cycle counter where we have one, otherwise the finest clock available
+            static uint32_t ticks(void)
+            {
+#if defined(ESP32)
+                return ESP.getCycleCount();
+#elif defined(TEENSYDUINO)
+                return ARM_DWT_CYCCNT;
+#elif defined(ARDUINO)
+                return micros();
+#else
+                return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+            }
+
+            static float usecPerTick(void)
+            {
+#if defined(ESP32)
+                return 1.0f / ESP.getCpuFreqMHz();
+#elif defined(TEENSYDUINO)
+                return 1e6f / F_CPU;
+#elif defined(ARDUINO)
+                return 1;
+#else
+                return 1e-3f;
+#endif
+            }
+
+            // Returns NO_STAGE when the table is full.  A name already in the
+            // table gets its existing stage, so that vehicles flown one after
+            // another on a thread don't fill the table.
+            uint8_t addStage(const char * name)
+            {
+                for (uint8_t k=0; k<_nstages; ++k) {
+                    if (!strcmp(_stages[k].name, name)) {
+                        return k;
+                    }
+                }
+
+                if (_nstages == MAXSTAGES) {
+                    return NO_STAGE;
+                }
+
+                _stages[_nstages].name = name;
+
+                return _nstages++;
+            }
+
+            // Called by Hackflight::begin(); profiling is off until enable()
+            void begin(void)
+            {
+                reset();
+                _enabled = false;
+            }
+
+            void enable(void)
+            {
+#if defined(TEENSYDUINO)
+                // Teensy 3.x boots with the DWT cycle counter stopped
+                ARM_DEMCR |= ARM_DEMCR_TRCENA;
+                ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+
+                reset();
+                _enabled = true;
+            }
+
+            void reset(void)
+            {
+                for (uint8_t k=0; k<_nstages; ++k) {
+                    stage_t * stage = &_stages[k];
+                    stage->count = 0;
+                    stage->minTicks = 0xFFFFFFFF;
+                    stage->maxTicks = 0;
+                    stage->sumTicks = 0;
+                    memset(stage->buckets, 0, sizeof(stage->buckets));
+                }
+            }
+
+            uint8_t stageCount(void)
+            {
+                return _nstages;
+            }
+
+            const stage_t * getStage(uint8_t index)
+            {
+                return index < _nstages ? &_stages[index] : NULL;
+            }
+
+            // Reports times in microseconds
+            void getStats(uint8_t index, uint32_t & count, float & minUsec, float & meanUsec, float & maxUsec)
+            {
+                count = 0;
+                minUsec = 0;
+                meanUsec = 0;
+                maxUsec = 0;
+
+                const stage_t * stage = getStage(index);
+
+                if (stage && stage->count) {
+                    count = stage->count;
+                    minUsec = stage->minTicks * usecPerTick();
+                    meanUsec = (float)stage->sumTicks / stage->count * usecPerTick();
+                    maxUsec = stage->maxTicks * usecPerTick();
+                }
+            }
+
+    }; // class Profiler
+
+    // Singleton, as are _telemetry and _blackbox.  On the host there is one
+    // per thread, so that SITL vehicles can fly in parallel; each begin()
+    // clears what an earlier flight on the same thread left behind.
+#if defined(ARDUINO)
+    static Profiler _profiler;
+#else
+    static thread_local Profiler _profiler;
+#endif
+
+    // Times the enclosing scope for a given stage
+    class ProfileTimer {
+
+        private:
+
+            uint8_t _stage = Profiler::NO_STAGE;
+
+            uint32_t _start = 0;
+
+        public:
+
+            ProfileTimer(uint8_t stage)
+            {
+                if (_profiler._enabled && stage != Profiler::NO_STAGE) {
+                    _stage = stage;
+                    _start = Profiler::ticks();
+                }
+            }
+
+            // Discards this timing, e.g. when there turned out to be nothing to do
+            void cancel(void)
+            {
+                _stage = Profiler::NO_STAGE;
+            }
+
+            ~ProfileTimer(void)
+            {
+                if (_stage != Profiler::NO_STAGE) {
+                    _profiler.record(_stage, Profiler::ticks() - _start);
+                }
+            }
+
+    }; // class ProfileTimer
+
+} // namespace hf
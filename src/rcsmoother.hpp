@@ -0,0 +1,148 @@
+/*
+   Interpolates receiver demands between frames
+
+   Receivers deliver a frame every 9-22 msec, while the closed loop runs
+   at several hundred Hz, so the controllers otherwise see a staircase.
+   RcSmoother measures the frame period and its jitter as frames arrive,
+   then ramps each demand from wherever it was when a frame arrived to
+   the new frame's value over one measured period.  That trades the
+   staircase's half-frame latency for a whole frame; a lead of L ramps
+   instead toward the value extrapolated L frames past the new one, which
+   cuts the latency to (1 - L) frames for smooth stick motion but
+   overshoots a stick snap by L times its size.  It also keeps each
+   demand's rate of change from frame to frame, as a feedforward term
+   for the rate controller; this drops to zero once the next frame is
+   OVERDUE periods late, so that it doesn't outlive the frames.
+
+   An interval spanning dropped frames counts as that many periods in the
+   averages.  A gap of more than MAX_PERIOD (a lost signal, or the first
+   frame) restarts the measurement, holding the new frame's values until
+   the next one.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace hf {
+
+    class RcSmoother {
+
+        public:
+
+            static const uint8_t NDEMANDS = 4;
+
+        private:
+
+            static constexpr float MAX_PERIOD = 0.1f;
+
+            // Periods after a frame, past the one its ramp takes, before the
+            // feedforward is dropped
+            static constexpr float OVERDUE = 0.5f;
+
+            // Weight of each new interval in the period and jitter averages
+            static constexpr float AVERAGING = 1.0f / 16;
+
+            float _period = 0;
+            float _jitter = 0;
+
+            float _frameTime = 0;
+            bool _gotFrame = false;
+
+            float _start[NDEMANDS] = {};
+            float _slope[NDEMANDS] = {};
+            float _last[NDEMANDS] = {};
+            float _feedforward[NDEMANDS] = {};
+
+            float _lead = 0;
+
+        public:
+
+            // Lead in [0,1] frames
+            RcSmoother(float lead=0)
+            {
+                _lead = lead;
+            }
+
+            void frame(float time, const float * demands)
+            {
+                float interval = time - _frameTime;
+
+                bool restart = !_gotFrame || interval <= 0 || interval > MAX_PERIOD;
+
+                if (restart) {
+                    _period = 0;
+                    _jitter = 0;
+                }
+                else if (_period == 0) {
+                    _period = interval;
+                }
+                else {
+
+                    // Spread the interval over any frames that were dropped in it
+                    float frames = floorf(interval / _period + 0.5f);
+                    interval /= frames < 1 ? 1 : frames;
+
+                    _jitter += AVERAGING * (fabsf(interval - _period) - _jitter);
+                    _period += AVERAGING * (interval - _period);
+                }
+
+                // Start each ramp from the value being output now, so there's no jump
+                float now[NDEMANDS] = {};
+                interpolate(time, now);
+
+                float rate = _period > 0 ? 1 / _period : 0;
+
+                for (uint8_t k=0; k<NDEMANDS; ++k) {
+                    _start[k] = restart ? demands[k] : now[k];
+                    float target = demands[k] + _lead * (demands[k] - _last[k]);
+                    _slope[k] = ((restart ? demands[k] : target) - _start[k]) * rate;
+                    _feedforward[k] = restart ? 0 : (demands[k] - _last[k]) * rate;
+                    _last[k] = demands[k];
+                }
+
+                _frameTime = time;
+                _gotFrame = true;
+            }
+
+            void interpolate(float time, float * demands) const
+            {
+                float elapsed = time - _frameTime;
+                elapsed = elapsed < 0 ? 0 : (elapsed > _period ? _period : elapsed);
+
+                for (uint8_t k=0; k<NDEMANDS; ++k) {
+                    demands[k] = _start[k] + _slope[k] * elapsed;
+                }
+            }
+
+            // Change in each demand per second over the last frame; zero once
+            // the next frame is overdue
+            void getFeedforward(float time, float * feedforward) const
+            {
+                bool overdue = time - _frameTime > (1 + OVERDUE) * _period;
+
+                for (uint8_t k=0; k<NDEMANDS; ++k) {
+                    feedforward[k] = overdue ? 0 : _feedforward[k];
+                }
+            }
+
+            // Average frame period, seconds; zero until two frames have arrived
+            float period(void) const
+            {
+                return _period;
+            }
+
+            // Average absolute deviation of the frame interval from the period
+            float jitter(void) const
+            {
+                return _jitter;
+            }
+
+    }; // class RcSmoother
+
+} // namespace hf
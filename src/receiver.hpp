@@ -12,7 +12,11 @@
 #include <math.h>
 
 #include "demands.hpp"
+#include "profiler.hpp"
+#include "stickcurve.hpp"
+#include "rcsmoother.hpp"
 
+#include <RFT_board.hpp>
 #include <RFT_openloop.hpp>
 
 namespace hf {
@@ -21,16 +25,32 @@ namespace hf {
 
         friend class Hackflight;
         friend class SerialTask;
+        friend class Telemetry;
+        friend class Blackbox;
         friend class PidTask;
+        friend class HackflightBase;
 
         private: 
 
             const float THROTTLE_MARGIN = 0.1f;
             const float CYCLIC_EXPO     = 0.65f;
             const float CYCLIC_RATE     = 0.90f;
+            const float THROTTLE_MID    = 0.50f;
             const float THROTTLE_EXPO   = 0.20f;
             const float AUX_THRESHOLD   = 0.4f;
 
+            StickCurve _cyclicCurve;
+            StickCurve _yawCurve;
+            StickCurve _throttleCurve;
+
+            // Set by Hackflight, for timing frames when smoothing
+            rft::Board * _clock = NULL;
+
+            RcSmoother _smoother;
+            bool _smoothing = false;
+
+            uint8_t _profileStage = _profiler.addStage("Receiver");
+
             float adjustCommand(float command, uint8_t channel)
             {
                 command /= 2;
@@ -42,30 +62,11 @@ namespace hf {
                 return command;
             }
 
-            float applyCyclicFunction(float command)
-            {
-                return rcFun(command, CYCLIC_EXPO, CYCLIC_RATE);
-            }
-
             float makePositiveCommand(uint8_t channel)
             {
                 return fabs(rawvals[_channelMap[channel]]);
             }
 
-            static float rcFun(float x, float e, float r)
-            {
-                return (1 + e*(x*x - 1)) * x * r;
-            }
-
-            // [-1,+1] -> [0,1] -> [-1,+1]
-            float throttleFun(float x)
-            {
-                float mid = 0.5;
-                float tmp = (x + 1) / 2 - mid;
-                float y = tmp>0 ? 1-mid : (tmp<0 ? mid : 1);
-                return (mid + tmp*(1-THROTTLE_EXPO + THROTTLE_EXPO * (tmp*tmp) / (y*y))) * 2 - 1;
-            }
-
         protected: 
 
             // maximum number of channels that any receiver will send (of which we'll use six)
@@ -132,19 +133,33 @@ namespace hf {
                 _trimYaw   = 0;
 
                 _demandScale = demandScale;
+
+                _cyclicCurve.setRate(CYCLIC_RATE, CYCLIC_EXPO);
+                _throttleCurve.setThrottle(THROTTLE_MID, THROTTLE_EXPO);
             }
 
             virtual void getDemands(float * demands) override
             {
-                demands[DEMANDS_THROTTLE] = _demands[DEMANDS_THROTTLE];
-                demands[DEMANDS_ROLL] = _demands[DEMANDS_ROLL]* _demandScale;
-                demands[DEMANDS_PITCH] = _demands[DEMANDS_PITCH] * _demandScale;
-                demands[DEMANDS_YAW] = _demands[DEMANDS_YAW] * _demandScale;
+                float smoothed[4] = {};
+
+                const float * source = _demands;
+
+                if (_smoothing && _clock) {
+                    _smoother.interpolate(_clock->getTime(), smoothed);
+                    source = smoothed;
+                }
+
+                demands[DEMANDS_THROTTLE] = source[DEMANDS_THROTTLE];
+                demands[DEMANDS_ROLL] = source[DEMANDS_ROLL]* _demandScale;
+                demands[DEMANDS_PITCH] = source[DEMANDS_PITCH] * _demandScale;
+                demands[DEMANDS_YAW] = source[DEMANDS_YAW] * _demandScale;
 
             }
 
             bool ready(void)
             {
+                ProfileTimer timer(_profileStage);
+
                 // Wait till there's a new frame
                 if (!gotNewFrame()) return false;
 
@@ -156,9 +171,10 @@ namespace hf {
                 _demands[DEMANDS_PITCH] = makePositiveCommand(CHANNEL_PITCH);
                 _demands[DEMANDS_YAW]   = makePositiveCommand(CHANNEL_YAW);
 
-                // Apply expo nonlinearity to roll, pitch
-                _demands[DEMANDS_ROLL]  = applyCyclicFunction(_demands[DEMANDS_ROLL]);
-                _demands[DEMANDS_PITCH] = applyCyclicFunction(_demands[DEMANDS_PITCH]);
+                // Apply rate curves to roll, pitch, yaw
+                _demands[DEMANDS_ROLL]  = _cyclicCurve.lookup(_demands[DEMANDS_ROLL]);
+                _demands[DEMANDS_PITCH] = _cyclicCurve.lookup(_demands[DEMANDS_PITCH]);
+                _demands[DEMANDS_YAW]   = _yawCurve.lookup(_demands[DEMANDS_YAW]);
 
                 // Put sign back on command, yielding [-0.5,+0.5]
                 _demands[DEMANDS_ROLL]  = adjustCommand(_demands[DEMANDS_ROLL], CHANNEL_ROLL);
@@ -170,13 +186,17 @@ namespace hf {
                 _demands[DEMANDS_PITCH] += _trimPitch;
                 _demands[DEMANDS_YAW]   += _trimYaw;
 
-                // Pass throttle demand through exponential function
-                _demands[DEMANDS_THROTTLE] = throttleFun(rawvals[_channelMap[CHANNEL_THROTTLE]]);
+                // Pass throttle demand through throttle curve
+                _demands[DEMANDS_THROTTLE] = _throttleCurve.lookup(rawvals[_channelMap[CHANNEL_THROTTLE]]);
 
                 // Store auxiliary switch state
                 _aux1State = getRawval(CHANNEL_AUX1) >= 0.0 ? (getRawval(CHANNEL_AUX1) > AUX_THRESHOLD ? 2 : 1) : 0;
                 _aux2State = getRawval(CHANNEL_AUX2) >= AUX_THRESHOLD ? 1 : 0;
 
+                if (_smoothing && _clock) {
+                    _smoother.frame(_clock->getTime(), _demands);
+                }
+
                 // Got a new frame
                 return true;
 
@@ -206,6 +226,56 @@ namespace hf {
                 _trimYaw = yaw;
             }
 
+            // Rates profile for roll and pitch; defaults to rate 0.9, expo 0.65
+            void setCyclicRates(float rate, float expo, float superRate=0)
+            {
+                _cyclicCurve.setRate(rate, expo, superRate);
+            }
+
+            // Rates profile for yaw; defaults to linear
+            void setYawRates(float rate, float expo, float superRate=0)
+            {
+                _yawCurve.setRate(rate, expo, superRate);
+            }
+
+            // Defaults to mid 0.5, expo 0.2
+            void setThrottleCurve(float mid, float expo)
+            {
+                _throttleCurve.setThrottle(mid, expo);
+            }
+
+            // Interpolates demands between frames at closed-loop rate, with an
+            // optional lead in frames (see RcSmoother); off by default
+            void setSmoothing(bool smoothing, float lead=0)
+            {
+                _smoothing = smoothing;
+                _smoother = RcSmoother(lead);
+            }
+
+            // Rate of change of each demand per second, as scaled by getDemands();
+            // zero unless smoothing, and once frames stop
+            void getFeedforward(float * feedforward) const
+            {
+                _smoother.getFeedforward(_clock ? _clock->getTime() : 0, feedforward);
+
+                for (uint8_t k=DEMANDS_ROLL; k<=DEMANDS_YAW; ++k) {
+                    feedforward[k] = _smoothing ? feedforward[k] * _demandScale : 0;
+                }
+
+                feedforward[DEMANDS_THROTTLE] = _smoothing ? feedforward[DEMANDS_THROTTLE] : 0;
+            }
+
+            // Measured frame period and jitter, seconds; zero unless smoothing
+            float getFramePeriod(void) const
+            {
+                return _smoother.period();
+            }
+
+            float getFrameJitter(void) const
+            {
+                return _smoother.jitter();
+            }
+
     }; // class Receiver
 
 } // namespace
@@ -1,6 +1,10 @@
 /*
    Spektrum DSMX support for Arduino flight controllers
 
+   A FreeRTOS task drains Serial1 and runs the DSMX parser; each complete
+   frame is timestamped and handed to the flight loop through a
+   UartReader, so the loop never sees a half-updated set of channels.
+
    Copyright (c) 2021 Simon D. Levy
 
    MIT License
@@ -9,15 +13,49 @@
 #pragma once
 
 #include "receiver.hpp"
+#include "receivers/uartreader.hpp"
 #include <DSMRX.h>
 
 namespace hf {
 
+    class Serial1Source : public ByteSource {
+
+        public:
+
+            virtual int available(void) override
+            {
+                return Serial1.available();
+            }
+
+            virtual uint8_t read(void) override
+            {
+                return Serial1.read();
+            }
+
+    }; // class Serial1Source
+
+    class ArduinoClock : public MicrosClock {
+
+        public:
+
+            virtual uint32_t micros(void) override
+            {
+                return ::micros();
+            }
+
+    }; // class ArduinoClock
+
     class DSMX_ESP32_Serial1 : public Receiver {
 
         private:
 
-            DSM2048 _rx;
+            // No frame for this long => lost signal
+            static const uint32_t TIMEOUT_USEC = 100000;
+
+            Serial1Source _serial1;
+            ArduinoClock _arduinoClock;
+
+            UartReader<DSM2048, MAXCHAN> _reader;
 
             uint8_t _rxpin = 0;
             uint8_t _txpin = 0;  // unused
@@ -28,9 +66,7 @@ namespace hf {
 
                 while (true) {
 
-                    if (Serial1.available()) {
-                        receiver->handleSerialEvent(Serial1.read(), micros());
-                    }
+                    receiver->_reader.poll();
 
                     delay(1);
                 }
@@ -50,31 +86,37 @@ namespace hf {
 
             bool gotNewFrame(void)
             {
-                return _rx.gotNewFrame();
+                return _reader.gotNewFrame();
             }
 
             void readRawvals(void)
             {
-                _rx.getChannelValuesNormalized(rawvals, MAXCHAN);
+                for (uint8_t k=0; k<MAXCHAN; ++k) {
+                    rawvals[k] = _reader.frame().values[k];
+                }
             }
 
             bool lostSignal(void)
             {
-                return _rx.timedOut(micros());
+                return _reader.lostSignal(TIMEOUT_USEC);
             }
 
         public:
 
             DSMX_ESP32_Serial1(const uint8_t channelMap[6], const float demandScale, uint8_t rxpin, uint8_t txpin)
-                :  Receiver(channelMap, demandScale) 
-            { 
+                :  Receiver(channelMap, demandScale), _reader(&_serial1, &_arduinoClock)
+            {
                 _rxpin = rxpin;
                 _txpin = txpin;
             }
 
-            void handleSerialEvent(uint8_t value, uint32_t usec)
+            // Takes bytes and time from elsewhere than Serial1 and micros()
+            DSMX_ESP32_Serial1(const uint8_t channelMap[6], const float demandScale, uint8_t rxpin, uint8_t txpin,
+                    ByteSource & source, MicrosClock & clock)
+                :  Receiver(channelMap, demandScale), _reader(&source, &clock)
             {
-                _rx.handleSerialEvent(value, usec);
+                _rxpin = rxpin;
+                _txpin = txpin;
             }
 
     }; // class DSMX_ESP32_Serial1
@@ -11,13 +11,15 @@
 #include "receivers/arduino/dsmx.hpp"
 #include <DSMRX.h>
 
-static hf::DSMX_Receiver * _dsmx_rx;
+// The Arduino core calls serialEvent1() with no context, so the receiver
+// on this port registers itself here; one per port, not per program
+static hf::DSMX_Receiver * _dsmx_rx1 = NULL;
 
 void serialEvent1(void)
 {
-    while (Serial1.available()) {
+    while (_dsmx_rx1 && Serial1.available()) {
 
-        _dsmx_rx->handleSerialEvent(Serial1.read(), micros());
+        _dsmx_rx1->handleSerialEvent(Serial1.read(), micros());
     }
 }
 
@@ -39,7 +41,7 @@ namespace hf {
             DSMX_Receiver_Serial1(const uint8_t channelMap[6], const float demandScale)
                 :  DSMX_Receiver(channelMap, demandScale) 
             { 
-                _dsmx_rx = this;
+                _dsmx_rx1 = this;
             }
 
     }; // class DSMX_Receiver_Serial1
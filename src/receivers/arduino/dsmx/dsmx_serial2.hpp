@@ -11,13 +11,15 @@
 #include "receivers/arduino/dsmx.hpp"
 #include <DSMRX.h>
 
-static hf::DSMX_Receiver * _dsmx_rx;
+// The Arduino core calls serialEvent2() with no context, so the receiver
+// on this port registers itself here; one per port, not per program
+static hf::DSMX_Receiver * _dsmx_rx2 = NULL;
 
 void serialEvent2(void)
 {
-    while (Serial2.available()) {
+    while (_dsmx_rx2 && Serial2.available()) {
 
-        _dsmx_rx->handleSerialEvent(Serial2.read(), micros());
+        _dsmx_rx2->handleSerialEvent(Serial2.read(), micros());
     }
 }
 
@@ -40,7 +42,7 @@ namespace hf {
             DSMX_Receiver_Serial2(const uint8_t channelMap[6], const float demandScale)
                 :  DSMX_Receiver(channelMap, demandScale) 
             { 
-                _dsmx_rx = this;
+                _dsmx_rx2 = this;
             }
 
     }; // class DSMX_Receiver_Serial2
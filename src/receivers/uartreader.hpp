@@ -0,0 +1,127 @@
+/*
+   Receiver frames parsed on one task and handed to the flight loop on
+   another
+
+   The reader task calls poll(), which drains everything its byte source
+   has buffered through the parser, and pushes each complete frame, with
+   the time it completed, into a lock-free ring.  The flight loop pops the
+   newest frame, so it never sees a half-updated set of channels, and
+   judges signal loss from that frame's time.  If the flight loop falls
+   behind, the ring drops the oldest frames, not the newest.
+
+   The byte source and clock are passed in, so that the reader runs on the
+   host as well as on a board (see extras/sitl/uartreader.cpp).  The
+   parser needs handleSerialEvent(uint8_t value, uint32_t usec),
+   gotNewFrame(), and getChannelValuesNormalized(float * values, uint8_t
+   count), as the DSMRX library's parsers have.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "spscring.hpp"
+
+namespace hf {
+
+    // Where the reader gets its bytes; on a board, a hardware serial port
+    class ByteSource {
+
+        public:
+
+            virtual int available(void) = 0;
+
+            virtual uint8_t read(void) = 0;
+
+    }; // class ByteSource
+
+    // Microseconds, wrapping; on a board, micros()
+    class MicrosClock {
+
+        public:
+
+            virtual uint32_t micros(void) = 0;
+
+    }; // class MicrosClock
+
+    template <typename Parser, uint8_t NCHAN>
+    class UartReader {
+
+        public:
+
+            typedef struct {
+
+                uint32_t usec;
+                float values[NCHAN];
+
+            } frame_t;
+
+        private:
+
+            ByteSource * _source = NULL;
+            MicrosClock * _clock = NULL;
+
+            // Touched only by the reader task
+            Parser _parser;
+
+            // Reader task => flight loop
+            SpscRing<frame_t, 4> _frames;
+
+            // Touched only by the flight loop
+            frame_t _frame = {};
+
+        public:
+
+            UartReader(ByteSource * source, MicrosClock * clock)
+            {
+                _source = source;
+                _clock = clock;
+            }
+
+            // Reader task: parses whatever has arrived since the last call
+            void poll(void)
+            {
+                for (int n = _source->available(); n > 0; --n) {
+
+                    uint32_t usec = _clock->micros();
+
+                    _parser.handleSerialEvent(_source->read(), usec);
+
+                    // Checked byte by byte, in case the backlog held more than one frame
+                    if (_parser.gotNewFrame()) {
+
+                        frame_t frame = {};
+
+                        frame.usec = usec;
+                        _parser.getChannelValuesNormalized(frame.values, NCHAN);
+
+                        _frames.push(frame);
+                    }
+                }
+            }
+
+            // Flight loop: takes the newest frame, if there's been one since the last call
+            bool gotNewFrame(void)
+            {
+                return _frames.popNewest(_frame);
+            }
+
+            // Flight loop: the frame taken by the last successful gotNewFrame()
+            const frame_t & frame(void)
+            {
+                return _frame;
+            }
+
+            // Flight loop: no frame for longer than timeoutUsec
+            bool lostSignal(uint32_t timeoutUsec)
+            {
+                return _clock->micros() - _frame.usec > timeoutUsec;
+            }
+
+    }; // class UartReader
+
+} // namespace hf
@@ -0,0 +1,237 @@
+/*
+   Hackflight core algorithm on the multi-rate scheduler
+
+   Like StaticHackflight, but every part of the loop is a Scheduler task
+   with its own rate and priority, instead of all of them being polled on
+   every pass.  Sensors are added as SensorTasks, each at the rate its
+   data arrives; a SensorTask follows its data, so it keeps up with a
+   sensor whose clock drifts from that rate.  The closed loop, receiver, serial task, and background
+   work (telemetry, blackbox) are built in, at the priorities below and
+   the constructor's frequencies.
+
+   Example:
+
+     hf::SensorTask<hf::UsfsMaxGyrometer> gyroTask(gyrometer);
+     hf::SensorTask<hf::UsfsMaxQuaternion> quaternionTask(quaternion);
+
+     hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllers(levelPid, ratePid, yawPid);
+
+     hf::ScheduledHackflight<DSMX_ESP32_Serial1, StaticMixerQuadXMW, decltype(controllers)>
+         h(&board, receiver, mixer, controllers);
+
+     h.addSensorTask(gyroTask, "gyro", 834, 0);
+     h.addSensorTask(quaternionTask, "quaternion", 104, 2);
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_board.hpp>
+#include <RoboFirmwareToolkit.hpp>
+
+#include "static_hackflight.hpp"
+#include "scheduler.hpp"
+
+namespace hf {
+
+    // One or more sensors, checked together at one rate
+    template <typename... Sensors>
+    class SensorTask : public Task {
+
+        private:
+
+            SensorList<Sensors...> _sensors;
+
+        protected:
+
+            virtual void begin(void) override
+            {
+                _sensors.begin();
+            }
+
+            virtual bool run(State * state, float time) override
+            {
+                return _sensors.update(state, time);
+            }
+
+            virtual bool followsData(void) override
+            {
+                return true;
+            }
+
+        public:
+
+            SensorTask(Sensors & ... sensors)
+                : _sensors(sensors...)
+            {
+            }
+
+    }; // class SensorTask
+
+    template <typename Rx, typename Mix, typename Controllers>
+    class ScheduledHackflight : public HackflightBase {
+
+        public:
+
+            // Lower runs first when due together
+            static const uint8_t PRIORITY_CLOSED_LOOP = 1;
+            static const uint8_t PRIORITY_RECEIVER    = 3;
+            static const uint8_t PRIORITY_BACKGROUND  = 4;
+
+        private:
+
+            // Built-in tasks call back into us
+            template <void (ScheduledHackflight::*Method)(float)>
+            class MethodTask : public Task {
+
+                private:
+
+                    ScheduledHackflight * _hackflight = NULL;
+
+                protected:
+
+                    virtual bool run(State * state, float time) override
+                    {
+                        (void)state;
+                        (this->_hackflight->*Method)(time);
+                        return true;
+                    }
+
+                public:
+
+                    MethodTask(ScheduledHackflight * hackflight)
+                    {
+                        _hackflight = hackflight;
+                    }
+
+            }; // class MethodTask
+
+            Rx & _rx;
+
+            Mix & _mixer;
+
+            Controllers _controllers;
+
+            SerialTask _serialTask;
+
+            State _state;
+
+            // Published after each update that runs a task
+            StateSnapshot _stateSnapshot;
+
+            Scheduler _scheduler;
+
+            void runClosedLoop(float time)
+            {
+                (void)time;
+
+                float demands[4] = {};
+
+                getDemands(_rx, demands);
+
+                _controllers.modifyDemands(&_state, demands, getModeIndex(_rx));
+
+                if (_state.armed) {
+                    _mixer.Mix::run(demands);
+                }
+                else {
+                    runDisarmed(_mixer);
+                }
+            }
+
+            void runReceiver(float time)
+            {
+                (void)time;
+
+                // Arming, failsafe, and receiver frames
+                checkOpenLoopController();
+            }
+
+            void runSerial(float time)
+            {
+                (void)time;
+
+                _serialTask.update();
+            }
+
+            void runBackground(float time)
+            {
+                _telemetry.sample(time, &_state, &_rx);
+
+                _blackbox.flush();
+            }
+
+            MethodTask<&ScheduledHackflight::runClosedLoop> _closedLoopTask = this;
+            MethodTask<&ScheduledHackflight::runReceiver> _receiverTask = this;
+            MethodTask<&ScheduledHackflight::runSerial> _serialUpdateTask = this;
+            MethodTask<&ScheduledHackflight::runBackground> _backgroundTask = this;
+
+        protected:
+
+            virtual bool safeStateForArming(void) override
+            {
+                return safeToArm(_state);
+            }
+
+        public:
+
+            // Closed loop defaults to RFT's rate; the receiver is checked faster than
+            // any receiver sends frames; telemetry samples at up to 1 kHz
+            ScheduledHackflight(rft::Board * board, Rx & rx, Mix & mixer, Controllers & controllers,
+                    float closedLoopFreq=300, float receiverFreq=200, float serialFreq=100,
+                    float backgroundFreq=1000, float tick=0.0001f)
+                : HackflightBase(&_state, board, &rx, &mixer),
+                  _rx(rx),
+                  _mixer(mixer),
+                  _controllers(controllers),
+                  _scheduler(tick)
+            {
+                _scheduler.add(_closedLoopTask, "ClosedLoop", closedLoopFreq, PRIORITY_CLOSED_LOOP);
+                _scheduler.add(_receiverTask, "ReceiverTask", receiverFreq, PRIORITY_RECEIVER);
+                _scheduler.add(_serialUpdateTask, "SerialTask", serialFreq, PRIORITY_BACKGROUND);
+                _scheduler.add(_backgroundTask, "Background", backgroundFreq, PRIORITY_BACKGROUND);
+            }
+
+            // Sensors due with the closed loop should usually run first, so give
+            // them a number below PRIORITY_CLOSED_LOOP
+            uint8_t addSensorTask(Task & task, const char * name, float freq, uint8_t priority)
+            {
+                return _scheduler.add(task, name, freq, priority);
+            }
+
+            void begin(bool armed=false)
+            {
+                beginRuntime(_state, _rx, armed, &_serialTask, &_stateSnapshot);
+
+                _controllers.addToBlackbox();
+
+                // Begins the sensors too
+                _scheduler.begin(_board->getTime());
+            }
+
+            void update(void)
+            {
+                if (_scheduler.update(&_state, _board->getTime())) {
+
+                    // A coherent copy of the state for other readers
+                    _stateSnapshot.write(_state);
+                }
+            }
+
+            Scheduler & scheduler(void)
+            {
+                return _scheduler;
+            }
+
+            // State as of the last loop, for readers on other threads, cores, or interrupts
+            const StateSnapshot & stateSnapshot(void)
+            {
+                return _stateSnapshot;
+            }
+
+    }; // class ScheduledHackflight
+
+} // namespace hf
@@ -0,0 +1,276 @@
+/*
+   Multi-rate task scheduler on a hashed timer wheel
+
+   Each task declares a frequency and a priority.  Time is counted in
+   ticks of a fixed length, and each task waits in the wheel slot for the
+   tick it is next due, so a tick costs one slot's worth of tasks rather
+   than a call to every task: a sensor is asked whether it has new data
+   only when it's due to have some.  Tasks due at the same update run in
+   priority order, lower numbers first.  Periods longer than the wheel
+   simply wait in their slot for the right revolution.
+
+   A task that runs a whole period or more after it was due has overrun:
+   the releases it missed are counted, and it is rescheduled from its
+   original phase.
+
+   A sensor's clock is not the board's, so its data drifts against any
+   fixed phase.  A task that follows its data returns false from run()
+   when none was ready, and is polled again on each tick until some is,
+   for up to half a period.  Its phase then locks to when the data came:
+   the next poll is a period later, or a tick sooner when the data was
+   already waiting, so that a sensor running fast is followed as well as
+   one running slow.  A task run late keeps its phase, and its overruns
+   are counted as before.  Each task is also a profiler stage, under its own name,
+   for execution time.
+
+   Time comes from the caller, so under SITL the wheel runs on the virtual
+   clock.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "state.hpp"
+#include "profiler.hpp"
+
+namespace hf {
+
+    class Task {
+
+        friend class Scheduler;
+
+        protected:
+
+            virtual void begin(void) { }
+
+            // Returns false when the data it follows wasn't ready yet
+            virtual bool run(State * state, float time) = 0;
+
+            // True to poll again on the next tick when run() returns false
+            virtual bool followsData(void) { return false; }
+
+    }; // class Task
+
+    class Scheduler {
+
+        public:
+
+            static const uint8_t MAXTASKS = 16;
+
+            static const uint8_t NONE = 0xFF;
+
+        private:
+
+            static const uint8_t NSLOTS = 64; // power of two
+
+            typedef struct {
+
+                Task * task;
+                const char * name;
+
+                uint32_t period;  // ticks
+                uint8_t priority;
+
+                uint32_t release; // tick the current period began
+                uint32_t due;     // tick
+                bool retried;     // polled more than once this period
+                uint8_t next;     // next task in the same slot
+
+                uint8_t profileStage;
+
+                uint32_t runs;
+                uint32_t overruns;
+                uint32_t maxLateness; // ticks
+
+            } entry_t;
+
+            entry_t _entries[MAXTASKS] = {};
+
+            uint8_t _ntasks = 0;
+
+            uint8_t _slots[NSLOTS] = {};
+
+            float _tick = 0;
+
+            uint32_t _now = 0; // last tick processed
+
+            uint32_t ticks(float time)
+            {
+                return (uint32_t)(time / _tick);
+            }
+
+            void insert(uint8_t index)
+            {
+                uint8_t slot = _entries[index].due & (NSLOTS-1);
+
+                _entries[index].next = _slots[slot];
+                _slots[slot] = index;
+            }
+
+            // Adds a task to the ready list, keeping it in priority order
+            void ready(uint8_t * list, uint8_t & count, uint8_t index)
+            {
+                uint8_t k = count++;
+
+                while (k > 0 && _entries[list[k-1]].priority > _entries[index].priority) {
+                    list[k] = list[k-1];
+                    --k;
+                }
+
+                list[k] = index;
+            }
+
+        public:
+
+            Scheduler(float tick=0.0001f)
+            {
+                _tick = tick;
+            }
+
+            // Returns the task's index, or NONE when the table is full
+            uint8_t add(Task & task, const char * name, float freq, uint8_t priority)
+            {
+                if (_ntasks == MAXTASKS) {
+                    return NONE;
+                }
+
+                entry_t * entry = &_entries[_ntasks];
+
+                uint32_t period = (uint32_t)(1 / (freq * _tick) + 0.5f);
+
+                entry->task = &task;
+                entry->name = name;
+                entry->period = period ? period : 1;
+                entry->priority = priority;
+                entry->profileStage = _profiler.addStage(name);
+
+                return _ntasks++;
+            }
+
+            // Every task comes due on the first update
+            void begin(float time)
+            {
+                for (uint8_t k=0; k<NSLOTS; ++k) {
+                    _slots[k] = NONE;
+                }
+
+                _now = ticks(time) - 1;
+
+                for (uint8_t k=0; k<_ntasks; ++k) {
+                    entry_t * entry = &_entries[k];
+                    entry->task->begin();
+                    entry->release = _now + 1;
+                    entry->due = _now + 1;
+                    entry->retried = false;
+                    entry->runs = 0;
+                    entry->overruns = 0;
+                    entry->maxLateness = 0;
+                    insert(k);
+                }
+            }
+
+            // Returns the number of tasks run
+            uint8_t update(State * state, float time)
+            {
+                uint32_t now = ticks(time);
+
+                uint32_t elapsed = now - _now;
+
+                if (elapsed == 0) {
+                    return 0;
+                }
+
+                uint8_t list[MAXTASKS] = {};
+                uint8_t count = 0;
+
+                // Unlink whatever is due from each slot we've passed, once round the wheel at most
+                for (uint32_t k=1; k<=elapsed && k<=NSLOTS; ++k) {
+
+                    uint8_t * link = &_slots[(_now + k) & (NSLOTS-1)];
+
+                    while (*link != NONE) {
+                        uint8_t index = *link;
+                        if ((int32_t)(now - _entries[index].due) >= 0) {
+                            *link = _entries[index].next;
+                            ready(list, count, index);
+                        }
+                        else {
+                            link = &_entries[index].next;
+                        }
+                    }
+                }
+
+                _now = now;
+
+                for (uint8_t k=0; k<count; ++k) {
+
+                    entry_t * entry = &_entries[list[k]];
+
+                    bool done = false;
+
+                    {
+                        ProfileTimer timer(entry->profileStage);
+                        done = entry->task->run(state, time);
+                    }
+
+                    uint32_t lateness = now - entry->due;
+
+                    entry->maxLateness = lateness > entry->maxLateness ? lateness : entry->maxLateness;
+
+                    // Data not in yet: try again next tick, for up to half a period
+                    if (!done && entry->task->followsData() && (int32_t)(now + 1 - entry->release) <= (int32_t)(entry->period / 2)) {
+                        entry->due = now + 1;
+                        entry->retried = true;
+                        insert(list[k]);
+                        continue;
+                    }
+
+                    // A tick early is not late
+                    uint32_t missed = (int32_t)(now - entry->release) > 0 ? (now - entry->release) / entry->period : 0;
+
+                    entry->runs++;
+                    entry->overruns += missed;
+
+                    // Polled on time and got data: lock to it, and poll a tick
+                    // early next time unless we know it has only just come
+                    if (done && lateness == 0 && entry->task->followsData()) {
+                        entry->release = now + entry->period;
+                        entry->due = entry->retried || entry->period == 1 ? entry->release : entry->release - 1;
+                    }
+                    else {
+                        entry->release += entry->period * (missed + 1);
+                        entry->due = entry->release;
+                    }
+
+                    entry->retried = false;
+
+                    insert(list[k]);
+                }
+
+                return count;
+            }
+
+            uint8_t taskCount(void)
+            {
+                return _ntasks;
+            }
+
+            // Runs, missed releases, and the latest any run has been, in seconds
+            void getStats(uint8_t index, const char * & name, uint32_t & runs, uint32_t & overruns, float & maxLateness)
+            {
+                const entry_t * entry = &_entries[index < _ntasks ? index : 0];
+
+                name = entry->name;
+                runs = entry->runs;
+                overruns = entry->overruns;
+                maxLateness = entry->maxLateness * _tick;
+            }
+
+    }; // class Scheduler
+
+} // namespace hf
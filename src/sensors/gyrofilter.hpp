@@ -0,0 +1,241 @@
+/*
+   Gyro filter bank
+
+   A cascade of up to MAXSTAGES low-pass and notch filters applied to the
+   three gyro rates.  Each stage is stored as a biquad (a PT1 is one with
+   the second-order terms zero), so one kernel runs them all: Direct Form
+   II Transposed, with the filter state laid out axis-innermost and padded
+   to four lanes, so that the inner loop over axes is a straight run of
+   multiply-adds the compiler can put in vector registers.
+
+   Stages are added before begin(), which computes the coefficients for
+   the sample rate (RBJ audio-EQ cookbook for the biquads), so a sample
+   costs no trigonometry.  With no stages, apply() does nothing.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace hf {
+
+    class GyroFilter {
+
+        public:
+
+            static const uint8_t MAXSTAGES = 6;
+
+            // Axes, padded to a vector's width
+            static const uint8_t LANES = 4;
+
+            // Highest cutoff or center we allow, as a fraction of the sample rate
+            static constexpr float MAX_FRACTION = 0.45f;
+
+        private:
+
+            typedef enum {
+
+                PT1,
+                LOWPASS,
+                NOTCH
+
+            } type_t;
+
+            typedef struct {
+
+                type_t type;
+                float freq;
+                float q;
+
+            } stage_t;
+
+            typedef struct {
+
+                float b0;
+                float b1;
+                float b2;
+                float a1;
+                float a2;
+
+            } coeffs_t;
+
+            stage_t _stages[MAXSTAGES] = {};
+
+            uint8_t _nstages = 0;
+
+            float _rate = 0;
+
+            coeffs_t _coeffs[MAXSTAGES] = {};
+
+            alignas(16) float _z1[MAXSTAGES][LANES] = {};
+            alignas(16) float _z2[MAXSTAGES][LANES] = {};
+
+            bool add(type_t type, float freq, float q)
+            {
+                if (_nstages == MAXSTAGES) {
+                    return false;
+                }
+
+                stage_t * stage = &_stages[_nstages++];
+
+                stage->type = type;
+                stage->freq = freq;
+                stage->q = q;
+
+                return true;
+            }
+
+            static coeffs_t design(const stage_t & stage, float rate)
+            {
+                coeffs_t c = {};
+
+                float freq = stage.freq < MAX_FRACTION * rate ? stage.freq : MAX_FRACTION * rate;
+
+                float omega = 2 * (float)M_PI * freq / rate;
+
+                if (stage.type == PT1) {
+
+                    // y += k (x - y), with the RC time constant of the cutoff
+                    float rc = 1 / (2 * (float)M_PI * freq);
+                    float k = (1 / rate) / (rc + 1 / rate);
+
+                    c.b0 = k;
+                    c.a1 = k - 1;
+
+                    return c;
+                }
+
+                float sn = sinf(omega);
+                float cs = cosf(omega);
+                float alpha = sn / (2 * stage.q);
+                float a0 = 1 + alpha;
+
+                if (stage.type == LOWPASS) {
+                    c.b0 = (1 - cs) / 2 / a0;
+                    c.b1 = (1 - cs) / a0;
+                    c.b2 = c.b0;
+                }
+
+                else {
+                    c.b0 = 1 / a0;
+                    c.b1 = -2 * cs / a0;
+                    c.b2 = c.b0;
+                }
+
+                c.a1 = -2 * cs / a0;
+                c.a2 = (1 - alpha) / a0;
+
+                return c;
+            }
+
+        public:
+
+            // Each returns false, adding nothing, when the bank is full
+
+            // First order, -3 dB at cutoff
+            bool addPt1(float cutoffHz)
+            {
+                return add(PT1, cutoffHz, 0);
+            }
+
+            // Second order; the default Q is Butterworth
+            bool addLowpass(float cutoffHz, float q=0.7071f)
+            {
+                return add(LOWPASS, cutoffHz, q);
+            }
+
+            // Stop band of about centerHz / q wide
+            bool addNotch(float centerHz, float q)
+            {
+                return add(NOTCH, centerHz, q);
+            }
+
+            uint8_t stageCount(void)
+            {
+                return _nstages;
+            }
+
+            // Computes the coefficients and clears the filter state
+            void begin(float sampleRate)
+            {
+                _rate = sampleRate;
+
+                for (uint8_t s=0; s<_nstages; ++s) {
+
+                    _coeffs[s] = design(_stages[s], sampleRate);
+
+                    for (uint8_t k=0; k<LANES; ++k) {
+                        _z1[s][k] = 0;
+                        _z2[s][k] = 0;
+                    }
+                }
+            }
+
+            // Filters roll, pitch, and yaw rates in place
+            void apply(float rates[3])
+            {
+                alignas(16) float x[LANES] = {rates[0], rates[1], rates[2], 0};
+
+                for (uint8_t s=0; s<_nstages; ++s) {
+
+                    const coeffs_t c = _coeffs[s];
+
+                    float * z1 = _z1[s];
+                    float * z2 = _z2[s];
+
+                    // One statement at a time across the lanes, so each is a vector op
+                    alignas(16) float y[LANES];
+
+                    for (uint8_t k=0; k<LANES; ++k) {
+                        y[k] = c.b0 * x[k] + z1[k];
+                    }
+
+                    for (uint8_t k=0; k<LANES; ++k) {
+                        z1[k] = c.b1 * x[k] - c.a1 * y[k] + z2[k];
+                    }
+
+                    for (uint8_t k=0; k<LANES; ++k) {
+                        z2[k] = c.b2 * x[k] - c.a2 * y[k];
+                        x[k] = y[k];
+                    }
+                }
+
+                rates[0] = x[0];
+                rates[1] = x[1];
+                rates[2] = x[2];
+            }
+
+            // Gain of the whole bank at a frequency, from the coefficients; after begin()
+            float response(float freq)
+            {
+                float omega = 2 * (float)M_PI * freq / _rate;
+
+                // e^-jw and e^-2jw
+                float c1 = cosf(omega), s1 = -sinf(omega);
+                float c2 = cosf(2 * omega), s2 = -sinf(2 * omega);
+
+                float gain = 1;
+
+                for (uint8_t s=0; s<_nstages; ++s) {
+
+                    const coeffs_t & c = _coeffs[s];
+
+                    float nr = c.b0 + c.b1 * c1 + c.b2 * c2;
+                    float ni = c.b1 * s1 + c.b2 * s2;
+                    float dr = 1 + c.a1 * c1 + c.a2 * c2;
+                    float di = c.a1 * s1 + c.a2 * s2;
+
+                    gain *= sqrtf((nr * nr + ni * ni) / (dr * dr + di * di));
+                }
+
+                return gain;
+            }
+
+    }; // class GyroFilter
+
+} // namespace hf
@@ -0,0 +1,177 @@
+/*
+   Attitude propagator
+
+   Hardware quaternions arrive several times more slowly than gyro samples
+   (USFSMAX: gyro 834 Hz, quaternion 104 Hz; USFS: quaternion at 1/5 gyro
+   rate).  Between quaternions we integrate the gyro rates through the
+   Euler-angle kinematics, so the attitude in the state is refreshed at
+   gyro rate; each new quaternion replaces the propagated attitude.
+
+   To keep the per-sample cost to a few multiply-adds, the kinematic
+   coefficients (which depend on roll and pitch) are computed once per
+   quaternion, when the attitude is corrected.
+
+   Quaternion sensors that leave the Euler angles to State::updateEuler()
+   correct with the quaternion instead; it is then integrated directly,
+   with a first-order renormalization, so there is no trigonometry at
+   either rate.
+
+   The gyrometers propagate only when constructed with propagateAttitude
+   true; extras/sitl/propagate.cpp checks the result against the next
+   quaternion.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "state.hpp"
+
+namespace hf {
+
+    class AttitudePropagator {
+
+        private:
+
+            // Keeps 1/cos(theta) bounded near +/-90 degrees pitch
+            static constexpr float MIN_COS_THETA = 0.1f;
+
+            float _phi = 0;
+            float _theta = 0;
+            float _psi = 0;
+
+            // Heading is kept in [_psiMin, _psiMin + 2*pi)
+            float _psiMin = 0;
+
+            // Kinematic coefficients
+            float _sinPhi = 0;
+            float _cosPhi = 1;
+            float _tanTheta = 0;
+            float _secTheta = 1;
+
+            // Quaternion w, x, y, z, when correcting with one
+            float _q[4] = {};
+
+            bool _quaternion = false;
+
+            float _time = 0;
+
+            bool _corrected = false;
+
+            void propagateEuler(float dphi, float dtheta, float dpsi, float dt, State * state)
+            {
+                float a = dtheta * _sinPhi + dpsi * _cosPhi;
+
+                _phi   += (dphi + a * _tanTheta) * dt;
+                _theta += (dtheta * _cosPhi - dpsi * _sinPhi) * dt;
+                _psi   += a * _secTheta * dt;
+
+                if (_psi >= _psiMin + 2*(float)M_PI) {
+                    _psi -= 2*(float)M_PI;
+                }
+
+                if (_psi < _psiMin) {
+                    _psi += 2*(float)M_PI;
+                }
+
+                state->x[State::PHI] = _phi;
+                state->x[State::THETA] = _theta;
+                state->x[State::PSI] = _psi;
+            }
+
+            // q += q * (0, p, q, r) * dt/2, then one Newton step toward unit norm
+            void propagateQuaternion(float dphi, float dtheta, float dpsi, float dt, State * state)
+            {
+                float h = dt / 2;
+
+                float qw = _q[0], qx = _q[1], qy = _q[2], qz = _q[3];
+
+                _q[0] += (-qx*dphi - qy*dtheta - qz*dpsi) * h;
+                _q[1] += ( qw*dphi + qy*dpsi - qz*dtheta) * h;
+                _q[2] += ( qw*dtheta + qz*dphi - qx*dpsi) * h;
+                _q[3] += ( qw*dpsi + qx*dtheta - qy*dphi) * h;
+
+                float n2 = _q[0]*_q[0] + _q[1]*_q[1] + _q[2]*_q[2] + _q[3]*_q[3];
+                float scale = (3 - n2) / 2;
+
+                for (uint8_t k=0; k<4; ++k) {
+                    _q[k] *= scale;
+                }
+
+                state->setQuaternion(_q, _psiMin);
+            }
+
+        public:
+
+            AttitudePropagator(float psiMin)
+            {
+                _psiMin = psiMin;
+            }
+
+            // Call with each new attitude from the quaternion
+            void correct(float phi, float theta, float psi, float time)
+            {
+                _quaternion = false;
+
+                _phi = phi;
+                _theta = theta;
+                _psi = psi;
+
+                _sinPhi = sinf(phi);
+                _cosPhi = cosf(phi);
+
+                float cosTheta = cosf(theta);
+                if (fabsf(cosTheta) < MIN_COS_THETA) {
+                    cosTheta = cosTheta < 0 ? -MIN_COS_THETA : MIN_COS_THETA;
+                }
+
+                _secTheta = 1 / cosTheta;
+                _tanTheta = sinf(theta) * _secTheta;
+
+                _time = time;
+
+                _corrected = true;
+            }
+
+            // Call with each new quaternion, when not converting it to Euler angles
+            void correct(const float * q, float time)
+            {
+                for (uint8_t k=0; k<4; ++k) {
+                    _q[k] = q[k];
+                }
+
+                _quaternion = true;
+
+                _time = time;
+
+                _corrected = true;
+            }
+
+            // Call with each new gyro sample (rad/sec); updates the attitude in the
+            // state the way it was last corrected; returns false until the first correction
+            bool propagate(float dphi, float dtheta, float dpsi, float time, State * state)
+            {
+                if (!_corrected) {
+                    return false;
+                }
+
+                float dt = time - _time;
+                _time = time;
+
+                if (_quaternion) {
+                    propagateQuaternion(dphi, dtheta, dpsi, dt, state);
+                }
+                else {
+                    propagateEuler(dphi, dtheta, dpsi, dt, state);
+                }
+
+                return true;
+            }
+
+    }; // class AttitudePropagator
+
+} // namespace hf
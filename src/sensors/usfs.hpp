@@ -13,6 +13,11 @@
 #include <USFS_Master.h>
 #include <RFT_sensor.hpp>
 
+#include "profiler.hpp"
+#include "eulermath.hpp"
+#include "sensors/propagator.hpp"
+#include "sensors/usfs_frame.hpp"
+
 namespace hf {
 
     /*
@@ -29,7 +34,8 @@ namespace hf {
 
     class USFS {
         /**
-          Singleton class for UsfsGyrometer, UsfsQuaternion below
+          One per physical IMU, shared by the UsfsGyrometer and
+          UsfsQuaternion below
           */
 
         friend class Hackflight;
@@ -47,6 +53,9 @@ namespace hf {
 
         bool _begun = false;
 
+        // Fills in attitude between quaternions; heading is in [0,2*pi]
+        AttitudePropagator _propagator = AttitudePropagator(0);
+
         void checkEventStatus(void)
         {
             _sentral.checkEventStatus();
@@ -78,11 +87,6 @@ namespace hf {
                 // Returns degrees / sec
                 _sentral.readGyrometer(gx, gy, gz);
 
-                // Convert degrees / sec to radians / sec
-                gx = radians(gx);
-                gy = radians(gy);
-                gz = radians(gz);
-
                 return true;
             }
 
@@ -120,12 +124,10 @@ namespace hf {
 
     }; // class USFS
 
-    // Singleton
-    static USFS _usfs;
-
     class UsfsGyrometer : public rft::Sensor {
 
         friend class Hackflight;
+        template <typename...> friend class SensorList;
 
         private:
 
@@ -133,7 +135,12 @@ namespace hf {
         float _y = 0;
         float _z = 0;
 
-        USFS * _imu = &_usfs;
+        USFS * _imu = NULL;
+
+        uint8_t _readyStage = _profiler.addStage("UsfsGyrometer.ready");
+        uint8_t _modifyStage = _profiler.addStage("UsfsGyrometer.modifyState");
+
+        bool _propagateAttitude = false;
 
         protected:
 
@@ -145,20 +152,33 @@ namespace hf {
 
         virtual void modifyState(rft::State * state, float time) override
         {
-            (void)time;
+            ProfileTimer timer(_modifyStage);
 
             State * hfstate = (State *)state;
 
-            // NB: We negate gyro Y, Z to simplify PID controller
-            hfstate->x[State::DPHI] = _x;
-            hfstate->x[State::DTHETA] = _y;
-            hfstate->x[State::DPSI] = _z;
+            float gyro[3] = {_x, _y, _z};
+
+            float rates[3] = {};
+            UsfsFrame::controllerRates(gyro, rates);
+
+            hfstate->x[State::DPHI] = rates[0];
+            hfstate->x[State::DTHETA] = rates[1];
+            hfstate->x[State::DPSI] = rates[2];
+
+            // Refresh attitude at gyro rate
+            if (_propagateAttitude) {
+                float body[3] = {};
+                UsfsFrame::bodyRates(gyro, body);
+                _imu->_propagator.propagate(body[0], body[1], body[2], time, hfstate);
+            }
         }
 
         virtual bool ready(float time) override
         {
             (void)time;
 
+            ProfileTimer timer(_readyStage);
+
             bool result = _imu->getGyrometer(_x, _y, _z);
 
             return result;
@@ -166,11 +186,17 @@ namespace hf {
 
         public:
 
-        UsfsGyrometer(void)
+        // With propagateAttitude true, the attitude is integrated from the gyro
+        // between quaternions (see extras/sitl/propagate.cpp)
+        UsfsGyrometer(USFS & imu, bool propagateAttitude=false)
         {
+            _imu = &imu;
+
             _x = 0;
             _y = 0;
             _z = 0;
+
+            _propagateAttitude = propagateAttitude;
         }
 
     };  // class Gyrometer
@@ -178,6 +204,7 @@ namespace hf {
     class UsfsQuaternion : public rft::Sensor {
 
         friend class Hackflight;
+        template <typename...> friend class SensorList;
 
         private:
 
@@ -186,7 +213,12 @@ namespace hf {
         float _y = 0;
         float _z = 0;
 
-        USFS * _imu = &_usfs;
+        USFS * _imu = NULL;
+
+        bool _eulerAngles = true;
+
+        uint8_t _readyStage = _profiler.addStage("UsfsQuaternion.ready");
+        uint8_t _modifyStage = _profiler.addStage("UsfsQuaternion.modifyState");
 
         protected:
 
@@ -197,46 +229,57 @@ namespace hf {
 
         virtual void modifyState(rft::State * state, float time) override
         {
-            (void)time;
+            ProfileTimer timer(_modifyStage);
 
             State * hfstate = (State *)state;
 
-            float qw = _w, qx = _x, qy = _y, qz = _z;
-
-            computeEulerAngles(qw, qx, qy, qz, 
-                    hfstate->x[State::PHI], hfstate->x[State::THETA], hfstate->x[State::PSI]);
+            // Heading in [0,2*pi]
+            float sensorq[4] = {_w, _x, _y, _z};
+            float q[4] = {};
+            UsfsFrame::quaternion(sensorq, q);
+            hfstate->setQuaternion(q, 0);
 
-            // Adjust rotation so that nose-up is positive
-            hfstate->x[State::THETA] = -hfstate->x[State::THETA];
-
-            // Convert heading from [-pi,+pi] to [0,2*pi]
-            if (hfstate->x[State::PSI] < 0) {
-                hfstate->x[State::PSI] += 2*M_PI;
+            if (_eulerAngles) {
+                hfstate->updateEuler();
+                _imu->_propagator.correct(hfstate->x[State::PHI], hfstate->x[State::THETA], hfstate->x[State::PSI], time);
+            }
+            else {
+                _imu->_propagator.correct(q, time);
             }
         }
 
         virtual bool ready(float time) override
         {
+            ProfileTimer timer(_readyStage);
+
             return _imu->getQuaternion(_w, _x, _y, _z, time);
         }
 
         public:
 
-        UsfsQuaternion(void)
+        // With eulerAngles false, only the quaternion in the state is kept current,
+        // for QuaternionLevelPid; Euler angles are then converted on demand
+        UsfsQuaternion(USFS & imu, bool eulerAngles=true)
         {
+            _imu = &imu;
+            _eulerAngles = eulerAngles;
+
             _w = 0;
             _x = 0;
             _y = 0;
             _z = 0;
         }
 
-        // We make this public so we can use it in different sketches
+        // We make this public so we can use it in different sketches; note
+        // that ey is positive nose down
         static void computeEulerAngles(float qw, float qx, float qy, float qz,
                 float & ex, float & ey, float & ez)
         {
-            ex = atan2(2.0f*(qw*qx+qy*qz), qw*qw-qx*qx-qy*qy+qz*qz);
-            ey = asin(2.0f*(qx*qz-qw*qy));
-            ez = atan2(2.0f*(qx*qy+qw*qz), qw*qw+qx*qx-qy*qy-qz*qz);
+            float q[4] = {qw, qx, qy, qz};
+
+            EulerMath::fromQuaternion(q, ex, ey, ez);
+
+            ey = -ey;
         }
 
     };  // class Quaternion
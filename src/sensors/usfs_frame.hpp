@@ -0,0 +1,62 @@
+/*
+   USFS sensor frame to Hackflight frame
+
+   The SENtral fuses its own gyro, so its quaternion is the attitude of the
+   gyro's axes, and Hackflight takes both as they are: the quaternion's
+   Z-Y-X Euler angles already have nose-up pitch positive, and the body
+   rates that move the attitude are the gyro rates.  The rate controllers
+   were tuned with the gyro rates too, so here, unlike with the USFSMAX,
+   the two sets of rates are the same.
+
+   Kept apart from usfs.hpp, which needs the Arduino USFS library, so that
+   the conversions can be checked on the host.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+
+namespace hf {
+
+    class UsfsFrame {
+
+        private:
+
+            static float toRadians(float degrees)
+            {
+                return degrees * (float)M_PI / 180;
+            }
+
+        public:
+
+            // Sensor quaternion w, x, y, z to ours
+            static void quaternion(const float q[4], float hfq[4])
+            {
+                hfq[0] = q[0];
+                hfq[1] = q[1];
+                hfq[2] = q[2];
+                hfq[3] = q[3];
+            }
+
+            // Gyro (degrees / sec) to body rates (radians / sec) in the frame of
+            // quaternion(), for propagating the attitude
+            static void bodyRates(const float gyro[3], float rates[3])
+            {
+                rates[0] = toRadians(gyro[0]);
+                rates[1] = toRadians(gyro[1]);
+                rates[2] = toRadians(gyro[2]);
+            }
+
+            // Gyro (degrees / sec) to DPHI, DTHETA, DPSI for the rate controllers
+            static void controllerRates(const float gyro[3], float rates[3])
+            {
+                bodyRates(gyro, rates);
+            }
+
+    }; // class UsfsFrame
+
+} // namespace hf
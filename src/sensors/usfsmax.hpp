@@ -13,10 +13,15 @@
 #include <RFT_debugger.hpp>
 #include <RFT_sensor.hpp>
 
+#include "profiler.hpp"
+#include "sensors/propagator.hpp"
+#include "sensors/gyrofilter.hpp"
+#include "sensors/usfsmax_frame.hpp"
+
 namespace hf {
 
-    // Singleton class
-    class _USFSMAX {
+    // One per physical IMU, shared by the UsfsMaxQuaternion and UsfsMaxGyrometer below
+    class UsfsMax {
 
         friend class UsfsMaxQuaternion;
         friend class UsfsMaxGyrometer;
@@ -40,6 +45,7 @@ namespace hf {
         // Output Data Rates (ODRs)
         static const USFSMAX::AccelGyroODR_t ACCEL_ODR = USFSMAX::ACCEL_GYRO_ODR_834;
         static const USFSMAX::AccelGyroODR_t GYRO_ODR  = USFSMAX::ACCEL_GYRO_ODR_834;
+        static constexpr float GYRO_RATE = 834; // Hz, to match GYRO_ODR
         static const USFSMAX::MagODR_t       MAG_ODR   = USFSMAX::MAG_ODR_100;
         static const USFSMAX::BaroODR_t      BARO_ODR  = USFSMAX::BARO_ODR_50;
         static const USFSMAX::QuatDiv_t      QUAT_DIV  = USFSMAX::QUAT_DIV_8;
@@ -60,6 +66,9 @@ namespace hf {
 
         bool _begun = false;
 
+        // Fills in attitude between quaternions
+        AttitudePropagator _propagator = AttitudePropagator(-M_PI);
+
         static void error(uint8_t status)
         {
             while (true) {
@@ -138,80 +147,151 @@ namespace hf {
             usfsmax.readQuat(quat);
         }
 
-    }; // class _USFS
-
-    static _USFSMAX  _usfsmax;
+    }; // class UsfsMax
 
     class UsfsMaxQuaternion : public rft::Sensor {
 
+        template <typename...> friend class SensorList;
+
+        private:
+
+            UsfsMax * _imu = NULL;
+
+            bool _eulerAngles = true;
+
+            uint8_t _readyStage = _profiler.addStage("UsfsMaxQuaternion.ready");
+            uint8_t _modifyStage = _profiler.addStage("UsfsMaxQuaternion.modifyState");
+
         protected:
 
             virtual void begin(void) override 
             {
-                _usfsmax.begin();
+                _imu->begin();
             }
 
             virtual void modifyState(rft::State * state, float time) override
             {
-                (void)time;
+                ProfileTimer timer(_modifyStage);
 
                 float q[4] = {};
-                _usfsmax.readQuaternion(q);
+                _imu->readQuaternion(q);
 
-                float qw = q[0];
-                float qx = q[1];
-                float qy = q[2];
-                float qz = q[3];
-
-                float ex = -atan2(2.0f*(qw*qx+qy*qz),qw*qw-qx*qx-qy*qy+qz*qz);
-                float ey = -asin(2.0f*(qx*qz-qw*qy));
-                float ez = -atan2(2.0f*(qx*qy+qw*qz),qw*qw+qx*qx-qy*qy-qz*qz);
+                float hfq[4] = {};
+                UsfsMaxFrame::quaternion(q, hfq);
 
                 State * hfstate = (State *)state;
 
-                hfstate->x[State::PHI] = ex;
-                hfstate->x[State::THETA] = ey;
-                hfstate->x[State::PSI] = ez;
+                hfstate->setQuaternion(hfq, -M_PI);
+
+                if (_eulerAngles) {
+                    hfstate->updateEuler();
+                    _imu->_propagator.correct(
+                            hfstate->x[State::PHI], hfstate->x[State::THETA], hfstate->x[State::PSI], time);
+                }
+                else {
+                    _imu->_propagator.correct(hfq, time);
+                }
             }
 
             virtual bool ready(float time) override
             {
                 (void)time;
 
-                return _usfsmax.quaternionReady();
+                ProfileTimer timer(_readyStage);
+
+                return _imu->quaternionReady();
+            }
+
+        public:
+
+            // With eulerAngles false, only the quaternion in the state is kept current,
+            // for QuaternionLevelPid; Euler angles are then converted on demand
+            UsfsMaxQuaternion(UsfsMax & imu, bool eulerAngles=true)
+            {
+                _imu = &imu;
+                _eulerAngles = eulerAngles;
             }
 
     }; // class UsfsQuat
 
     class UsfsMaxGyrometer : public rft::Sensor {
 
+        template <typename...> friend class SensorList;
+
+        private:
+
+            UsfsMax * _imu = NULL;
+
+            uint8_t _readyStage = _profiler.addStage("UsfsMaxGyrometer.ready");
+            uint8_t _modifyStage = _profiler.addStage("UsfsMaxGyrometer.modifyState");
+
+            bool _propagateAttitude = false;
+
+            GyroFilter _filter;
+
         protected:
 
             virtual void begin(void) override 
             {
-                _usfsmax.begin();
+                _imu->begin();
+
+                _filter.begin(UsfsMax::GYRO_RATE);
             }
 
             virtual void modifyState(rft::State * state, float time) override
             {
-                (void)time;
+                ProfileTimer timer(_modifyStage);
 
                 float gyro[3] = {};
-                _usfsmax.readGyro(gyro);
+                _imu->readGyro(gyro);
 
                 State * hfstate = (State *)state;
 
-                // Convert degrees / sec to radians / sec
-                hfstate->x[State::DPHI] = -radians(gyro[0]);
-                hfstate->x[State::DTHETA] = radians(gyro[1]);
-                hfstate->x[State::DPSI] = radians(gyro[2]);
+                // Refresh attitude at gyro rate; integrating is filter enough, and
+                // unfiltered rates add no lag
+                if (_propagateAttitude) {
+                    float body[3] = {};
+                    UsfsMaxFrame::bodyRates(gyro, body);
+                    _imu->_propagator.propagate(body[0], body[1], body[2], time, hfstate);
+                }
+
+                float rates[3] = {};
+                UsfsMaxFrame::controllerRates(gyro, rates);
+
+                // Rate controllers get the filtered rates
+                _filter.apply(rates);
+
+                hfstate->x[State::DPHI] = rates[0];
+                hfstate->x[State::DTHETA] = rates[1];
+                hfstate->x[State::DPSI] = rates[2];
             }
 
             virtual bool ready(float time) override
             {
                 (void)time;
 
-                return _usfsmax.gyroReady();
+                ProfileTimer timer(_readyStage);
+
+                return _imu->gyroReady();
+            }
+
+        public:
+
+            // With propagateAttitude true, the attitude is integrated from the gyro
+            // between quaternions (see extras/sitl/propagate.cpp)
+            UsfsMaxGyrometer(UsfsMax & imu, bool propagateAttitude=false)
+            {
+                _imu = &imu;
+                _propagateAttitude = propagateAttitude;
+            }
+
+            // Empty (no filtering) unless stages are added before begin(), e.g.
+            //
+            //   gyrometer.filter().addLowpass(150);
+            //   gyrometer.filter().addNotch(220, 3);
+            GyroFilter & filter(void)
+            {
+                return _filter;
             }
 
     }; // class UsfsGyro
@@ -0,0 +1,63 @@
+/*
+   USFSMAX sensor frame to Hackflight frame
+
+   Hackflight's frame is the USFSMAX's rotated a half turn about Y, which
+   negates the X and Z components of the quaternion and of the body rates.
+   The rate controllers, though, were tuned with yaw rate taken straight
+   from the gyro, opposite in sign to the change of heading; so the rates
+   for the controllers and the rates that move the attitude differ in Z.
+
+   Kept apart from usfsmax.hpp, which needs the Arduino USFSMAX library,
+   so that the conversions can be checked on the host.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <math.h>
+
+namespace hf {
+
+    class UsfsMaxFrame {
+
+        private:
+
+            static float toRadians(float degrees)
+            {
+                return degrees * (float)M_PI / 180;
+            }
+
+        public:
+
+            // Sensor quaternion w, x, y, z to ours
+            static void quaternion(const float q[4], float hfq[4])
+            {
+                hfq[0] = q[0];
+                hfq[1] = -q[1];
+                hfq[2] = q[2];
+                hfq[3] = -q[3];
+            }
+
+            // Gyro (degrees / sec) to body rates (radians / sec) in the frame of
+            // quaternion(), for propagating the attitude
+            static void bodyRates(const float gyro[3], float rates[3])
+            {
+                rates[0] = -toRadians(gyro[0]);
+                rates[1] = toRadians(gyro[1]);
+                rates[2] = -toRadians(gyro[2]);
+            }
+
+            // Gyro (degrees / sec) to DPHI, DTHETA, DPSI for the rate controllers
+            static void controllerRates(const float gyro[3], float rates[3])
+            {
+                rates[0] = -toRadians(gyro[0]);
+                rates[1] = toRadians(gyro[1]);
+                rates[2] = toRadians(gyro[2]);
+            }
+
+    }; // class UsfsMaxFrame
+
+} // namespace hf
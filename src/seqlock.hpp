@@ -0,0 +1,133 @@
+/*
+   Sequence-locked double buffer: one writer publishes a value, any number
+   of readers copy it
+
+   The writer never waits: each write goes into the buffer readers aren't
+   being sent to, bracketed by that buffer's sequence number going odd and
+   back to even, and then the count of writes is bumped to send readers
+   there.  A reader copies the newest buffer between two reads of its
+   sequence number, and keeps the copy only if the number was even and
+   unchanged.  So a reader never waits for a write in progress; a copy is
+   thrown away only if the writer finished one write and started the next
+   while it was being taken, which at one write per flight loop means the
+   reader was interrupted mid-copy.
+
+   The buffers are held as 32-bit atomic words, so that a copy that is
+   thrown away is not a data race; on a 32-bit MCU these are plain loads
+   and stores.  T must be trivially copyable.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+namespace hf {
+
+    template <typename T>
+    class Seqlock {
+
+        private:
+
+            static const uint16_t NWORDS = (sizeof(T) + 3) / 4;
+
+            typedef struct {
+
+                std::atomic<uint32_t> sequence;
+                std::atomic<uint32_t> words[NWORDS];
+
+            } buffer_t;
+
+            // Writes so far; the newest is in _buffers[_count & 1]
+            std::atomic<uint32_t> _count = {0};
+
+            buffer_t _buffers[2];
+
+        public:
+
+            Seqlock(void)
+            {
+                for (uint8_t j=0; j<2; ++j) {
+
+                    _buffers[j].sequence.store(0, std::memory_order_relaxed);
+
+                    for (uint16_t k=0; k<NWORDS; ++k) {
+                        _buffers[j].words[k].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Writer side; one writer only
+            void write(const T & value)
+            {
+                uint32_t words[NWORDS] = {};
+                memcpy(words, &value, sizeof(T));
+
+                uint32_t count = _count.load(std::memory_order_relaxed);
+
+                buffer_t * buffer = &_buffers[(count + 1) & 1];
+
+                uint32_t sequence = buffer->sequence.load(std::memory_order_relaxed);
+
+                buffer->sequence.store(sequence + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                for (uint16_t k=0; k<NWORDS; ++k) {
+                    buffer->words[k].store(words[k], std::memory_order_relaxed);
+                }
+
+                buffer->sequence.store(sequence + 2, std::memory_order_release);
+
+                _count.store(count + 1, std::memory_order_release);
+            }
+
+            // Reader side; returns false, leaving value alone, if the writer
+            // got round to the buffer being copied
+            bool tryRead(T & value) const
+            {
+                const buffer_t * buffer = &_buffers[_count.load(std::memory_order_acquire) & 1];
+
+                uint32_t sequence = buffer->sequence.load(std::memory_order_acquire);
+
+                if (sequence & 1) {
+                    return false;
+                }
+
+                uint32_t words[NWORDS];
+
+                for (uint16_t k=0; k<NWORDS; ++k) {
+                    words[k] = buffer->words[k].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (buffer->sequence.load(std::memory_order_relaxed) != sequence) {
+                    return false;
+                }
+
+                memcpy(&value, words, sizeof(T));
+
+                return true;
+            }
+
+            // Reader side; tries again, on the newer buffer, until a copy is coherent
+            void read(T & value) const
+            {
+                while (!tryRead(value)) {
+                }
+            }
+
+            // Writes so far
+            uint32_t count(void) const
+            {
+                return _count.load(std::memory_order_acquire);
+            }
+
+    }; // class Seqlock
+
+} // namespace hf
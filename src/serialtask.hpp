@@ -1,6 +1,10 @@
 /*
    Timer task for serial comms
 
+   Message layouts and the dispatch table are generated from
+   extras/parser/messages.json into mspmessages.hpp; this class supplies
+   the handlers.
+
    MIT License
  */
 
@@ -14,6 +18,10 @@
 #include <rft_timertasks/serialtask.hpp>
 
 #include "actuators/mixer.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "mspmessages.hpp"
+#include "statesnapshot.hpp"
 
 namespace hf {
 
@@ -21,111 +29,162 @@ namespace hf {
     class SerialTask : public rft::SerialTask {
 
         friend class Hackflight;
+        friend class HackflightBase;
+        template <typename> friend class msp::Dispatcher;
 
         private:
 
-        void handle_RECEIVER_Request(float & c1, float & c2, float & c3, float & c4, float & c5, float & c6)
+        // Stage whose profile we report; set by the GCS
+        uint8_t _profileStage = 0;
+
+        // State as of the last complete loop, if the loop publishes one
+        const StateSnapshot * _stateSnapshot = NULL;
+
+        // The flight loop's profiler, which on the host may be another thread's
+        Profiler * _loopProfiler = NULL;
+
+        void sendBytes(uint8_t id, const uint8_t * bytes, uint8_t size)
+        {
+            _command = id;
+            prepareToSendBytes(size);
+            for (uint8_t k=0; k<size; ++k) {
+                sendByte(bytes[k]);
+            }
+            serialize8(_checksum);
+        }
+
+        template <typename Message>
+        void sendMessage(const Message & message)
+        {
+            sendBytes(Message::ID, (const uint8_t *)&message, sizeof(Message));
+        }
+
+        void handle_RC_NORMAL_Request(msp::RC_NORMAL & message)
         {
             Receiver * receiver = (Receiver *)_olc;
 
-            c1 = receiver->getRawval(0);
-            c2 = receiver->getRawval(1);
-            c3 = receiver->getRawval(2);
-            c4 = receiver->getRawval(3);
-            c5 = receiver->getRawval(4);
-            c6 = receiver->getRawval(5);
+            message.c1 = receiver->getRawval(0);
+            message.c2 = receiver->getRawval(1);
+            message.c3 = receiver->getRawval(2);
+            message.c4 = receiver->getRawval(3);
+            message.c5 = receiver->getRawval(4);
+            message.c6 = receiver->getRawval(5);
         }
 
-        void handle_ATTITUDE_RADIANS_Request(float & roll, float & pitch, float & yaw)
+        void handle_ATTITUDE_RADIANS_Request(msp::ATTITUDE_RADIANS & message)
         {
-            // Cast rft::State to hf::State
-            State * state = (State *)_state;
+            // A copy, so that we neither see nor make a half-updated state
+            State state;
 
-            roll  = state->x[State::PHI];
-            pitch = state->x[State::THETA];
-            yaw   = state->x[State::PSI];
+            if (_stateSnapshot) {
+                _stateSnapshot->read(state);
+            }
+            else {
+                state = *(State *)_state;
+            }
+
+            state.updateEuler();
+
+            message.roll  = state.x[State::PHI];
+            message.pitch = state.x[State::THETA];
+            message.yaw   = state.x[State::PSI];
+        }
+
+        void handle_ACTUATOR_TYPE_Request(msp::ACTUATOR_TYPE & message)
+        {
+            message.mtype = _actuator->getType();
         }
 
-        void handle_ACTUATOR_TYPE_Request(uint8_t & type)
+        void handle_PROFILE_STATS_Request(msp::PROFILE_STATS & message)
         {
-            type = _actuator->getType();
+            uint32_t count = 0;
+            float minUsec = 0;
+            float meanUsec = 0;
+            float maxUsec = 0;
+            _loopProfiler->getStats(_profileStage, count, minUsec, meanUsec, maxUsec);
+
+            message.stage = _profileStage;
+            message.nstages = _loopProfiler->stageCount();
+            message.count = count;
+            message.minusec = minUsec;
+            message.meanusec = meanUsec;
+            message.maxusec = maxUsec;
         }
 
-        void handle_SET_MOTOR_NORMAL(float  m1, float  m2, float  m3, float  m4)
+        void handle_PROFILE_HISTOGRAM_Request(msp::PROFILE_HISTOGRAM & message)
         {
-            _actuator->setMotorDisarmed(0, m1);
-            _actuator->setMotorDisarmed(1, m2);
-            _actuator->setMotorDisarmed(2, m3);
-            _actuator->setMotorDisarmed(3, m4);
+            const Profiler::stage_t * stage = _loopProfiler->getStage(_profileStage);
+
+            float buckets[Profiler::NBUCKETS] = {};
+
+            for (uint8_t k=0; k<Profiler::NBUCKETS; ++k) {
+                buckets[k] = stage ? stage->buckets[k] : 0;
+            }
+
+            static_assert(sizeof(buckets) == sizeof(message), "one float per histogram bucket");
+            memcpy(&message, buckets, sizeof(message));
+        }
+
+        void handle_SET_MOTOR_NORMAL(const msp::SET_MOTOR_NORMAL & message)
+        {
+            _actuator->setMotorDisarmed(0, message.m1);
+            _actuator->setMotorDisarmed(1, message.m2);
+            _actuator->setMotorDisarmed(2, message.m3);
+            _actuator->setMotorDisarmed(3, message.m4);
+        }
+
+        void handle_SET_PROFILE_STAGE(const msp::SET_PROFILE_STAGE & message)
+        {
+            // Out-of-range stage resets the statistics
+            if (message.stage < _loopProfiler->stageCount()) {
+                _profileStage = message.stage;
+            }
+            else {
+                _loopProfiler->reset();
+            }
+        }
+
+        void handle_SET_TELEMETRY(const msp::SET_TELEMETRY & message)
+        {
+            _telemetry.subscribe(message.topic, message.divisor);
         }
 
         protected:
 
+        void begin(rft::Board * board, State * state, rft::OpenLoopController * olc,
+                rft::Actuator * actuator, const StateSnapshot * stateSnapshot=NULL,
+                Profiler * loopProfiler=&_profiler)
+        {
+            rft::SerialTask::begin(board, state, olc, actuator);
+
+            _stateSnapshot = stateSnapshot;
+            _loopProfiler = loopProfiler;
+        }
+
+        // Streamed frames go out on the next pass, ahead of any reply to a
+        // request arriving then; a request overwrites a pending frame, which
+        // the GCS sees as a gap in the sequence numbers
+        virtual void doTask(void) override
+        {
+            rft::SerialTask::doTask();
+
+            if (availableBytes() == 0) {
+
+                uint8_t payload[Telemetry::MAX_PAYLOAD] = {};
+
+                uint8_t size = _telemetry.pack(payload);
+
+                if (size) {
+                    sendBytes(msp::TELEMETRY::ID, payload, size);
+                }
+            }
+        }
+
         void dispatchMessage(void) override
         {
-            switch (_command) {
-
-                case 121:
-                    {
-                        float c1 = 0;
-                        float c2 = 0;
-                        float c3 = 0;
-                        float c4 = 0;
-                        float c5 = 0;
-                        float c6 = 0;
-                        handle_RECEIVER_Request(c1, c2, c3, c4, c5, c6);
-                        prepareToSendFloats(6);
-                        sendFloat(c1);
-                        sendFloat(c2);
-                        sendFloat(c3);
-                        sendFloat(c4);
-                        sendFloat(c5);
-                        sendFloat(c6);
-                        serialize8(_checksum);
-                    } break;
-
-                case 122:
-                    {
-                        float roll = 0;
-                        float pitch = 0;
-                        float yaw = 0;
-                        handle_ATTITUDE_RADIANS_Request(roll, pitch, yaw);
-                        prepareToSendFloats(3);
-                        sendFloat(roll);
-                        sendFloat(pitch);
-                        sendFloat(yaw);
-                        serialize8(_checksum);
-                    } break;
-
-                    case 123:
-                        {
-                            uint8_t type = 0;
-                            handle_ACTUATOR_TYPE_Request(type);
-                            prepareToSendBytes(1);
-                            sendByte(type);
-                            serialize8(_checksum);
-                        } break;
-
-                case 215:
-                    {
-                        float m1 = 0;
-                        memcpy(&m1,  &_inBuf[0], sizeof(float));
-
-                        float m2 = 0;
-                        memcpy(&m2,  &_inBuf[4], sizeof(float));
-
-                        float m3 = 0;
-                        memcpy(&m3,  &_inBuf[8], sizeof(float));
-
-                        float m4 = 0;
-                        memcpy(&m4,  &_inBuf[12], sizeof(float));
-
-                        handle_SET_MOTOR_NORMAL(m1, m2, m3, m4);
-                    } break;
-
-            } // switch (_command)
-
-        } // dispatchMessage 
+            msp::Dispatcher<SerialTask>::dispatch(this, _command, _inBuf);
+
+        } // dispatchMessage
 
     }; // class SerialTask
 
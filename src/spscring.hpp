@@ -0,0 +1,148 @@
+/*
+   Lock-free single-producer / single-consumer ring buffer that keeps the
+   newest items
+
+   One thread (or task, or core) pushes, another pops, with no locks.  The
+   producer never waits: when the consumer has fallen N items behind, a
+   push overwrites the oldest unread item.  Each slot carries a sequence
+   number, odd while the slot is being written and 2(n+1) once it holds
+   push number n, so the consumer skips past anything overwritten, even
+   during its copy, and never returns a half-written item.
+
+   Slots are held as 32-bit atomic words, as in Seqlock, so a copy the
+   consumer throws away is not a data race.  T must be trivially copyable.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+namespace hf {
+
+    template <typename T, uint8_t N>
+    class SpscRing {
+
+        private:
+
+            static const uint16_t NWORDS = (sizeof(T) + 3) / 4;
+
+            typedef struct {
+
+                std::atomic<uint32_t> sequence;
+                std::atomic<uint32_t> words[NWORDS];
+
+            } slot_t;
+
+            slot_t _slots[N];
+
+            // Counts of pushes and pops, not wrapped to N
+            std::atomic<uint32_t> _head = {0}; // written by producer
+            std::atomic<uint32_t> _tail = {0}; // written by consumer
+
+        public:
+
+            SpscRing(void)
+            {
+                for (uint8_t j=0; j<N; ++j) {
+
+                    _slots[j].sequence.store(0, std::memory_order_relaxed);
+
+                    for (uint16_t k=0; k<NWORDS; ++k) {
+                        _slots[j].words[k].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Producer side; always stores the item, returning false if that
+            // overwrote one the consumer hadn't popped
+            bool push(const T & item)
+            {
+                uint32_t words[NWORDS] = {};
+                memcpy(words, &item, sizeof(T));
+
+                uint32_t head = _head.load(std::memory_order_relaxed);
+
+                slot_t * slot = &_slots[head % N];
+
+                slot->sequence.store(2*head + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                for (uint16_t k=0; k<NWORDS; ++k) {
+                    slot->words[k].store(words[k], std::memory_order_relaxed);
+                }
+
+                slot->sequence.store(2*head + 2, std::memory_order_release);
+
+                _head.store(head + 1, std::memory_order_release);
+
+                return head - _tail.load(std::memory_order_acquire) < N;
+            }
+
+            // Consumer side; returns false when empty.  Items overwritten since
+            // the last pop are skipped, so what comes out is always in order.
+            bool pop(T & item)
+            {
+                uint32_t tail = _tail.load(std::memory_order_relaxed);
+
+                while (true) {
+
+                    uint32_t head = _head.load(std::memory_order_acquire);
+
+                    if (tail == head) {
+                        return false;
+                    }
+
+                    // Lapped: the oldest still in the ring
+                    if (head - tail > N) {
+                        tail = head - N;
+                    }
+
+                    const slot_t * slot = &_slots[tail % N];
+
+                    uint32_t sequence = 2*tail + 2;
+
+                    uint32_t words[NWORDS];
+
+                    for (uint16_t k=0; k<NWORDS; ++k) {
+                        words[k] = slot->words[k].load(std::memory_order_relaxed);
+                    }
+
+                    std::atomic_thread_fence(std::memory_order_acquire);
+
+                    // Overwritten before or while we copied it; try the next
+                    if (slot->sequence.load(std::memory_order_relaxed) != sequence) {
+                        ++tail;
+                        continue;
+                    }
+
+                    memcpy(&item, words, sizeof(T));
+
+                    _tail.store(tail + 1, std::memory_order_release);
+
+                    return true;
+                }
+            }
+
+            // Consumer side: discards all but the newest item and pops that
+            bool popNewest(T & item)
+            {
+                uint32_t head = _head.load(std::memory_order_acquire);
+
+                if (_tail.load(std::memory_order_relaxed) == head) {
+                    return false;
+                }
+
+                _tail.store(head - 1, std::memory_order_release);
+
+                return pop(item);
+            }
+
+    }; // class SpscRing
+
+} // namespace hf
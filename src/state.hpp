@@ -8,19 +8,31 @@
 
 #pragma once
 
+#include <math.h>
+#include <stdint.h>
+
 #include <RFT_filters.hpp>
 #include <RFT_state.hpp>
 
+#include "eulermath.hpp"
+
 namespace hf {
 
     class State : public rft::State{
 
         friend class Hackflight;
+        friend class HackflightBase;
 
         private:
 
             static constexpr float MAX_ARMING_ANGLE_DEGREES = 25.0f;
 
+            // Set when the quaternion is newer than the Euler angles
+            bool _eulerStale;
+
+            // Heading from the quaternion is kept in [_psiMin, _psiMin + 2*pi)
+            float _psiMin;
+
             bool safeAngle(uint8_t axis)
             {
                 return fabs(x[axis]) < rft::Filter::deg2rad(MAX_ARMING_ANGLE_DEGREES);
@@ -30,6 +42,8 @@ namespace hf {
 
             bool safeToArm(void)
             {
+                updateEuler();
+
                 return safeAngle(PHI) && safeAngle(THETA);
             }
 
@@ -40,6 +54,39 @@ namespace hf {
 
             float x[SIZE];
 
+            // Attitude quaternion w, x, y, z, whose Z-Y-X Euler angles are PHI,
+            // THETA, PSI above; all zero until a sensor provides one
+            float q[4];
+
+            // Sets the quaternion, leaving the Euler angles to updateEuler()
+            void setQuaternion(const float * quat, float psiMin)
+            {
+                q[0] = quat[0];
+                q[1] = quat[1];
+                q[2] = quat[2];
+                q[3] = quat[3];
+
+                _psiMin = psiMin;
+                _eulerStale = true;
+            }
+
+            // Brings PHI, THETA, PSI up to date with the quaternion; call before reading them
+            // when the quaternion may be newer
+            void updateEuler(void)
+            {
+                if (!_eulerStale) {
+                    return;
+                }
+
+                EulerMath::fromQuaternion(q, x[PHI], x[THETA], x[PSI]);
+
+                if (x[PSI] < _psiMin) {
+                    x[PSI] += 2*(float)M_PI;
+                }
+
+                _eulerStale = false;
+            }
+
     }; // class State
 
 } // namespace hf
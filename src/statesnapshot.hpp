@@ -0,0 +1,68 @@
+/*
+   The state as of the last complete loop, published by each Hackflight
+   class for readers on other threads, cores, or interrupts
+
+   With HF_STATE_SNAPSHOT defined, this is a Seqlock, so a reader never
+   waits for the loop and never sees a half-written state.  Seqlock needs
+   <atomic>, which not every board has (AVR doesn't), so otherwise nothing
+   is published: a reader copies the live state, as it would with no
+   snapshot at all.  DualCoreHackflight uses Seqlock directly for its own
+   snapshots, either way.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "state.hpp"
+
+#if defined(HF_STATE_SNAPSHOT)
+
+#include "seqlock.hpp"
+
+namespace hf {
+
+    typedef Seqlock<State> StateSnapshot;
+
+} // namespace hf
+
+#else
+
+namespace hf {
+
+    class StateSnapshot {
+
+        private:
+
+            const State * _state = NULL;
+
+            uint32_t _count = 0;
+
+        public:
+
+            void write(const State & value)
+            {
+                _state = &value;
+                _count++;
+            }
+
+            // The live state; zeros before the first write
+            void read(State & value) const
+            {
+                value = _state ? *_state : State();
+            }
+
+            uint32_t count(void) const
+            {
+                return _count;
+            }
+
+    }; // class StateSnapshot
+
+} // namespace hf
+
+#endif
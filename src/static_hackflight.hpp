@@ -0,0 +1,294 @@
+/*
+   Hackflight core algorithm with static dispatch
+
+   An alternative to the Hackflight class in which the receiver, mixer,
+   sensors, and closed-loop controllers are template arguments rather than
+   base-class pointers, so that the compiler can inline the whole
+   sensors => controllers => mixer dataflow.  Arming, failsafe, and the
+   LED are still handled by RFT, since they don't run every loop.
+
+   Example:
+
+     hf::SensorList<hf::UsfsMaxQuaternion, hf::UsfsMaxGyrometer> sensors(quaternion, gyrometer);
+
+     hf::ControllerList<hf::LevelPid, hf::RatePid, hf::YawPid> controllers(levelPid, ratePid, yawPid);
+
+     // Level mode with AUX2 up, as addClosedLoopController(&levelPid, 1) would
+     // give; the Hackflight copies the list, so set modes before constructing it
+     controllers.setModeIndex(&levelPid, 1);
+
+     hf::StaticHackflight<DSMX_ESP32_Serial1, StaticMixerQuadXMW,
+         decltype(sensors), decltype(controllers)> h(&board, receiver, mixer, sensors, controllers);
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <RFT_board.hpp>
+#include <RoboFirmwareToolkit.hpp>
+
+#include "hackflight_base.hpp"
+#include "receiver.hpp"
+#include "state.hpp"
+#include "serialtask.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "blackbox.hpp"
+#include "demands.hpp"
+#include "statesnapshot.hpp"
+
+namespace hf {
+
+    // Sensors, in the order they are checked --------------------------------
+
+    template <typename... Sensors>
+    class SensorList;
+
+    template <>
+    class SensorList<> {
+
+        public:
+
+            void begin(void) { }
+
+            bool update(State * state, float time) { (void)state; (void)time; return false; }
+
+    }; // class SensorList<>
+
+    template <typename Sensor, typename... Rest>
+    class SensorList<Sensor, Rest...> {
+
+        private:
+
+            Sensor & _sensor;
+
+            SensorList<Rest...> _rest;
+
+        public:
+
+            SensorList(Sensor & sensor, Rest & ... rest)
+                : _sensor(sensor), _rest(rest...)
+            {
+            }
+
+            void begin(void)
+            {
+                _sensor.Sensor::begin();
+                _rest.begin();
+            }
+
+            // Returns true if any sensor was ready
+            bool update(State * state, float time)
+            {
+                bool ready = _sensor.Sensor::ready(time);
+
+                if (ready) {
+                    _sensor.Sensor::modifyState(state, time);
+                }
+
+                return _rest.update(state, time) || ready;
+            }
+
+    }; // class SensorList
+
+    // Closed-loop controllers, in the order they modify the demands ---------
+
+    template <typename... Controllers>
+    class ControllerList;
+
+    template <>
+    class ControllerList<> {
+
+        public:
+
+            void modifyDemands(State * state, float * demands, uint8_t modeIndex)
+            {
+                (void)state;
+                (void)demands;
+                (void)modeIndex;
+            }
+
+            bool setModeIndex(const rft::ClosedLoopController * controller, uint8_t modeIndex)
+            {
+                (void)controller;
+                (void)modeIndex;
+                return false;
+            }
+
+            void addToBlackbox(void) { }
+
+    }; // class ControllerList<>
+
+    template <typename Controller, typename... Rest>
+    class ControllerList<Controller, Rest...> {
+
+        static_assert(1 + sizeof...(Rest) <= Blackbox::MAXCONTROLLERS,
+                "the blackbox logs at most Blackbox::MAXCONTROLLERS controllers");
+
+        private:
+
+            Controller & _controller;
+
+            uint8_t _modeIndex = 0;
+
+            ControllerList<Rest...> _rest;
+
+        public:
+
+            ControllerList(Controller & controller, Rest & ... rest)
+                : _controller(controller), _rest(rest...)
+            {
+            }
+
+            // As in RFT, a controller runs only when its mode index is no more
+            // than the receiver's
+            void modifyDemands(State * state, float * demands, uint8_t modeIndex)
+            {
+                if (_modeIndex <= modeIndex) {
+                    _controller.Controller::modifyDemands(state, demands);
+                }
+
+                _rest.modifyDemands(state, demands, modeIndex);
+            }
+
+            // Like the modeIndex argument of RFT::addClosedLoopController(); zero,
+            // for always, unless set.  Returns false if the controller isn't listed.
+            bool setModeIndex(const rft::ClosedLoopController * controller, uint8_t modeIndex)
+            {
+                if (controller == &_controller) {
+                    _modeIndex = modeIndex;
+                    return true;
+                }
+
+                return _rest.setModeIndex(controller, modeIndex);
+            }
+
+            // Called after Blackbox::begin(), so that the log has the controllers in order
+            void addToBlackbox(void)
+            {
+                _blackbox.addController(&_controller);
+                _rest.addToBlackbox();
+            }
+
+    }; // class ControllerList
+
+    // -----------------------------------------------------------------------
+
+    template <typename Rx, typename Mix, typename Sensors, typename Controllers>
+    class StaticHackflight : public HackflightBase {
+
+        private:
+
+            // Same rate as RFT's closed-loop task
+            static constexpr float CLOSED_LOOP_FREQ = 300;
+
+            Rx & _rx;
+
+            Mix & _mixer;
+
+            Sensors _sensors;
+
+            Controllers _controllers;
+
+            SerialTask _serialTask;
+
+            State _state;
+
+            // Published once per loop
+            StateSnapshot _stateSnapshot;
+
+            float _closedLoopTime = 0;
+
+            uint8_t _loopStage = _profiler.addStage("StaticHackflight.update");
+
+            void runClosedLoop(void)
+            {
+                float time = _board->getTime();
+
+                if (time - _closedLoopTime <= 1 / CLOSED_LOOP_FREQ) {
+                    return;
+                }
+
+                _closedLoopTime = time;
+
+                float demands[4] = {};
+
+                getDemands(_rx, demands);
+
+                _controllers.modifyDemands(&_state, demands, getModeIndex(_rx));
+
+                if (_state.armed) {
+                    _mixer.Mix::run(demands);
+                }
+                else {
+                    runDisarmed(_mixer);
+                }
+            }
+
+        protected:
+
+            virtual bool safeStateForArming(void) override
+            {
+                return safeToArm(_state);
+            }
+
+        public:
+
+            StaticHackflight(rft::Board * board, Rx & rx, Mix & mixer, Sensors & sensors, Controllers & controllers)
+                : HackflightBase(&_state, board, &rx, &mixer),
+                  _rx(rx),
+                  _mixer(mixer),
+                  _sensors(sensors),
+                  _controllers(controllers)
+            {
+            }
+
+            void begin(bool armed=false)
+            {
+                _sensors.begin();
+
+                beginRuntime(_state, _rx, armed, &_serialTask, &_stateSnapshot);
+
+                _closedLoopTime = 0;
+
+                _controllers.addToBlackbox();
+            }
+
+            void update(void)
+            {
+                ProfileTimer timer(_loopStage);
+
+                // Arming, failsafe, and receiver frames
+                checkOpenLoopController();
+
+                // Controllers and mixer at fixed rate
+                runClosedLoop();
+
+                // Sensors
+                _sensors.update(&_state, _board->getTime());
+
+                // A coherent copy of the state for other readers
+                _stateSnapshot.write(_state);
+
+                // Telemetry samples
+                _telemetry.sample(_board->getTime(), &_state, &_rx);
+
+                // Update serial comms task
+                _serialTask.update();
+
+                // Blackbox log to its sink
+                _blackbox.flush();
+            }
+
+            // State as of the last loop, for readers on other threads, cores, or interrupts
+            const StateSnapshot & stateSnapshot(void)
+            {
+                return _stateSnapshot;
+            }
+
+    }; // class StaticHackflight
+
+} // namespace hf
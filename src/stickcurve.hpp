@@ -0,0 +1,104 @@
+/*
+   Stick-shaping curves as interpolated lookup tables
+
+   Each curve is tabulated once, when its parameters are set, and costs a
+   multiply, a truncation and a linear interpolation per stick value after
+   that, with no divisions or branches on the curve's shape.  The closed
+   forms the tables are filled from are public, so they can be checked
+   against each other on the host (extras/sitl/stickbench.cpp).
+
+   Rate curves shape a stick magnitude in [0,1] the way most modern flight
+   controllers do: a cubic expo, a linear rate, and a "super rate" that
+   steepens the curve toward full stick.  Throttle curves map [-1,+1] to
+   [-1,+1] through a cubic expo about a mid-stick point.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hf {
+
+    class StickCurve {
+
+        public:
+
+            static const uint8_t SIZE = 65;
+
+        private:
+
+            float _table[SIZE] = {};
+
+            float _min = 0;   // stick value at _table[0]
+            float _scale = 0; // table steps per unit stick
+
+            template <typename Curve>
+            void fill(float min, Curve curve)
+            {
+                _min = min;
+                _scale = (SIZE - 1) / (1 - min);
+
+                for (uint8_t k=0; k<SIZE; ++k) {
+                    _table[k] = curve(min + k / _scale);
+                }
+            }
+
+        public:
+
+            // Expo in [0,1] blends a linear response with a cubic; super rate in
+            // [0,1) divides by 1 - superRate * x; x is a stick magnitude in [0,1]
+            static float rateCurve(float x, float rate, float expo, float superRate)
+            {
+                float y = (1 + expo * (x*x - 1)) * x * rate;
+
+                float denominator = 1 - superRate * x;
+
+                return y / (denominator < 0.01f ? 0.01f : denominator);
+            }
+
+            // Throttle x in [-1,+1] with mid-stick at mid in (0,1) of the throttle range
+            static float throttleCurve(float x, float mid, float expo)
+            {
+                float tmp = (x + 1) / 2 - mid;
+                float y = tmp>0 ? 1-mid : (tmp<0 ? mid : 1);
+                return (mid + tmp*(1-expo + expo * (tmp*tmp) / (y*y))) * 2 - 1;
+            }
+
+            // Defaults to linear over [0,1]
+            StickCurve(void)
+            {
+                setRate(1, 0, 0);
+            }
+
+            void setRate(float rate, float expo, float superRate=0)
+            {
+                fill(0, [=](float x) { return rateCurve(x, rate, expo, superRate); });
+            }
+
+            void setThrottle(float mid, float expo)
+            {
+                fill(-1, [=](float x) { return throttleCurve(x, mid, expo); });
+            }
+
+            // Stick values outside the curve's domain are clamped to it
+            float lookup(float x) const
+            {
+                float position = (x - _min) * _scale;
+
+                position = position < 0 ? 0 : (position > SIZE-1 ? SIZE-1 : position);
+
+                uint8_t index = (uint8_t)position;
+                index = index < SIZE-1 ? index : SIZE-2;
+
+                float fraction = position - index;
+
+                return _table[index] + fraction * (_table[index+1] - _table[index]);
+            }
+
+    }; // class StickCurve
+
+} // namespace hf
@@ -0,0 +1,290 @@
+/*
+   Streaming telemetry
+
+   The GCS subscribes to topics (attitude, gyro, RC, demands, motors, loop
+   timing), each with its own divisor of a fixed base sample rate.  Samples
+   are buffered here from the flight loop, and SerialTask drains them as
+   batched frames (several samples per topic per MSP frame) carrying a
+   sequence number, so a 115200-baud link can carry high-rate logs without
+   a request per sample.
+
+   Copyright (c) 2021 Simon D. Levy
+
+   MIT License
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "state.hpp"
+#include "receiver.hpp"
+
+namespace hf {
+
+    class Telemetry {
+
+        public:
+
+            enum {
+                TOPIC_ATTITUDE,     // phi, theta, psi (radians)
+                TOPIC_GYRO,         // dphi, dtheta, dpsi (radians/sec)
+                TOPIC_RC,           // six mapped receiver channels in [-1,+1]
+                TOPIC_DEMANDS,      // throttle, roll, pitch, yaw into the mixer
+                TOPIC_MOTORS,       // first four motor values in [0,1]
+                TOPIC_TIMING,       // max loop time (usec), loops since last sample
+                NTOPICS
+            };
+
+            // Topic divisors count ticks of this clock
+            static constexpr float BASE_HZ = 1000;
+
+            // Fits in the MSP output buffer with room for the header and checksum
+            static const uint8_t MAX_PAYLOAD = 120;
+
+            static const uint8_t MAXMOTORS = 4;
+
+        private:
+
+            // Per-topic buffer; enough for a full frame of any topic
+            static const uint8_t BUFFLOATS = 30;
+
+            typedef struct {
+
+                uint8_t divisor;    // 0 = unsubscribed
+                uint8_t size;       // floats per sample
+                uint8_t count;      // samples buffered
+                float buffer[BUFFLOATS];
+
+            } topic_t;
+
+            topic_t _topics[NTOPICS] = {
+                {0, 3, 0, {}},
+                {0, 3, 0, {}},
+                {0, 6, 0, {}},
+                {0, 4, 0, {}},
+                {0, MAXMOTORS, 0, {}},
+                {0, 2, 0, {}},
+            };
+
+            bool _subscribed = false;
+
+            uint32_t _tick = 0;
+            float _sampleTime = 0;
+
+            // Loop timing between samples
+            float _prevTime = 0;
+            float _maxLoopTime = 0;
+            uint32_t _loopCount = 0;
+
+            // Set when sampling runs on another core than the mixer
+            bool _snapshots = false;
+
+            // Latest values reported by the mixer
+            float _demands[4] = {};
+            float _motors[MAXMOTORS] = {};
+
+            uint8_t _sequence = 0;
+            uint8_t _dropped = 0;
+            uint8_t _nextTopic = 0;
+
+            void append(uint8_t index, const float * values)
+            {
+                topic_t * topic = &_topics[index];
+
+                if ((topic->count + 1) * topic->size > BUFFLOATS) {
+                    if (_dropped < 0xFF) {
+                        _dropped++;
+                    }
+                    return;
+                }
+
+                memcpy(&topic->buffer[topic->count * topic->size], values, topic->size * sizeof(float));
+
+                topic->count++;
+            }
+
+            bool due(uint8_t index)
+            {
+                uint8_t divisor = _topics[index].divisor;
+
+                return divisor && _tick % divisor == 0;
+            }
+
+        public:
+
+            // Called by Hackflight::begin(): unsubscribes from everything and clears buffers
+            void begin(void)
+            {
+                *this = Telemetry();
+            }
+
+            // Divisor 0 unsubscribes; an out-of-range topic unsubscribes from everything
+            void subscribe(uint8_t index, uint8_t divisor)
+            {
+                if (index < NTOPICS) {
+                    _topics[index].divisor = divisor;
+                    _topics[index].count = 0;
+                }
+                else {
+                    for (uint8_t k=0; k<NTOPICS; ++k) {
+                        _topics[k].divisor = 0;
+                        _topics[k].count = 0;
+                    }
+                }
+
+                _subscribed = false;
+                for (uint8_t k=0; k<NTOPICS; ++k) {
+                    _subscribed |= _topics[k].divisor > 0;
+                }
+            }
+
+            void setDemands(const float * demands)
+            {
+                if (_subscribed && !_snapshots) {
+                    memcpy(_demands, demands, sizeof(_demands));
+                }
+            }
+
+            void setMotor(uint8_t index, float value)
+            {
+                if (_subscribed && !_snapshots && index < MAXMOTORS) {
+                    _motors[index] = value;
+                }
+            }
+
+            // Call on the sampling core before anything subscribes; from then
+            // on the mixer's values are ignored, and setSnapshot() provides them
+            void useSnapshots(void)
+            {
+                _snapshots = true;
+            }
+
+            void setSnapshot(const float * demands, const float * motors)
+            {
+                if (_subscribed) {
+                    memcpy(_demands, demands, sizeof(_demands));
+                    memcpy(_motors, motors, sizeof(_motors));
+                }
+            }
+
+            // Called once per pass through the flight loop
+            void sample(float time, State * state, Receiver * receiver)
+            {
+                if (!_subscribed) {
+                    return;
+                }
+
+                float looptime = time - _prevTime;
+                _prevTime = time;
+                _loopCount++;
+                if (looptime > _maxLoopTime) {
+                    _maxLoopTime = looptime;
+                }
+
+                if (time - _sampleTime < 1 / BASE_HZ) {
+                    return;
+                }
+
+                _sampleTime = time;
+                _tick++;
+
+                if (due(TOPIC_ATTITUDE)) {
+                    state->updateEuler();
+                    float values[3] = {state->x[State::PHI], state->x[State::THETA], state->x[State::PSI]};
+                    append(TOPIC_ATTITUDE, values);
+                }
+
+                if (due(TOPIC_GYRO)) {
+                    float values[3] = {state->x[State::DPHI], state->x[State::DTHETA], state->x[State::DPSI]};
+                    append(TOPIC_GYRO, values);
+                }
+
+                if (due(TOPIC_RC)) {
+                    float values[6] = {};
+                    for (uint8_t k=0; k<6; ++k) {
+                        values[k] = receiver->getRawval(k);
+                    }
+                    append(TOPIC_RC, values);
+                }
+
+                if (due(TOPIC_DEMANDS)) {
+                    append(TOPIC_DEMANDS, _demands);
+                }
+
+                if (due(TOPIC_MOTORS)) {
+                    append(TOPIC_MOTORS, _motors);
+                }
+
+                if (due(TOPIC_TIMING)) {
+                    float values[2] = {_maxLoopTime * 1e6f, (float)_loopCount};
+                    append(TOPIC_TIMING, values);
+                    _maxLoopTime = 0;
+                    _loopCount = 0;
+                }
+            }
+
+            /**
+              * Packs as many buffered samples as will fit into a frame:
+              *   sequence, dropped, then per topic: topic, count, count*size floats
+              * Topics take turns going first so that none is starved.
+              * Returns the payload size, or zero if there is nothing to send.
+              */
+            uint8_t pack(uint8_t payload[MAX_PAYLOAD])
+            {
+                uint8_t size = 2;
+
+                for (uint8_t j=0; j<NTOPICS; ++j) {
+
+                    uint8_t index = (_nextTopic + j) % NTOPICS;
+
+                    topic_t * topic = &_topics[index];
+
+                    if (!topic->count) {
+                        continue;
+                    }
+
+                    uint8_t sampleBytes = topic->size * sizeof(float);
+
+                    uint8_t room = size + 2 < MAX_PAYLOAD ? (MAX_PAYLOAD - size - 2) / sampleBytes : 0;
+
+                    uint8_t count = topic->count < room ? topic->count : room;
+
+                    if (!count) {
+                        break;
+                    }
+
+                    payload[size++] = index;
+                    payload[size++] = count;
+
+                    memcpy(&payload[size], topic->buffer, count * sampleBytes);
+                    size += count * sampleBytes;
+
+                    // Keep whatever didn't fit for the next frame
+                    topic->count -= count;
+                    memmove(topic->buffer, &topic->buffer[count * topic->size], topic->count * sampleBytes);
+                }
+
+                if (size == 2) {
+                    return 0;
+                }
+
+                payload[0] = _sequence++;
+                payload[1] = _dropped;
+
+                _dropped = 0;
+                _nextTopic = (_nextTopic + 1) % NTOPICS;
+
+                return size;
+            }
+
+    }; // class Telemetry
+
+#if defined(ARDUINO)
+    static Telemetry _telemetry;
+#else
+    static thread_local Telemetry _telemetry;
+#endif
+
+} // namespace hf